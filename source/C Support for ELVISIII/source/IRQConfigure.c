@@ -7,6 +7,7 @@
  */
 
 #include <stdio.h>
+#include <time.h>
 
 /**
  * Include the ELVIS III header file.
@@ -26,11 +27,54 @@
 extern NiFpga_Session NiELVISIIIv10_session;
 
 /*
- * Declare the header point which points to the reserved IRQ resource list.
- * If you are programming in a multi-thread pattern, make sure this is accessed
- * in a thread-safe way.
+ * The reserved IRQ resources are kept in one 32-bit word so that a channel and
+ * an IRQ number can be reserved together with a single compare-and-swap:
+ *   bit n        IRQ number n is reserved (0 - IRQNO_MAX)
+ *   bit 16 + c   Irq_Channel c is reserved
+ * No heap is used and every check is O(1). The registry can be used from
+ * multiple threads without a lock.
  */
-static ReservedIrqPointer reserved_irq_head = NULL;
+#define IRQ_RESERVED_NUMBER(irqNumber)  ((uint32_t)1 << (irqNumber))
+#define IRQ_RESERVED_CHANNEL(channel)   ((uint32_t)1 << (16 + (channel)))
+
+#if IRQNO_MAX >= 16
+#error "IRQNO_MAX must be smaller than 16: the IRQ numbers use the low 16 bits of the reserved word."
+#endif
+
+static volatile uint32_t reserved_irq = 0;
+
+/*
+ * The channel reserved with each IRQ number plus one, or 0 if the number is
+ * free, so the channel can be released with the IRQ number. The slot is taken
+ * before the number is set in reserved_irq, so whoever sees the number
+ * reserved also sees its channel.
+ */
+static volatile uint8_t reserved_irq_channel[IRQNO_MAX + 1];
+
+/*
+ * Set by Irq_CancelWaits. With the timer IRQ reserved for cancellation, the
+ * waits include IRQ_CANCEL_IRQNO and use an infinite timeout; cancelling sets
+ * the FPGA timer so every wait returns at once. Otherwise the waits check the
+ * flag every IRQ_WAIT_POLL milliseconds.
+ */
+static volatile NiFpga_Bool irq_cancelled = NiFpga_False;
+static volatile NiFpga_Bool irq_cancel_reserved = NiFpga_False;
+
+/*
+ * The IRQ contexts reserved by NiELVISIIIv10_Open. Bit n of irq_context_free
+ * is set while irq_context[n] is in the pool, so a context is taken or returned
+ * with a single compare-and-swap and without calling the driver.
+ */
+static NiFpga_IrqContext irq_context[IRQ_CONTEXT_POOL_SIZE];
+static volatile uint32_t irq_context_free = 0;
+static uint32_t irq_context_count = 0;
+
+#if IRQ_CONTEXT_POOL_DEBUG
+/*
+ * The caller that acquired each context, reported if it is not released.
+ */
+static void* irq_context_owner[IRQ_CONTEXT_POOL_SIZE];
+#endif
 
 /**
  * Check whether the channel and IRQ number are already reserved.
@@ -44,56 +88,77 @@ static ReservedIrqPointer reserved_irq_head = NULL;
  */
 int32_t Irq_CheckReserved(Irq_Channel channel, uint8_t irqNumber)
 {
-	ReservedIrqPointer pCurr = reserved_irq_head;
-	if (pCurr != NULL)
+	uint32_t reserved = reserved_irq;
+
+	if (irqNumber > IRQNO_MAX)
 	{
-		do
-		{
-			if (irqNumber == pCurr->number)
-			{
-				return NiELVISIIIv10_Status_IrqNumberNotUsable;
-			}
-			else if (channel == pCurr->channel)
-			{
-				return NiELVISIIIv10_Status_IrqChannelNotUsable;
-			}
-			pCurr = pCurr->pNext;
-		} while (pCurr != NULL);
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	if (reserved & IRQ_RESERVED_NUMBER(irqNumber))
+	{
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
 	}
+	else if (reserved & IRQ_RESERVED_CHANNEL(channel))
+	{
+		return NiELVISIIIv10_Status_IrqChannelNotUsable;
+	}
+
 	return NiELVISIIIv10_Status_Success;
 }
 
 
 /**
- * Create a new node in the resource list.
+ * Reserve a channel and an IRQ number.
+ *
+ * Both are reserved in one atomic step, so when two threads register the same
+ * channel or IRQ number at the same time only one of them succeeds.
  *
  * @param[in]  channel       IRQ supported channel name.
  * @param[in]  irqNumber     IRQ number.
  *
- * @return the configure status.
+ * @return the configure status. NiELVISIIIv10_Status_IrqNumberNotUsable or
+ *         NiELVISIIIv10_Status_IrqChannelNotUsable if either is already reserved.
  */
 int32_t Irq_AddReserved(Irq_Channel channel, uint8_t irqNumber)
 {
-	ReservedIrqPointer pNew = (ReservedIrqPointer)malloc(sizeof(ReservedIrq));
-	pNew->channel = channel;
-	pNew->number = irqNumber;
-	if (reserved_irq_head == NULL)
+	uint32_t reserved;
+	uint32_t request;
+
+	if (irqNumber > IRQNO_MAX)
 	{
-		pNew->pNext = NULL;
-		reserved_irq_head = pNew;
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
 	}
-	else
+
+	request = IRQ_RESERVED_NUMBER(irqNumber) | IRQ_RESERVED_CHANNEL(channel);
+
+	/*
+	 * Take the channel slot of the IRQ number first. Only one thread can take
+	 * it, so the channel is written before the number becomes visible.
+	 */
+	if (!__sync_bool_compare_and_swap(&reserved_irq_channel[irqNumber], 0, (uint8_t)(channel + 1)))
 	{
-		pNew->pNext = reserved_irq_head->pNext;
-		reserved_irq_head->pNext = pNew;
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
 	}
 
+	do
+	{
+		reserved = reserved_irq;
+
+		if (reserved & (IRQ_RESERVED_NUMBER(irqNumber) | IRQ_RESERVED_CHANNEL(channel)))
+		{
+			reserved_irq_channel[irqNumber] = 0;
+			return (reserved & IRQ_RESERVED_NUMBER(irqNumber)) ? NiELVISIIIv10_Status_IrqNumberNotUsable
+			                                                  : NiELVISIIIv10_Status_IrqChannelNotUsable;
+		}
+	} while (!__sync_bool_compare_and_swap(&reserved_irq, reserved, reserved | request));
+
 	return NiELVISIIIv10_Status_Success;
 }
 
 
 /**
- * Delete the pointed registered resource in the resource list.
+ * Release an IRQ number and the channel reserved with it.
  *
  * @param[in]  irqNumber     IRQ number.
  *
@@ -101,40 +166,390 @@ int32_t Irq_AddReserved(Irq_Channel channel, uint8_t irqNumber)
  */
 int32_t Irq_RemoveReserved(uint8_t irqNumber)
 {
-	ReservedIrqPointer pCurr = reserved_irq_head;
-	ReservedIrqPointer pPrev = reserved_irq_head;
-	if (pCurr != NULL)
+	uint32_t reserved;
+	uint32_t release;
+
+	if (irqNumber > IRQNO_MAX)
+	{
+		return NiELVISIIIv10_Status_Success;
+	}
+
+	do
+	{
+		reserved = reserved_irq;
+
+		if (!(reserved & IRQ_RESERVED_NUMBER(irqNumber)))
+		{
+			return NiELVISIIIv10_Status_Success;
+		}
+
+		release = IRQ_RESERVED_NUMBER(irqNumber) | IRQ_RESERVED_CHANNEL(reserved_irq_channel[irqNumber] - 1);
+	} while (!__sync_bool_compare_and_swap(&reserved_irq, reserved, reserved & ~release));
+
+	/*
+	 * Free the slot last. A thread that reserves the number before this fails
+	 * as if the number was still reserved.
+	 */
+	reserved_irq_channel[irqNumber] = 0;
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+
+/**
+ * Reserve the IRQ contexts of the pool. Called by NiELVISIIIv10_Open.
+ *
+ * Reserving a context allocates memory in the driver and makes the first wait
+ * slower, so all the contexts are reserved once, before any IRQ is used.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_CreateContextPool(void)
+{
+	NiFpga_Status status = NiFpga_Status_Success;
+	uint32_t      available = 0;
+
+	for (irq_context_count = 0; irq_context_count < IRQ_CONTEXT_POOL_SIZE; ++irq_context_count)
+	{
+		status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, &irq_context[irq_context_count]);
+		if (NiFpga_IsError(status))
+		{
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
+
+			/* Unreserve the contexts reserved so far, so no half-built pool is left. */
+			irq_context_free = available;
+			Irq_DestroyContextPool();
+			return status;
+		}
+		available |= (uint32_t)1 << irq_context_count;
+	}
+
+	irq_context_free = available;
+
+	return status;
+}
+
+/**
+ * Unreserve the IRQ contexts of the pool. Called by NiELVISIIIv10_Close.
+ * With IRQ_CONTEXT_POOL_DEBUG, the contexts that were not released are reported.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_DestroyContextPool(void)
+{
+	NiFpga_Status status = NiFpga_Status_Success;
+	uint32_t      index;
+
+	for (index = 0; index < irq_context_count; ++index)
+	{
+#if IRQ_CONTEXT_POOL_DEBUG
+		if (!(irq_context_free & ((uint32_t)1 << index)))
+		{
+			printf("IRQ context %u was not released. It was acquired from %p.\n", index, irq_context_owner[index]);
+		}
+#endif
+		NiFpga_MergeStatus(&status, NiFpga_UnreserveIrqContext(NiELVISIIIv10_session, irq_context[index]));
+	}
+
+	irq_context_free  = 0;
+	irq_context_count = 0;
+
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not unreserved.");
+
+	return status;
+}
+
+/**
+ * Take an IRQ context from the pool.
+ *
+ * The context must be returned with Irq_ReleaseContext. It is not unreserved,
+ * so it is ready for the next user.
+ *
+ * @param[out] irqContext   The context.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_AcquireContext(NiFpga_IrqContext* irqContext)
+{
+	uint32_t available;
+	uint32_t index;
+
+	do
+	{
+		available = irq_context_free;
+		if (available == 0)
+		{
+			printf("All the IRQ contexts are in use. Define a larger IRQ_CONTEXT_POOL_SIZE.\n");
+			return NiELVISIIIv10_Status_IrqContextPoolEmpty;
+		}
+		index = __builtin_ctz(available);
+	} while (!__sync_bool_compare_and_swap(&irq_context_free, available, available & ~((uint32_t)1 << index)));
+
+#if IRQ_CONTEXT_POOL_DEBUG
+	irq_context_owner[index] = __builtin_return_address(0);
+#endif
+
+	*irqContext = irq_context[index];
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Return an IRQ context to the pool.
+ *
+ * @param[in]  irqContext   A context returned by Irq_AcquireContext.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_ReleaseContext(NiFpga_IrqContext irqContext)
+{
+	uint32_t index;
+
+	/*
+	 * The pool has at most 32 contexts, so the lookup is bounded.
+	 */
+	for (index = 0; index < irq_context_count; ++index)
+	{
+		if (irq_context[index] == irqContext)
+		{
+			if (irq_context_free & ((uint32_t)1 << index))
+			{
+				printf("The IRQ context was released twice.\n");
+				return NiFpga_Status_InvalidParameter;
+			}
+			__sync_fetch_and_or(&irq_context_free, (uint32_t)1 << index);
+			return NiELVISIIIv10_Status_Success;
+		}
+	}
+
+	printf("The IRQ context does not belong to the pool.\n");
+
+	return NiFpga_Status_InvalidParameter;
+}
+
+/**
+ * Assert the cancel IRQ after one microsecond. It stays asserted until it is
+ * acknowledged, so a thread that is just about to wait also returns.
+ */
+static void Irq_AssertCancelIrq(void)
+{
+	NiFpga_WriteU32(NiELVISIIIv10_session, IRQTIMERWRITE, 1);
+	NiFpga_WriteBool(NiELVISIIIv10_session, IRQTIMERSETTIME, NiFpga_True);
+}
+
+/**
+ * Get the CLOCK_MONOTONIC time in milliseconds.
+ */
+static uint64_t Irq_WaitNow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * Wait until any of the IRQs occurs, the wait is cancelled, the thread is woken
+ * or the timeout ends.
+ *
+ * @param[in]  irqContext   Context of current IRQ
+ * @param[in]  irqs         Bitwise OR of the IRQs to wait on, or 0 to wait for a wake only
+ * @param[in]  timeout      Timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param[out] irqAssert    Bitwise OR of the IRQs that occurred, 0 if the thread was woken or timed out
+ * @param[in]  woken        The wake flag of the thread, or NULL if it cannot be woken
+ *
+ * @return NiELVISIIIv10_Status_Success, NiELVISIIIv10_Status_IrqWaitCancelled,
+ *         or the error of NiFpga_WaitOnIrqs.
+ */
+static int32_t Irq_WaitOrWake(NiFpga_IrqContext     irqContext,
+                              uint32_t              irqs,
+                              uint32_t              timeout,
+                              uint32_t*             irqAssert,
+                              volatile NiFpga_Bool* woken)
+{
+	NiFpga_Status status;
+	NiFpga_Bool   timedOut;
+	NiFpga_Bool   cancel;
+	uint64_t      deadline = 0;
+	uint32_t      limit;
+
+	*irqAssert = 0;
+
+	if (timeout != NiFpga_InfiniteTimeout)
+	{
+		deadline = Irq_WaitNow() + timeout;
+	}
+
+	do
 	{
-		do
+		/*
+		 * A cancel that came before the wait is seen here. A cancel that comes
+		 * after it asserts the cancel IRQ, which stays asserted until it is released.
+		 */
+		if (irq_cancelled)
+		{
+			return NiELVISIIIv10_Status_IrqWaitCancelled;
+		}
+
+		if (woken != NULL && *woken)
+		{
+			Irq_ClearWake(woken);
+			*irqAssert = 0;
+			return NiELVISIIIv10_Status_Success;
+		}
+
+		cancel = irq_cancel_reserved;
+		timedOut = NiFpga_False;
+		*irqAssert = 0;
+
+		/*
+		 * A wake does not raise an IRQ, so a thread that can be woken waits at
+		 * most IRQ_WAKE_POLL milliseconds at a time. Without the cancel IRQ,
+		 * wait at most IRQ_WAIT_POLL milliseconds at a time to check for a
+		 * cancel. Never wait past the timeout.
+		 */
+		limit = cancel ? NiFpga_InfiniteTimeout : IRQ_WAIT_POLL;
+		if (woken != NULL && (limit == NiFpga_InfiniteTimeout || limit > IRQ_WAKE_POLL))
 		{
-			if (irqNumber == pCurr->number)
+			limit = IRQ_WAKE_POLL;
+		}
+		if (timeout != NiFpga_InfiniteTimeout)
+		{
+			uint64_t now = Irq_WaitNow();
+
+			if (now >= deadline)
 			{
-				if (pCurr == reserved_irq_head)
-				{
-					reserved_irq_head = reserved_irq_head->pNext;
-				}
-				else
-				{
-					pPrev->pNext = pCurr->pNext;
-				}
-				free(pCurr);
 				return NiELVISIIIv10_Status_Success;
 			}
-			else
+			if (limit == NiFpga_InfiniteTimeout || deadline - now < limit)
 			{
-				pPrev = pCurr;
-				pCurr = pCurr->pNext;
+				limit = (uint32_t)(deadline - now);
 			}
-		} while (pCurr != NULL);
-	}
+		}
+
+		if (!cancel && irqs == 0)
+		{
+			/*
+			 * There is no IRQ to wait on. Sleep instead of waiting on an empty mask.
+			 */
+			struct timespec idle = { limit / 1000, (limit % 1000) * 1000000 };
+
+			nanosleep(&idle, NULL);
+			timedOut = NiFpga_True;
+		}
+		else
+		{
+			/*
+			 * This is a blocking function that stops the calling thread until the FPGA
+			 * asserts any IRQ in the number parameter, or until the function call times out.
+			 * Before calling this function, use NiFpga_ReserveIrqContext to reserve an
+			 * IRQ context. No other threads can use the same context when this function is
+			 * called. You can use the irqsAsserted parameter to determine which IRQs were
+			 * asserted for each function call.
+			 */
+			status = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
+			                           irqContext,
+			                           cancel ? (irqs | (1 << IRQ_CANCEL_IRQNO)) : irqs,
+			                           limit,
+			                           irqAssert,
+			                           &timedOut);
+			if (NiFpga_IsError(status))
+			{
+				return status;
+			}
+		}
+	} while (timedOut || (*irqAssert & irqs) == 0);
+
+	/*
+	 * Only report the cancel IRQ if it was waited on.
+	 */
+	*irqAssert &= irqs;
 
 	return NiELVISIIIv10_Status_Success;
 }
 
+/**
+ * Wait until any of the IRQs occurs or the wait is cancelled.
+ *
+ * If the cancel IRQ is reserved, the wait has no timeout and Irq_CancelWaits
+ * wakes it at once. Otherwise Irq_CancelWaits is noticed within IRQ_WAIT_POLL
+ * milliseconds.
+ *
+ * @param[in]  irqContext   Context of current IRQ
+ * @param[in]  irqs         Bitwise OR of the IRQs to wait on
+ * @param[out] irqAssert    Bitwise OR of the IRQs that occurred
+ *
+ * @return NiELVISIIIv10_Status_Success, NiELVISIIIv10_Status_IrqWaitCancelled,
+ *         or the error of NiFpga_WaitOnIrqs.
+ */
+int32_t Irq_WaitCancellable(NiFpga_IrqContext irqContext,
+                            uint32_t          irqs,
+                            uint32_t*         irqAssert)
+{
+	return Irq_WaitOrWake(irqContext, irqs, NiFpga_InfiniteTimeout, irqAssert, NULL);
+}
+
+/**
+ * Wait like Irq_WaitCancellable, and also return when another thread calls
+ * Irq_WakeWait with the same flag or when the timeout ends. Use it when the
+ * IRQs to wait on can change while the thread waits, or to stop one thread
+ * without cancelling the others.
+ *
+ * The wake is seen within IRQ_WAKE_POLL milliseconds. It does not raise the
+ * cancel IRQ, so it costs nothing to the other waiting threads.
+ *
+ * @param[in]  irqContext   Context of current IRQ
+ * @param[in]  irqs         Bitwise OR of the IRQs to wait on, or 0 to wait for a wake only
+ * @param[in]  timeout      Timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param[out] irqAssert    Bitwise OR of the IRQs that occurred, 0 if the thread was woken or timed out
+ * @param[in]  woken        The wake flag of the thread, NiFpga_False before the first wait
+ *
+ * @return NiELVISIIIv10_Status_Success, NiELVISIIIv10_Status_IrqWaitCancelled,
+ *         or the error of NiFpga_WaitOnIrqs.
+ */
+int32_t Irq_WaitWakeable(NiFpga_IrqContext     irqContext,
+                         uint32_t              irqs,
+                         uint32_t              timeout,
+                         uint32_t*             irqAssert,
+                         volatile NiFpga_Bool* woken)
+{
+	return Irq_WaitOrWake(irqContext, irqs, timeout, irqAssert, woken);
+}
+
+/**
+ * Make the Irq_WaitWakeable call of one thread return within IRQ_WAKE_POLL
+ * milliseconds, or its next call if it is not waiting. Several wakes before
+ * the thread returns count as one.
+ *
+ * @param[in]  woken   The wake flag passed to Irq_WaitWakeable.
+ */
+void Irq_WakeWait(volatile NiFpga_Bool* woken)
+{
+	*woken = NiFpga_True;
+	__sync_synchronize();
+}
+
+/**
+ * Take a wake that was requested with Irq_WakeWait and not taken yet.
+ * Irq_WaitWakeable takes its wake itself. Call it when the thread stopped
+ * without waiting again, so its next wait does not return at once.
+ *
+ * @param[in]  woken   The wake flag passed to Irq_WaitWakeable.
+ */
+void Irq_ClearWake(volatile NiFpga_Bool* woken)
+{
+	*woken = NiFpga_False;
+	__sync_synchronize();
+}
 
 /**
  * Wait until the specified IRQ number occurred or ready signal arrived.
  *
+ * Clear continueWaiting and call Irq_CancelWaits to stop the wait. If the
+ * cancel IRQ is reserved with Irq_ReserveCancelIrq, the wait returns at once;
+ * otherwise it returns within IRQ_WAIT_POLL milliseconds.
+ *
  * @param[in]  irqContext		Context of current IRQ
  * @param[in]  irqNumber      	IRQ number
  * @param[in]  irqAssert       	Asserted IRQ number
@@ -146,6 +561,23 @@ void Irq_Wait(NiFpga_IrqContext irqContext,
 		      NiFpga_Bool*      continueWaiting)
 {
 	NiFpga_Status status;
+	NiFpga_Bool   timedOut;
+
+	*irqAssert = 0;
+
+	/*
+	 * With the cancel IRQ reserved, wait without a timeout.
+	 */
+	if (irq_cancel_reserved && irqNumber != IRQ_CANCEL_IRQNO)
+	{
+		status = Irq_WaitCancellable(irqContext, 1 << irqNumber, irqAssert);
+		if (status == NiELVISIIIv10_Status_IrqWaitCancelled || *continueWaiting != NiFpga_True)
+		{
+			return;
+		}
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not enter the NiFpga_WaitOnIrqs().\n");
+		return;
+	}
 
 	/*
 	 * Break the infinite timeout up into an finite loop calling NiFpga_WaitOnIrqs() with
@@ -153,22 +585,14 @@ void Irq_Wait(NiFpga_IrqContext irqContext,
 	 */
 	do
 	{
-		/*
-		 * This is a blocking function that stops the calling thread until the FPGA
-		 * asserts any IRQ in the number parameter, or until the function call times out.
-		 * Before calling this function, use NiFpga_ReserveIrqContext to reserve an
-		 * IRQ context. No other threads can use the same context when this function is
-		 * called. You can use the irqsAsserted parameter to determine which IRQs were
-		 * asserted for each function call.
-		 *
-		 */
+		timedOut = NiFpga_False;
 		status = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
 				                   irqContext,
 				                   1 << irqNumber,
-								   100,  			/* break into infinite 100ms timeouts */
-								   irqAssert,
-								   NULL);
-	} while ((status == -NiFpga_Status_IrqTimeout) && *continueWaiting);
+				                   IRQ_WAIT_POLL,	/* break into infinite IRQ_WAIT_POLL timeouts */
+				                   irqAssert,
+				                   &timedOut);
+	} while (!NiFpga_IsError(status) && timedOut && *continueWaiting && !irq_cancelled);
 
 	/*
 	 * Check if the NiFpga_WaitOnIrqs() meet any error/warning except IrqTimeout.
@@ -181,6 +605,78 @@ void Irq_Wait(NiFpga_IrqContext irqContext,
 	return;
 }
 
+/**
+ * Reserve the timer IRQ to wake the waiting threads on cancellation.
+ *
+ * The FPGA cannot abort a wait, but the timer IRQ can be asserted by software.
+ * Once it is reserved, Irq_Wait, Irq_WaitCancellable and Irq_WaitWakeable wait
+ * on it too, with no timeout, so they do not wake up when idle and
+ * Irq_CancelWaits and Irq_WakeWait wake them at once. The timer IRQ cannot be used for anything else until it is released.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_ReserveCancelIrq(void)
+{
+	int32_t status;
+
+	status = Irq_AddReserved(Irq_Timer_0, IRQ_CANCEL_IRQNO);
+	if (status != NiELVISIIIv10_Status_Success)
+	{
+		printf("The timer interrupt is already registered, so the waits are cancelled by polling.\n");
+		return status;
+	}
+
+	irq_cancelled = NiFpga_False;
+	irq_cancel_reserved = NiFpga_True;
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Wake every waiting thread and make the waits return.
+ * The waits return until Irq_ReleaseCancelIrq is called.
+ */
+void Irq_CancelWaits(void)
+{
+	irq_cancelled = NiFpga_True;
+	__sync_synchronize();
+
+	if (irq_cancel_reserved)
+	{
+		Irq_AssertCancelIrq();
+	}
+}
+
+/**
+ * Release the timer IRQ reserved for cancellation and allow waiting again.
+ * Call it after the cancelled threads have stopped.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_ReleaseCancelIrq(void)
+{
+	int32_t status = NiELVISIIIv10_Status_Success;
+
+	if (irq_cancel_reserved)
+	{
+		irq_cancel_reserved = NiFpga_False;
+
+		/*
+		 * Disable the timer and clear the cancel IRQ if it was asserted.
+		 */
+		NiFpga_WriteU32(NiELVISIIIv10_session, IRQTIMERWRITE, 0);
+		NiFpga_WriteBool(NiELVISIIIv10_session, IRQTIMERSETTIME, NiFpga_True);
+		status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, 1 << IRQ_CANCEL_IRQNO);
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+
+		Irq_RemoveReserved(IRQ_CANCEL_IRQNO);
+	}
+
+	irq_cancelled = NiFpga_False;
+
+	return status;
+}
+
 
 /**
  * Acknowledges an IRQ or set of IRQs.
@@ -29,6 +29,56 @@ static const int32_t NiELVISIIIv10_Status_IrqChannelNotUsable = -363024;
  */
 static const int32_t NiELVISIIIv10_Status_IrqNumberNotUsable = -363025;
 
+/**
+ * The wait was cancelled by Irq_CancelWaits.
+ */
+static const int32_t NiELVISIIIv10_Status_IrqWaitCancelled = -363027;
+
+/**
+ * All the IRQ contexts of the pool are in use.
+ * Release the contexts that are not needed or define a larger IRQ_CONTEXT_POOL_SIZE.
+ */
+static const int32_t NiELVISIIIv10_Status_IrqContextPoolEmpty = -363028;
+
+/**
+ * The number of IRQ contexts reserved by NiELVISIIIv10_Open, at most 32.
+ */
+#if !defined(IRQ_CONTEXT_POOL_SIZE)
+#define IRQ_CONTEXT_POOL_SIZE 8
+#endif
+
+#if IRQ_CONTEXT_POOL_SIZE > 32
+#error "IRQ_CONTEXT_POOL_SIZE must not be larger than 32."
+#endif
+
+/**
+ * Record who acquired each IRQ context and report the contexts that are not
+ * released when the pool is destroyed. On unless NDEBUG is defined.
+ */
+#if !defined(IRQ_CONTEXT_POOL_DEBUG) && !defined(NDEBUG)
+#define IRQ_CONTEXT_POOL_DEBUG 1
+#endif
+
+/**
+ * The IRQ number of the FPGA timer. Irq_ReserveCancelIrq uses it to wake the waiting threads.
+ */
+#define IRQ_CANCEL_IRQNO 0
+
+/**
+ * How often a wait checks for cancellation when the cancel IRQ is not reserved, in milliseconds.
+ */
+#if !defined(IRQ_WAIT_POLL)
+#define IRQ_WAIT_POLL 100
+#endif
+
+/**
+ * How often Irq_WaitWakeable checks for Irq_WakeWait, in milliseconds.
+ * A wake does not use the cancel IRQ, which would wake every waiting thread.
+ */
+#if !defined(IRQ_WAKE_POLL)
+#define IRQ_WAKE_POLL 10
+#endif
+
 #if NiFpga_Cpp
 extern "C" {
 #endif
@@ -51,31 +101,41 @@ typedef enum
     Irq_Timer_0  = 7,     /* Timer Interrupt*/
 } Irq_Channel;
 
-/**
- * Linker structure to store the reserved IRQ resources.
- */
-typedef struct ReservedIrq
-{
-    Irq_Channel         channel;            /* Channel supported by IRQ */
-    uint8_t             number;             /* IRQ number */
-    struct ReservedIrq* pNext;              /* Pointer to next node */
-} ReservedIrq, *ReservedIrqPointer;
-
 /**
  * Check whether the channel and IRQ number are already reserved.
  */
 int32_t Irq_CheckReserved(Irq_Channel channel, uint8_t irqNumber);
 
 /**
-  * Add a new node into the reserved IRQ resource list.
+ * Reserve a channel and an IRQ number in one atomic step.
  */
 int32_t Irq_AddReserved(Irq_Channel channel, uint8_t irqNumber);
 
 /**
- * Remove the node in the resource list.
+ * Release an IRQ number and the channel reserved with it.
  */
 int32_t Irq_RemoveReserved(uint8_t irqNumber);
 
+/**
+ * Reserve the IRQ contexts of the pool. Called by NiELVISIIIv10_Open.
+ */
+int32_t Irq_CreateContextPool(void);
+
+/**
+ * Unreserve the IRQ contexts of the pool. Called by NiELVISIIIv10_Close.
+ */
+int32_t Irq_DestroyContextPool(void);
+
+/**
+ * Take an IRQ context from the pool.
+ */
+int32_t Irq_AcquireContext(NiFpga_IrqContext* irqContext);
+
+/**
+ * Return an IRQ context to the pool.
+ */
+int32_t Irq_ReleaseContext(NiFpga_IrqContext irqContext);
+
 /**
  * Wait until the specified IRQ number occurred or ready signal arrived.
  */
@@ -84,6 +144,48 @@ void Irq_Wait(NiFpga_IrqContext irqContext,
 		      uint32_t*         irqAssert,
 		      NiFpga_Bool*      continueWaiting);
 
+/**
+ * Wait until any of the IRQs occurs or the wait is cancelled.
+ */
+int32_t Irq_WaitCancellable(NiFpga_IrqContext irqContext,
+                            uint32_t          irqs,
+                            uint32_t*         irqAssert);
+
+/**
+ * Wait until any of the IRQs occurs, the wait is cancelled, Irq_WakeWait is called or the timeout ends.
+ */
+int32_t Irq_WaitWakeable(NiFpga_IrqContext     irqContext,
+                         uint32_t              irqs,
+                         uint32_t              timeout,
+                         uint32_t*             irqAssert,
+                         volatile NiFpga_Bool* woken);
+
+/**
+ * Make the Irq_WaitWakeable call of one thread return.
+ */
+void Irq_WakeWait(volatile NiFpga_Bool* woken);
+
+/**
+ * Take a wake that was requested with Irq_WakeWait and not taken yet.
+ */
+void Irq_ClearWake(volatile NiFpga_Bool* woken);
+
+/**
+ * Reserve the timer IRQ to wake the waiting threads on cancellation.
+ * The cancel IRQ wakes every waiting thread, so it is only used by Irq_CancelWaits.
+ */
+int32_t Irq_ReserveCancelIrq(void);
+
+/**
+ * Wake every waiting thread and make the waits return.
+ */
+void Irq_CancelWaits(void);
+
+/**
+ * Release the timer IRQ reserved for cancellation and allow waiting again.
+ */
+int32_t Irq_ReleaseCancelIrq(void);
+
 /**
  * Acknowledge the IRQ(s).
  */
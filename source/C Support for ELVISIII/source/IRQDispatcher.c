@@ -0,0 +1,470 @@
+/**
+ * NI ELVIS III FPGA IRQ dispatcher source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "IRQDispatcher.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+/**
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t Irq_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Deliver the IRQs returned by one wait to their callbacks and queues.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqAssert    The asserted IRQs.
+ * @param[in]  timestamp    Time at which the wait returned.
+ */
+static void Irq_Dispatch(Irq_Dispatcher* dispatcher, uint32_t irqAssert, uint64_t timestamp)
+{
+	Irq_Event event;
+	uint32_t  pending = irqAssert;
+	uint8_t   irqNumber;
+
+	event.timestamp = timestamp;
+
+	while (pending != 0)
+	{
+		Irq_DispatchEntry* entry;
+
+		irqNumber = (uint8_t)__builtin_ctz(pending);
+		pending &= pending - 1;
+		entry = &dispatcher->entry[irqNumber];
+
+		/*
+		 * Announce the handler before checking that it is still registered, so
+		 * Irq_RemoveDispatch can wait for it to finish.
+		 */
+		dispatcher->dispatching = irqNumber + 1;
+		__sync_synchronize();
+		if (dispatcher->irqMask & (1 << irqNumber))
+		{
+			event.irqNumber = irqNumber;
+			event.count     = __sync_add_and_fetch(&entry->count, 1);
+
+			if (entry->callback != NULL)
+			{
+				entry->callback(&event, entry->data);
+			}
+			if (entry->queue != NULL)
+			{
+				SpscRing_Push(entry->queue, &event);
+			}
+		}
+		dispatcher->dispatching = 0;
+	}
+}
+
+/**
+ * The dispatcher thread.
+ * Waits on the OR of all registered IRQs with one context, delivers the IRQs
+ * received and acknowledges all of them with one call.
+ *
+ * @param[in]  resource   The dispatcher.
+ */
+static void* Irq_DispatcherThread(void* resource)
+{
+	Irq_Dispatcher* dispatcher = (Irq_Dispatcher*)resource;
+	NiFpga_Status   status;
+	uint32_t        irqMask;
+	uint32_t        timeout;
+	uint32_t        irqAssert;
+	uint32_t        deferred;
+	uint64_t        wakeup;
+
+	while (dispatcher->running)
+	{
+		/*
+		 * Deferred IRQs stay asserted until the consumer acknowledges them,
+		 * so they are left out of the wait until then.
+		 */
+		irqMask = dispatcher->irqMask & ~dispatcher->heldMask;
+
+		/*
+		 * While an IRQ is held, wait IRQ_DISPATCH_HELD_POLL milliseconds at a
+		 * time, so an acknowledged IRQ is waited on again without a wake.
+		 * Otherwise wait without a timeout. Irq_StopDispatcher wakes the thread
+		 * to stop it, and a new IRQ wakes it to wait on the new mask, within
+		 * IRQ_WAKE_POLL milliseconds.
+		 */
+		timeout = (dispatcher->heldMask != 0) ? IRQ_DISPATCH_HELD_POLL : NiFpga_InfiniteTimeout;
+		status = Irq_WaitWakeable(dispatcher->irqContext, irqMask, timeout, &irqAssert, &dispatcher->woken);
+		if (status == NiELVISIIIv10_Status_IrqWaitCancelled)
+		{
+			break;
+		}
+		if (NiFpga_IsError(status))
+		{
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not enter the NiFpga_WaitOnIrqs().\n");
+			continue;
+		}
+
+		irqAssert &= irqMask;
+		if (irqAssert == 0)
+		{
+			continue;
+		}
+
+		wakeup = Irq_Now();
+		++dispatcher->wakeups;
+
+		deferred = irqAssert & dispatcher->deferMask;
+		if (deferred != 0)
+		{
+			__sync_fetch_and_or(&dispatcher->heldMask, deferred);
+		}
+
+		Irq_Dispatch(dispatcher, irqAssert, wakeup);
+
+		/*
+		 * Acknowledge every IRQ received by this wait at once.
+		 */
+		if ((irqAssert & ~deferred) != 0)
+		{
+			status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, irqAssert & ~deferred);
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+		}
+
+		Thread_CheckOverrun(&dispatcher->stats, Irq_Now() - wakeup, IRQ_DISPATCH_BUDGET);
+	}
+
+	return NULL;
+}
+
+/**
+ * Set where an IRQ is delivered and add it to the dispatcher mask.
+ */
+static int32_t Irq_SetDispatch(Irq_Dispatcher* dispatcher,
+                               uint8_t         irqNumber,
+                               Irq_Callback    callback,
+                               void*           data,
+                               SpscRing*       queue)
+{
+	Irq_DispatchEntry* entry;
+
+	if (irqNumber >= IRQ_DISPATCH_NUM)
+	{
+		printf("The specified IRQ Number is out of range.\n");
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	if (dispatcher->irqMask & (1 << irqNumber))
+	{
+		printf("You have already registered a handler with the same interrupt number.\n");
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	entry = &dispatcher->entry[irqNumber];
+	entry->callback = callback;
+	entry->data     = data;
+	entry->queue    = queue;
+	entry->count    = 0;
+
+	/*
+	 * Publish the entry before the dispatcher thread can see the IRQ number,
+	 * then wake the dispatcher so it waits on it within IRQ_WAKE_POLL
+	 * milliseconds. A dispatcher that is not started yet reads the mask at
+	 * its first wait.
+	 */
+	__sync_fetch_and_or(&dispatcher->irqMask, (uint32_t)1 << irqNumber);
+	if (dispatcher->running)
+	{
+		Irq_WakeWait(&dispatcher->woken);
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Remove all the IRQs of a dispatcher.
+ * Call it once before the IRQs are set with Irq_SetCallback or Irq_SetQueue,
+ * which can be called before or after the dispatcher is started.
+ *
+ * @param[in]  dispatcher   The dispatcher to initialize.
+ */
+void Irq_InitDispatcher(Irq_Dispatcher* dispatcher)
+{
+	memset(dispatcher, 0, sizeof(Irq_Dispatcher));
+}
+
+/**
+ * Take an IRQ context from the pool and start the dispatcher thread.
+ * The thread runs with SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+ *
+ * @param[in]  dispatcher   The dispatcher to start.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_StartDispatcher(Irq_Dispatcher* dispatcher)
+{
+	Thread_Config config;
+
+	Thread_InitConfig(&config, THREAD_IRQ_PRIORITY);
+
+	return Irq_StartDispatcherWithConfig(dispatcher, &config);
+}
+
+/**
+ * Take an IRQ context from the pool and start the dispatcher thread with a thread configuration.
+ *
+ * The dispatcher must be initialized with Irq_InitDispatcher. The IRQs already
+ * set are kept, so they can be set before the thread starts. The IRQs must still
+ * be configured with the Register function of each IRQ IO. They take their own
+ * IRQ context from the pool; the context of the dispatcher is only used by the
+ * dispatcher to wait.
+ *
+ * @param[in]  dispatcher   The dispatcher to start.
+ * @param[in]  config       How the dispatcher thread is scheduled. Its stats are
+ *                          replaced by the stats of the dispatcher.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_StartDispatcherWithConfig(Irq_Dispatcher* dispatcher, const Thread_Config* config)
+{
+	Thread_Config threadConfig = *config;
+	int32_t       status;
+
+	/*
+	 * Clear the state of a previous run only. The entries and the masks of the
+	 * IRQs set so far are kept.
+	 */
+	dispatcher->heldMask    = 0;
+	dispatcher->dispatching = 0;
+	dispatcher->wakeups     = 0;
+	memset(&dispatcher->stats, 0, sizeof(Thread_Stats));
+	Irq_ClearWake(&dispatcher->woken);
+
+	/*
+	 * Take the only IRQ context used to wait.
+	 */
+	status = Irq_AcquireContext(&dispatcher->irqContext);
+	if (NiFpga_IsError(status))
+	{
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not acquired.");
+		return status;
+	}
+
+	dispatcher->running = NiFpga_True;
+
+	threadConfig.stats = &dispatcher->stats;
+	status = Thread_Create(&dispatcher->thread, &threadConfig, Irq_DispatcherThread, dispatcher);
+	if (status != 0)
+	{
+		printf("Failed to create the IRQ dispatcher thread!\n");
+		dispatcher->running = NiFpga_False;
+		Irq_ReleaseContext(dispatcher->irqContext);
+		return status;
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Stop the dispatcher thread and return its IRQ context to the pool.
+ * The thread is woken to stop, so other threads that wait on IRQs are not
+ * cancelled. Its page faults and overruns are then in the stats of the dispatcher.
+ *
+ * @param[in]  dispatcher   The dispatcher to stop.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_StopDispatcher(Irq_Dispatcher* dispatcher)
+{
+	int32_t status;
+
+	dispatcher->running = NiFpga_False;
+	Irq_WakeWait(&dispatcher->woken);
+	pthread_join(dispatcher->thread, NULL);
+
+	/*
+	 * The thread did not take the wake if it stopped on a cancel.
+	 */
+	Irq_ClearWake(&dispatcher->woken);
+
+	status = Irq_ReleaseContext(dispatcher->irqContext);
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
+
+	return status;
+}
+
+/**
+ * Call a function every time an IRQ is received.
+ * The function runs on the dispatcher thread, so it should return quickly.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ * @param[in]  callback     Function to call.
+ * @param[in]  data         Passed to callback.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_SetCallback(Irq_Dispatcher* dispatcher, uint8_t irqNumber, Irq_Callback callback, void* data)
+{
+	return Irq_SetDispatch(dispatcher, irqNumber, callback, data, NULL);
+}
+
+/**
+ * Push an Irq_Event to a ring every time an IRQ is received.
+ * The dispatcher thread is the only producer of the ring. If the ring is full
+ * the event is counted in the dropped counter of the ring.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ * @param[in]  queue        Ring initialized with elements of sizeof(Irq_Event).
+ *
+ * @return the configure status.
+ */
+int32_t Irq_SetQueue(Irq_Dispatcher* dispatcher, uint8_t irqNumber, SpscRing* queue)
+{
+	return Irq_SetDispatch(dispatcher, irqNumber, NULL, NULL, queue);
+}
+
+/**
+ * Stop delivering an IRQ.
+ * When this function returns, the callback of the IRQ is not running and will
+ * not be called again. A deferred IRQ that is still held is acknowledged, so
+ * it is not left asserted when the IRQ is set again.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_RemoveDispatch(Irq_Dispatcher* dispatcher, uint8_t irqNumber)
+{
+	int32_t status = NiELVISIIIv10_Status_Success;
+
+	if (irqNumber >= IRQ_DISPATCH_NUM)
+	{
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	__sync_fetch_and_and(&dispatcher->irqMask, ~((uint32_t)1 << irqNumber));
+	__sync_fetch_and_and(&dispatcher->deferMask, ~((uint32_t)1 << irqNumber));
+
+	/*
+	 * Wait for a handler that had already started.
+	 */
+	while (dispatcher->dispatching == (uint32_t)irqNumber + 1)
+	{
+		sched_yield();
+	}
+
+	/*
+	 * The IRQ is no longer waited on, so the held bit can be cleared before
+	 * the acknowledgment. Taking it makes the acknowledgment happen once.
+	 */
+	if (__sync_fetch_and_and(&dispatcher->heldMask, ~((uint32_t)1 << irqNumber)) & ((uint32_t)1 << irqNumber))
+	{
+		status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, (uint32_t)1 << irqNumber);
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+	}
+
+	return status;
+}
+
+/**
+ * Leave the acknowledgment of an IRQ to the consumer.
+ *
+ * By default the dispatcher acknowledges an IRQ as soon as it is delivered.
+ * A deferred IRQ is not acknowledged, and is not waited on again, until the
+ * consumer calls Irq_AcknowledgeDeferred. Use it when the FPGA must not raise
+ * the IRQ again before the consumer has handled it.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_DeferAcknowledge(Irq_Dispatcher* dispatcher, uint8_t irqNumber)
+{
+	if (irqNumber >= IRQ_DISPATCH_NUM)
+	{
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	__sync_fetch_and_or(&dispatcher->deferMask, (uint32_t)1 << irqNumber);
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Acknowledge a deferred IRQ and wait for it again.
+ * The dispatcher waits on the IRQ again within IRQ_DISPATCH_HELD_POLL
+ * milliseconds. It is not woken, so the other threads that wait on IRQs are
+ * not disturbed.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_AcknowledgeDeferred(Irq_Dispatcher* dispatcher, uint8_t irqNumber)
+{
+	int32_t status = NiELVISIIIv10_Status_Success;
+
+	if (irqNumber >= IRQ_DISPATCH_NUM)
+	{
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	if (dispatcher->heldMask & (1 << irqNumber))
+	{
+		status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, (uint32_t)1 << irqNumber);
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+
+		__sync_fetch_and_and(&dispatcher->heldMask, ~((uint32_t)1 << irqNumber));
+	}
+
+	return status;
+}
+
+/**
+ * Get the number of times an IRQ was received.
+ *
+ * @param[in]  dispatcher   The dispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ *
+ * @return the number of times the IRQ was received since it was set.
+ */
+uint32_t Irq_GetDispatchCount(const Irq_Dispatcher* dispatcher, uint8_t irqNumber)
+{
+	if (irqNumber >= IRQ_DISPATCH_NUM)
+	{
+		return 0;
+	}
+
+	return dispatcher->entry[irqNumber].count;
+}
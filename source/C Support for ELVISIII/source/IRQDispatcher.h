@@ -0,0 +1,143 @@
+/**
+ * IRQDispatcher.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef IRQDispatcher_h_
+#define IRQDispatcher_h_
+
+#include <pthread.h>
+#include "NiELVISIIIv10.h"
+#include "IRQConfigure.h"
+#include "SpscRing.h"
+#include "ThreadConfig.h"
+
+/**
+ * The number of IRQs the FPGA interface supports.
+ */
+#define IRQ_DISPATCH_NUM 32
+
+/**
+ * How long the dispatcher may take to deliver and acknowledge the IRQs of one wait, in nanoseconds.
+ * Longer deliveries are counted as overruns in the statistics of the dispatcher thread.
+ */
+#if !defined(IRQ_DISPATCH_BUDGET)
+#define IRQ_DISPATCH_BUDGET 100000
+#endif
+
+/**
+ * How long the dispatcher waits at a time while a deferred IRQ is held, in milliseconds.
+ * An IRQ acknowledged with Irq_AcknowledgeDeferred is waited on again within this time.
+ */
+#if !defined(IRQ_DISPATCH_HELD_POLL)
+#define IRQ_DISPATCH_HELD_POLL 1
+#endif
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/*
+ * An IRQ received by the dispatcher.
+ */
+typedef struct
+{
+	uint64_t timestamp;   /* CLOCK_MONOTONIC time at which the wait returned, in nanoseconds */
+	uint32_t count;       /* Number of times this IRQ was received, including this one */
+	uint8_t  irqNumber;   /* IRQ number */
+} Irq_Event;
+
+/*
+ * Function called by the dispatcher thread when an IRQ is received.
+ * The IRQ is acknowledged after the callbacks of all the IRQs received together return,
+ * unless it is deferred with Irq_DeferAcknowledge.
+ */
+typedef void (*Irq_Callback)(const Irq_Event* event, void* data);
+
+/*
+ * Where one IRQ number is delivered.
+ */
+typedef struct
+{
+	Irq_Callback      callback;    /* Function to call, or NULL */
+	void*             data;        /* Passed to callback */
+	SpscRing*         queue;       /* Ring of Irq_Event to push to, or NULL */
+	volatile uint32_t count;       /* Number of times the IRQ was received */
+} Irq_DispatchEntry;
+
+/**
+ * One thread and one IRQ context that wait on all registered IRQs at once.
+ */
+typedef struct
+{
+	NiFpga_IrqContext  irqContext;     /* Context taken from the pool for the dispatcher thread */
+	pthread_t          thread;         /* Dispatcher thread */
+	volatile uint32_t  irqMask;        /* Bitwise OR of the registered IRQ numbers */
+	volatile uint32_t  deferMask;      /* IRQs acknowledged by Irq_AcknowledgeDeferred instead of the dispatcher */
+	volatile uint32_t  heldMask;       /* Deferred IRQs received and not acknowledged yet */
+	volatile uint32_t  dispatching;    /* IRQ number + 1 whose handler is running, or 0 */
+	volatile NiFpga_Bool running;      /* Cleared to stop the dispatcher thread */
+	volatile NiFpga_Bool woken;        /* Wake flag of the dispatcher thread, see Irq_WakeWait */
+	volatile uint32_t  wakeups;        /* Number of waits that returned IRQs */
+	Thread_Stats       stats;          /* Page faults and overruns, filled when the thread stops */
+	Irq_DispatchEntry  entry[IRQ_DISPATCH_NUM];
+} Irq_Dispatcher;
+
+/**
+ * Remove all the IRQs of a dispatcher.
+ */
+void Irq_InitDispatcher(Irq_Dispatcher* dispatcher);
+
+/**
+ * Take an IRQ context from the pool and start the dispatcher thread.
+ */
+int32_t Irq_StartDispatcher(Irq_Dispatcher* dispatcher);
+
+/**
+ * Take an IRQ context from the pool and start the dispatcher thread with a thread configuration.
+ */
+int32_t Irq_StartDispatcherWithConfig(Irq_Dispatcher* dispatcher, const Thread_Config* config);
+
+/**
+ * Stop the dispatcher thread and return its IRQ context to the pool.
+ */
+int32_t Irq_StopDispatcher(Irq_Dispatcher* dispatcher);
+
+/**
+ * Call a function every time an IRQ is received.
+ */
+int32_t Irq_SetCallback(Irq_Dispatcher* dispatcher, uint8_t irqNumber, Irq_Callback callback, void* data);
+
+/**
+ * Push an Irq_Event to a ring every time an IRQ is received.
+ */
+int32_t Irq_SetQueue(Irq_Dispatcher* dispatcher, uint8_t irqNumber, SpscRing* queue);
+
+/**
+ * Stop delivering an IRQ.
+ */
+int32_t Irq_RemoveDispatch(Irq_Dispatcher* dispatcher, uint8_t irqNumber);
+
+/**
+ * Leave the acknowledgment of an IRQ to the consumer.
+ */
+int32_t Irq_DeferAcknowledge(Irq_Dispatcher* dispatcher, uint8_t irqNumber);
+
+/**
+ * Acknowledge a deferred IRQ and wait for it again.
+ */
+int32_t Irq_AcknowledgeDeferred(Irq_Dispatcher* dispatcher, uint8_t irqNumber);
+
+/**
+ * Get the number of times an IRQ was received.
+ */
+uint32_t Irq_GetDispatchCount(const Irq_Dispatcher* dispatcher, uint8_t irqNumber);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* IRQDispatcher_h_ */
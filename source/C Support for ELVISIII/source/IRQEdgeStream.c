@@ -0,0 +1,464 @@
+/**
+ * NI ELVIS III debounced DI and button edge stream source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "IRQEdgeStream.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+/**
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t Irq_EdgeNow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Decide whether a sampled level is a new edge and push it to the ring.
+ *
+ * An edge is accepted at once and starts the debounce time of its input.
+ * Edges during the debounce time are counted as bounces, and the input is
+ * sampled again when the debounce time ends, so a level that settles
+ * differently from the accepted edge is not lost.
+ *
+ * @param[in]  stream     The edge stream.
+ * @param[in]  index      Index of the input.
+ * @param[in]  level      Level sampled from the input register.
+ * @param[in]  now        IRQTIMERREAD value when the level was sampled.
+ * @param[in]  asserted   NiFpga_True if the IRQ of the input was received.
+ */
+static void Irq_EdgeSampled(Irq_EdgeStream* stream, uint8_t index, uint8_t level, uint32_t now, NiFpga_Bool asserted)
+{
+	Irq_EdgeInput* input = &stream->input[index];
+	Irq_EdgeEvent  event;
+
+	/*
+	 * The difference is signed so the comparison still works when IRQTIMERREAD
+	 * wraps around. It is only made while the debounce time runs, because it
+	 * is wrong once the input has been quiet for more than 2^31 microseconds.
+	 */
+	if (input->locked && (int32_t)(now - input->lockoutEnd) < 0)
+	{
+		if (input->bounces < 0xFFFF)
+		{
+			++input->bounces;
+		}
+		input->pending = NiFpga_True;
+		return;
+	}
+
+	input->locked  = NiFpga_False;
+	input->pending = NiFpga_False;
+	if (level == input->level)
+	{
+		/*
+		 * The pulse that raised the IRQ was over before the input was sampled.
+		 */
+		if (asserted)
+		{
+			++stream->missed;
+		}
+		return;
+	}
+
+	event.timestamp = now;
+	event.input     = index;
+	event.level     = level;
+	event.bounces   = input->bounces;
+
+	/*
+	 * The level is followed even when the ring is full. The lost event is
+	 * counted in the dropped counter of the ring.
+	 */
+	SpscRing_Push(stream->queue, &event);
+
+	input->level      = level;
+	input->bounces    = 0;
+	input->locked     = (input->debounce != 0);
+	input->lockoutEnd = now + input->debounce;
+	++input->edges;
+}
+
+/**
+ * Sample the inputs whose IRQ was received or whose debounce time has ended.
+ * Each input register is read at most once.
+ *
+ * @param[in]  stream      The edge stream.
+ * @param[in]  irqAssert   The asserted IRQs, or 0.
+ * @param[in]  now         IRQTIMERREAD value read after the wait returned.
+ */
+static void Irq_SampleInputs(Irq_EdgeStream* stream, uint32_t irqAssert, uint32_t now)
+{
+	NiFpga_Status status     = NiFpga_Status_Success;
+	NiFpga_Bool   readDio    = NiFpga_False;
+	NiFpga_Bool   readButton = NiFpga_False;
+	uint32_t      dio        = 0;
+	uint8_t       button     = 0;
+	uint8_t       level;
+	uint8_t       i;
+
+	for (i = 0; i < stream->inputCount; ++i)
+	{
+		Irq_EdgeInput* input    = &stream->input[i];
+		NiFpga_Bool    asserted = (irqAssert & ((uint32_t)1 << input->irqNumber)) != 0;
+		NiFpga_Bool    ended    = input->locked && (int32_t)(now - input->lockoutEnd) >= 0;
+		NiFpga_Bool    expired  = input->pending && ended;
+
+		/*
+		 * End the debounce time while it can still be compared with IRQTIMERREAD.
+		 */
+		if (ended)
+		{
+			input->locked = NiFpga_False;
+		}
+
+		if (!asserted && !expired)
+		{
+			continue;
+		}
+
+		if (input->channel == Irq_Button_0)
+		{
+			if (!readButton)
+			{
+				NiFpga_MergeStatus(&status, NiFpga_ReadU8(NiELVISIIIv10_session, DIBTN, &button));
+				readButton = NiFpga_True;
+			}
+			level = button & 1;
+		}
+		else
+		{
+			if (!readDio)
+			{
+				NiFpga_MergeStatus(&status, NiFpga_ReadU32(NiELVISIIIv10_session, IRQ_EDGE_DIO_A_IN, &dio));
+				readDio = NiFpga_True;
+			}
+			level = (dio >> (input->channel - Irq_Dio_A0)) & 1;
+		}
+
+		if (NiFpga_IsError(status))
+		{
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not read the input of an edge stream.");
+			return;
+		}
+
+		Irq_EdgeSampled(stream, i, level, now, asserted);
+	}
+}
+
+/**
+ * Get how long the stream thread can wait before a debounce time ends.
+ * The thread also wakes when no edge was ignored, so the debounce time is ended
+ * long before IRQTIMERREAD comes back around to it.
+ *
+ * @param[in]  stream   The edge stream.
+ * @param[in]  now      IRQTIMERREAD value.
+ *
+ * @return the timeout in milliseconds, or NiFpga_InfiniteTimeout if no debounce time is running.
+ */
+static uint32_t Irq_EdgeTimeout(const Irq_EdgeStream* stream, uint32_t now)
+{
+	uint32_t timeout = NiFpga_InfiniteTimeout;
+	uint32_t i;
+
+	for (i = 0; i < stream->inputCount; ++i)
+	{
+		const Irq_EdgeInput* input = &stream->input[i];
+		int32_t              remaining;
+		uint32_t             milliseconds;
+
+		if (!input->locked)
+		{
+			continue;
+		}
+
+		remaining    = (int32_t)(input->lockoutEnd - now);
+		milliseconds = (remaining <= 0) ? 0 : ((uint32_t)remaining + 999) / 1000;
+		if (milliseconds < timeout)
+		{
+			timeout = milliseconds;
+		}
+	}
+
+	return timeout;
+}
+
+/**
+ * The stream thread.
+ * Waits on the IRQs of all the inputs with one context, reads IRQTIMERREAD and
+ * the input registers as soon as the wait returns, and acknowledges the IRQs.
+ *
+ * @param[in]  resource   The edge stream.
+ */
+static void* Irq_EdgeStreamThread(void* resource)
+{
+	Irq_EdgeStream* stream = (Irq_EdgeStream*)resource;
+	NiFpga_Status   status;
+	uint32_t        irqAssert;
+	uint32_t        now;
+	uint64_t        wakeup;
+
+	while (stream->running)
+	{
+		/*
+		 * Sample the inputs whose debounce time has ended before waiting again.
+		 */
+		NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &now);
+		Irq_SampleInputs(stream, 0, now);
+
+		/*
+		 * Wait until a debounce time ends, or without a timeout if none is
+		 * running. Irq_StopEdgeStream wakes the thread to stop it within
+		 * IRQ_WAKE_POLL milliseconds.
+		 */
+		status = Irq_WaitWakeable(stream->irqContext,
+		                          stream->irqMask,
+		                          Irq_EdgeTimeout(stream, now),
+		                          &irqAssert,
+		                          &stream->woken);
+		if (status == NiELVISIIIv10_Status_IrqWaitCancelled)
+		{
+			break;
+		}
+		if (NiFpga_IsError(status))
+		{
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not enter the NiFpga_WaitOnIrqs().\n");
+			continue;
+		}
+
+		irqAssert &= stream->irqMask;
+		if (irqAssert == 0)
+		{
+			continue;
+		}
+
+		/*
+		 * Read the FPGA timer first, so the timestamp is as close to the edge as possible.
+		 */
+		NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &now);
+		wakeup = Irq_EdgeNow();
+
+		Irq_SampleInputs(stream, irqAssert, now);
+
+		status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, irqAssert);
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+
+		Thread_CheckOverrun(&stream->stats, Irq_EdgeNow() - wakeup, IRQ_EDGE_BUDGET);
+	}
+
+	return NULL;
+}
+
+/**
+ * Attach a ring to an edge stream and remove all its inputs.
+ *
+ * @param[in]  stream   The edge stream to initialize.
+ * @param[in]  queue    Ring initialized with elements of sizeof(Irq_EdgeEvent).
+ *
+ * @return the configure status.
+ */
+int32_t Irq_InitEdgeStream(Irq_EdgeStream* stream, SpscRing* queue)
+{
+	if (queue == NULL || queue->elementSize != sizeof(Irq_EdgeEvent))
+	{
+		printf("The ring of an edge stream must hold Irq_EdgeEvent elements.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	memset(stream, 0, sizeof(Irq_EdgeStream));
+	stream->queue = queue;
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Follow the edges of a DI or button input.
+ * Add the inputs before Irq_StartEdgeStream. The IRQ must still be configured
+ * with Irq_RegisterDiIrq or Irq_RegisterButtonIrq, preferably for both edges
+ * so the stream sees every change of level.
+ *
+ * @param[in]  stream      The edge stream.
+ * @param[in]  channel     Irq_Dio_A0 to Irq_Dio_A3 or Irq_Button_0.
+ * @param[in]  irqNumber   IRQ number configured for the channel.
+ * @param[in]  debounce    Edges closer than this to the previous edge are ignored, in microseconds. 0 disables debouncing.
+ * @param[out] input       Index of the input in the events, or NULL.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_AddEdgeInput(Irq_EdgeStream* stream,
+                         Irq_Channel     channel,
+                         uint8_t         irqNumber,
+                         uint32_t        debounce,
+                         uint8_t*        input)
+{
+	Irq_EdgeInput* entry;
+
+	if (stream->running || stream->inputCount >= IRQ_EDGE_INPUTS)
+	{
+		printf("No more inputs can be added to the edge stream.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	if ((channel < Irq_Dio_A0 || channel > Irq_Dio_A3) && channel != Irq_Button_0)
+	{
+		printf("The edge stream only follows DI and button inputs.\n");
+		return NiELVISIIIv10_Status_IrqChannelNotUsable;
+	}
+
+	if (irqNumber < IRQNO_MIN || irqNumber > IRQNO_MAX || (stream->irqMask & ((uint32_t)1 << irqNumber)))
+	{
+		printf("The specified IRQ Number is out of range or already used by the edge stream.\n");
+		return NiELVISIIIv10_Status_IrqNumberNotUsable;
+	}
+
+	entry = &stream->input[stream->inputCount];
+	entry->channel   = channel;
+	entry->irqNumber = irqNumber;
+	entry->debounce  = debounce;
+
+	if (input != NULL)
+	{
+		*input = (uint8_t)stream->inputCount;
+	}
+
+	++stream->inputCount;
+	stream->irqMask |= (uint32_t)1 << irqNumber;
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Take an IRQ context from the pool and start the stream thread.
+ * The current levels of the inputs are read first, so the first events are
+ * real edges.
+ *
+ * @param[in]  stream   The edge stream to start.
+ * @param[in]  config   How the stream thread is scheduled, or NULL for SCHED_FIFO
+ *                      at THREAD_IRQ_PRIORITY. Its stats are replaced by the stats of the stream.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_StartEdgeStream(Irq_EdgeStream* stream, const Thread_Config* config)
+{
+	Thread_Config threadConfig;
+	NiFpga_Status status = NiFpga_Status_Success;
+	uint32_t      dio    = 0;
+	uint8_t       button = 0;
+	uint32_t      now    = 0;
+	uint32_t      i;
+
+	if (stream->inputCount == 0)
+	{
+		printf("Add inputs to the edge stream before starting it.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	if (config != NULL)
+	{
+		threadConfig = *config;
+	}
+	else
+	{
+		Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+	}
+
+	NiFpga_MergeStatus(&status, NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &now));
+	NiFpga_MergeStatus(&status, NiFpga_ReadU32(NiELVISIIIv10_session, IRQ_EDGE_DIO_A_IN, &dio));
+	NiFpga_MergeStatus(&status, NiFpga_ReadU8(NiELVISIIIv10_session, DIBTN, &button));
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not read the inputs of the edge stream.");
+	if (NiFpga_IsError(status))
+	{
+		return status;
+	}
+
+	for (i = 0; i < stream->inputCount; ++i)
+	{
+		Irq_EdgeInput* input = &stream->input[i];
+
+		input->level      = (input->channel == Irq_Button_0) ? (button & 1) : ((dio >> (input->channel - Irq_Dio_A0)) & 1);
+		input->locked     = NiFpga_False;
+		input->pending    = NiFpga_False;
+		input->lockoutEnd = now;
+		input->bounces    = 0;
+		input->edges      = 0;
+	}
+	stream->missed = 0;
+
+	/*
+	 * Take the only IRQ context used to wait.
+	 */
+	status = Irq_AcquireContext(&stream->irqContext);
+	if (NiFpga_IsError(status))
+	{
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not acquired.");
+		return status;
+	}
+
+	stream->running = NiFpga_True;
+
+	threadConfig.stats = &stream->stats;
+	status = Thread_Create(&stream->thread, &threadConfig, Irq_EdgeStreamThread, stream);
+	if (status != 0)
+	{
+		printf("Failed to create the edge stream thread!\n");
+		stream->running = NiFpga_False;
+		Irq_ReleaseContext(stream->irqContext);
+		return status;
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Stop the stream thread and return its IRQ context to the pool.
+ * The thread is woken to stop, so other threads that wait on IRQs are not
+ * cancelled. The events already pushed stay in the ring.
+ *
+ * @param[in]  stream   The edge stream to stop.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_StopEdgeStream(Irq_EdgeStream* stream)
+{
+	int32_t status;
+
+	stream->running = NiFpga_False;
+	Irq_WakeWait(&stream->woken);
+	pthread_join(stream->thread, NULL);
+
+	/*
+	 * The thread did not take the wake if it stopped on a cancel.
+	 */
+	Irq_ClearWake(&stream->woken);
+
+	status = Irq_ReleaseContext(stream->irqContext);
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
+
+	return status;
+}
@@ -0,0 +1,112 @@
+/**
+ * IRQEdgeStream.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef IRQEdgeStream_h_
+#define IRQEdgeStream_h_
+
+#include <pthread.h>
+#include "NiELVISIIIv10.h"
+#include "IRQConfigure.h"
+#include "SpscRing.h"
+#include "ThreadConfig.h"
+
+/**
+ * The number of inputs one edge stream can follow.
+ */
+#define IRQ_EDGE_INPUTS 8
+
+/**
+ * The DIO IN register of bank A. DIO.c of the DIO examples uses the same address.
+ */
+#define IRQ_EDGE_DIO_A_IN 98312
+
+/**
+ * How long the edge stream may take to sample and queue the edges of one wait, in nanoseconds.
+ * Longer iterations are counted as overruns in the statistics of the stream thread.
+ */
+#if !defined(IRQ_EDGE_BUDGET)
+#define IRQ_EDGE_BUDGET 100000
+#endif
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/*
+ * A debounced edge, pushed to the ring of the stream.
+ */
+typedef struct
+{
+	uint32_t timestamp;   /* IRQTIMERREAD when the edge was sampled, in microseconds. Wraps around every 71 minutes */
+	uint8_t  input;       /* Index returned by Irq_AddEdgeInput */
+	uint8_t  level;       /* Debounced level after the edge, 0 or 1 */
+	uint16_t bounces;     /* Edges ignored during the debounce time before this edge */
+} Irq_EdgeEvent;
+
+/*
+ * One DI or button input followed by the stream.
+ */
+typedef struct
+{
+	Irq_Channel channel;      /* Irq_Dio_A0 to Irq_Dio_A3 or Irq_Button_0 */
+	uint8_t     irqNumber;    /* IRQ number configured for the channel */
+	uint32_t    debounce;     /* Edges closer than this to the previous edge are ignored, in microseconds */
+	uint8_t     level;        /* Debounced level */
+	NiFpga_Bool locked;       /* The debounce time of the last edge is running */
+	NiFpga_Bool pending;      /* An edge was ignored and the input is sampled again when the debounce time ends */
+	uint32_t    lockoutEnd;   /* IRQTIMERREAD value at which the debounce time ends, valid while locked */
+	uint16_t    bounces;      /* Edges ignored since the last event */
+	uint32_t    edges;        /* Events pushed for this input */
+} Irq_EdgeInput;
+
+/**
+ * One thread and one IRQ context that turn DI and button IRQs into timestamped edges.
+ */
+typedef struct
+{
+	NiFpga_IrqContext    irqContext;                /* Context taken from the pool for the stream thread */
+	pthread_t            thread;                    /* Stream thread */
+	volatile NiFpga_Bool running;                   /* Cleared to stop the stream thread */
+	volatile NiFpga_Bool woken;                     /* Wake flag of the stream thread, see Irq_WakeWait */
+	SpscRing*            queue;                     /* Ring of Irq_EdgeEvent. The stream thread is its only producer */
+	uint32_t             irqMask;                   /* Bitwise OR of the IRQ numbers of the inputs */
+	uint32_t             inputCount;                /* Number of inputs added */
+	volatile uint32_t    missed;                    /* IRQs whose input was back to its debounced level when sampled */
+	Thread_Stats         stats;                     /* Page faults and overruns, filled when the thread stops */
+	Irq_EdgeInput        input[IRQ_EDGE_INPUTS];
+} Irq_EdgeStream;
+
+/**
+ * Attach a ring to an edge stream and remove all its inputs.
+ */
+int32_t Irq_InitEdgeStream(Irq_EdgeStream* stream, SpscRing* queue);
+
+/**
+ * Follow the edges of a DI or button input.
+ */
+int32_t Irq_AddEdgeInput(Irq_EdgeStream* stream,
+                         Irq_Channel     channel,
+                         uint8_t         irqNumber,
+                         uint32_t        debounce,
+                         uint8_t*        input);
+
+/**
+ * Take an IRQ context from the pool and start the stream thread.
+ */
+int32_t Irq_StartEdgeStream(Irq_EdgeStream* stream, const Thread_Config* config);
+
+/**
+ * Stop the stream thread and return its IRQ context to the pool.
+ */
+int32_t Irq_StopEdgeStream(Irq_EdgeStream* stream);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* IRQEdgeStream_h_ */
@@ -0,0 +1,211 @@
+/**
+ * NI ELVIS III FPGA IRQ eventfd bridge source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "IRQEventFd.h"
+
+/**
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t Irq_EventFdNow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Dispatcher callback. Adds one to the eventfd counter.
+ * The kernel sums the writes until the counter is read, so IRQs received
+ * between two reads are coalesced into one count.
+ *
+ * @param[in]  event   The IRQ received.
+ * @param[in]  data    The bridge.
+ */
+static void Irq_EventFdCallback(const Irq_Event* event, void* data)
+{
+	Irq_EventFd* bridge = (Irq_EventFd*)data;
+	uint64_t     one = 1;
+
+	/*
+	 * Keep the time of the oldest unread IRQ. Store it before the write so the
+	 * reader always finds it.
+	 */
+	__sync_bool_compare_and_swap(&bridge->pendingSince, 0, event->timestamp);
+
+	if (write(bridge->fd, &one, sizeof(one)) != sizeof(one))
+	{
+		printf("Could not signal the eventfd of IRQ %d!\n", event->irqNumber);
+	}
+}
+
+/**
+ * Create the eventfd of an IRQ and deliver the IRQ to it.
+ *
+ * The eventfd is non-blocking and becomes readable when the IRQ is received, so
+ * it can be added to poll, select or epoll with other file descriptors. The IRQ
+ * must still be configured with the Register function of its IRQ IO.
+ *
+ * When deferAck is NiFpga_False, the dispatcher acknowledges the IRQ as soon as
+ * it is counted, and the FPGA can raise it again before the count is read.
+ * When deferAck is NiFpga_True, the IRQ is acknowledged by Irq_ReadEventFd, so
+ * the FPGA waits for the consumer, and the count is 1 per read. The dispatcher
+ * waits on the IRQ again within IRQ_DISPATCH_HELD_POLL milliseconds of the read.
+ *
+ * @param[in]  bridge       The bridge to open.
+ * @param[in]  dispatcher   A dispatcher initialized with Irq_InitDispatcher.
+ * @param[in]  irqNumber    IRQ number.
+ * @param[in]  deferAck     Leave the acknowledgment to Irq_ReadEventFd.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_OpenEventFd(Irq_EventFd* bridge, Irq_Dispatcher* dispatcher, uint8_t irqNumber, NiFpga_Bool deferAck)
+{
+	int32_t status;
+
+	memset(bridge, 0, sizeof(Irq_EventFd));
+	bridge->dispatcher = dispatcher;
+	bridge->irqNumber  = irqNumber;
+	bridge->deferAck   = deferAck;
+	bridge->latencyMin = UINT64_MAX;
+
+	bridge->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (bridge->fd < 0)
+	{
+		printf("Could not create the eventfd of IRQ %d!\n", irqNumber);
+		return NiFpga_Status_ResourceNotInitialized;
+	}
+
+	if (deferAck)
+	{
+		status = Irq_DeferAcknowledge(dispatcher, irqNumber);
+		if (NiFpga_IsError(status))
+		{
+			close(bridge->fd);
+			return status;
+		}
+	}
+
+	status = Irq_SetCallback(dispatcher, irqNumber, Irq_EventFdCallback, bridge);
+	if (NiFpga_IsError(status))
+	{
+		close(bridge->fd);
+		return status;
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Read the number of IRQs received since the last read, and record the time
+ * from the oldest of them to this read.
+ *
+ * @param[in]  bridge   The bridge.
+ * @param[out] count    Number of IRQs received, 0 if none is pending.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_ReadEventFd(Irq_EventFd* bridge, uint64_t* count)
+{
+	uint64_t since;
+	uint64_t latency;
+
+	*count = 0;
+
+	if (read(bridge->fd, count, sizeof(*count)) != sizeof(*count))
+	{
+		if (errno == EAGAIN)
+		{
+			return NiELVISIIIv10_Status_Success;
+		}
+		printf("Could not read the eventfd of IRQ %d!\n", bridge->irqNumber);
+		return NiFpga_Status_SoftwareFault;
+	}
+
+	/*
+	 * An IRQ received between the read and the exchange gives its time to this
+	 * read; the next read then has none and is not measured.
+	 */
+	since = __sync_lock_test_and_set(&bridge->pendingSince, 0);
+	if (since != 0)
+	{
+		latency = Irq_EventFdNow() - since;
+		if (latency < bridge->latencyMin)
+		{
+			bridge->latencyMin = latency;
+		}
+		if (latency > bridge->latencyMax)
+		{
+			bridge->latencyMax = latency;
+		}
+		bridge->latencySum += latency;
+		++bridge->latencyCount;
+	}
+
+	if (bridge->deferAck)
+	{
+		return Irq_AcknowledgeDeferred(bridge->dispatcher, bridge->irqNumber);
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Get the time from an IRQ to the read that returned it.
+ * The time is measured from the return of the dispatcher wait.
+ *
+ * @param[in]  bridge   The bridge.
+ * @param[out] min      Shortest latency in nanoseconds, or 0 if none was measured.
+ * @param[out] max      Longest latency in nanoseconds.
+ * @param[out] mean     Mean latency in nanoseconds.
+ */
+void Irq_GetEventFdLatency(const Irq_EventFd* bridge, uint64_t* min, uint64_t* max, uint64_t* mean)
+{
+	if (bridge->latencyCount == 0)
+	{
+		*min  = 0;
+		*max  = 0;
+		*mean = 0;
+		return;
+	}
+
+	*min  = bridge->latencyMin;
+	*max  = bridge->latencyMax;
+	*mean = bridge->latencySum / bridge->latencyCount;
+}
+
+/**
+ * Stop delivering the IRQ and close its eventfd.
+ * A deferred IRQ that was not read is acknowledged.
+ *
+ * @param[in]  bridge   The bridge to close.
+ *
+ * @return the configure status.
+ */
+int32_t Irq_CloseEventFd(Irq_EventFd* bridge)
+{
+	int32_t status;
+
+	status = Irq_RemoveDispatch(bridge->dispatcher, bridge->irqNumber);
+	if (bridge->deferAck)
+	{
+		Irq_AcknowledgeDeferred(bridge->dispatcher, bridge->irqNumber);
+	}
+
+	close(bridge->fd);
+	bridge->fd = -1;
+
+	return status;
+}
@@ -0,0 +1,59 @@
+/**
+ * IRQEventFd.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef IRQEventFd_h_
+#define IRQEventFd_h_
+
+#include "NiELVISIIIv10.h"
+#include "IRQDispatcher.h"
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/**
+ * An IRQ delivered by the dispatcher as a readable file descriptor.
+ */
+typedef struct
+{
+	Irq_Dispatcher*    dispatcher;     /* Dispatcher that delivers the IRQ */
+	int                fd;             /* eventfd, readable while IRQs are pending */
+	uint8_t            irqNumber;      /* IRQ number */
+	NiFpga_Bool        deferAck;       /* The IRQ is acknowledged by Irq_ReadEventFd */
+	volatile uint64_t  pendingSince;   /* Time of the oldest unread IRQ, in nanoseconds, or 0 */
+	uint64_t           latencyMin;     /* Shortest time from an IRQ to its read, in nanoseconds */
+	uint64_t           latencyMax;     /* Longest time from an IRQ to its read, in nanoseconds */
+	uint64_t           latencySum;     /* Sum of the measured latencies, in nanoseconds */
+	uint32_t           latencyCount;   /* Number of measured latencies */
+} Irq_EventFd;
+
+/**
+ * Create the eventfd of an IRQ and deliver the IRQ to it.
+ */
+int32_t Irq_OpenEventFd(Irq_EventFd* bridge, Irq_Dispatcher* dispatcher, uint8_t irqNumber, NiFpga_Bool deferAck);
+
+/**
+ * Read the number of IRQs received since the last read.
+ */
+int32_t Irq_ReadEventFd(Irq_EventFd* bridge, uint64_t* count);
+
+/**
+ * Get the time from an IRQ to the read that returned it.
+ */
+void Irq_GetEventFdLatency(const Irq_EventFd* bridge, uint64_t* min, uint64_t* max, uint64_t* mean);
+
+/**
+ * Stop delivering the IRQ and close its eventfd.
+ */
+int32_t Irq_CloseEventFd(Irq_EventFd* bridge);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* IRQEventFd_h_ */
@@ -9,6 +9,8 @@
 #include <stdio.h>
 #include <time.h>
 #include "NiELVISIIIv10.h"
+#include "IRQConfigure.h"
+#include "PinMux.h"
 
 /**
  * Global ELVIS III NiFpga Session.
@@ -140,6 +142,11 @@ NiFpga_Status NiELVISIIIv10_Open()
 		return status;
 	}
 
+	/**
+	 * The reset restored the select registers, so forget the pin allocation.
+	 */
+	PinMux_Reset();
+
 	/**
 	 * Start the FPGA code.
 	 */
@@ -151,6 +158,23 @@ NiFpga_Status NiELVISIIIv10_Open()
 		return status;
 	}
 
+	/**
+	 * Reserve the IRQ contexts used by the IRQ functions.
+	 */
+	status = Irq_CreateContextPool();
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		printf("Could not reserve the IRQ contexts!\n");
+
+		/**
+		 * The pool unreserved the contexts it had reserved. Close the session
+		 * and unload the library, so the application can exit or open again.
+		 */
+		NiFpga_Close(NiELVISIIIv10_session, 0);
+		NiFpga_Finalize();
+		return status;
+	}
+
 	return NiFpga_Status_Success;
 }
 
@@ -168,6 +192,16 @@ NiFpga_Status NiELVISIIIv10_Close()
 {
 	NiFpga_Status status;
 
+	/**
+	 * Unreserve the IRQ contexts before the session is closed.
+	 */
+	Irq_DestroyContextPool();
+
+	/**
+	 * Forget the pin allocation of this session.
+	 */
+	PinMux_Reset();
+
 	/**
 	 * Close and Reset the FPGA
 	 */
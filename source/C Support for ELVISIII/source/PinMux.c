@@ -0,0 +1,456 @@
+/**
+ * NI ELVIS III function select (pin multiplexer) manager source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "PinMux.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+/*
+ * The SYS.SELECTx register of each bank.
+ */
+static const uint32_t pinmux_register[PINMUX_BANK_NUM] = {SYSSELECTA, SYSSELECTB};
+
+/*
+ * The last value written to each SYS.SELECTx register. The register is read once,
+ * the first time a bank is used, and afterwards every change goes through this copy.
+ */
+static uint64_t    pinmux_cache[PINMUX_BANK_NUM];
+static NiFpga_Bool pinmux_cacheValid[PINMUX_BANK_NUM];
+
+/*
+ * The 2-bit fields of each bank that are owned by a committed plan, and the
+ * number of committed plans that own each pin. A pin stays owned until every
+ * plan that assigned it is released.
+ */
+static uint64_t pinmux_owned[PINMUX_BANK_NUM];
+static uint8_t  pinmux_refs[PINMUX_BANK_NUM][PINMUX_PIN_NUM];
+
+/*
+ * Serializes the read-modify-write of the select registers between threads.
+ * The lock is held across register accesses, so a waiting thread sleeps
+ * instead of spinning against the holder on the same core.
+ */
+static pthread_mutex_t pinmux_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void PinMux_Lock(void)
+{
+	pthread_mutex_lock(&pinmux_lock);
+}
+
+static void PinMux_Unlock(void)
+{
+	pthread_mutex_unlock(&pinmux_lock);
+}
+
+/**
+ * Forget the cached select registers and the committed plans.
+ * NiELVISIIIv10_Open and NiELVISIIIv10_Close call it, because the FPGA reset
+ * restores the select registers and the plans of the previous session no longer apply.
+ */
+void PinMux_Reset(void)
+{
+	PinMux_Lock();
+	memset(pinmux_cache, 0, sizeof(pinmux_cache));
+	memset(pinmux_cacheValid, 0, sizeof(pinmux_cacheValid));
+	memset(pinmux_owned, 0, sizeof(pinmux_owned));
+	memset(pinmux_refs, 0, sizeof(pinmux_refs));
+	PinMux_Unlock();
+}
+
+/*
+ * Get the cached value of a select register, reading it from the device the first time.
+ * Must be called with the lock held.
+ */
+static NiFpga_Status PinMux_LoadCache(int bank)
+{
+	NiFpga_Status status = NiFpga_Status_Success;
+
+	if (!pinmux_cacheValid[bank])
+	{
+		status = NiFpga_ReadU64(NiELVISIIIv10_session, pinmux_register[bank], &pinmux_cache[bank]);
+		if (NiFpga_IsNotError(status))
+		{
+			pinmux_cacheValid[bank] = NiFpga_True;
+		}
+	}
+
+	return status;
+}
+
+/*
+ * Convert a plan of one bank into the select field mask and the select value.
+ */
+static void PinMux_PlanBits(const PinMux_Plan* plan, int bank, uint64_t* mask, uint64_t* value)
+{
+	int pin;
+
+	*mask = 0;
+	*value = 0;
+	for (pin = 0; pin < PINMUX_PIN_NUM; pin++)
+	{
+		if (plan->function[bank][pin] != PinMux_Unassigned)
+		{
+			*mask  = *mask | ((uint64_t)0b11 << (pin * 2));
+			*value = *value | ((uint64_t)plan->function[bank][pin] << (pin * 2));
+		}
+	}
+}
+
+/**
+ * Clear all the assignments of a plan.
+ *
+ * @param[out]  plan     The plan to initialize.
+ */
+void PinMux_InitPlan(PinMux_Plan* plan)
+{
+	memset(plan->function, PinMux_Unassigned, sizeof(plan->function));
+}
+
+/**
+ * Assign a function to a range of pins in a plan.
+ *
+ * Assigning the same function to a pin twice is allowed, so devices that share
+ * pins (for example SPI and I2C are both 11) can be added independently.
+ * Nothing is written to the device until the plan is committed.
+ *
+ * @param[in,out]  plan        The plan to modify.
+ * @param[in]      bank        The bank of the pins.
+ * @param[in]      firstPin    The first DIO pin (0-19).
+ * @param[in]      pinCount    The number of consecutive pins.
+ * @param[in]      function    The function to route to the pins.
+ *
+ * @return NiELVISIIIv10_Status_PinMuxConflict if a pin is already assigned a different function.
+ */
+int32_t PinMux_Assign(PinMux_Plan*    plan,
+                      PinMux_Bank     bank,
+                      uint8_t         firstPin,
+                      uint8_t         pinCount,
+                      PinMux_Function function)
+{
+	int pin;
+
+	if (bank >= PINMUX_BANK_NUM || firstPin + pinCount > PINMUX_PIN_NUM)
+	{
+		printf("The specified pin is out of range.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	// Validate all pins first so a conflicting request leaves the plan unchanged.
+	for (pin = firstPin; pin < firstPin + pinCount; pin++)
+	{
+		if (plan->function[bank][pin] != PinMux_Unassigned && plan->function[bank][pin] != function)
+		{
+			printf("DIO%d on bank %c is already assigned to another function.\n", pin, 'A' + bank);
+			return NiELVISIIIv10_Status_PinMuxConflict;
+		}
+	}
+
+	for (pin = firstPin; pin < firstPin + pinCount; pin++)
+	{
+		plan->function[bank][pin] = function;
+	}
+
+	return NiFpga_Status_Success;
+}
+
+/**
+ * Assign the pins of one encoder channel in a plan.
+ * Encoder channel n uses DIO(2n) as ENC.A and DIO(2n+1) as ENC.B.
+ *
+ * @param[in,out]  plan              The plan to modify.
+ * @param[in]      bank              The bank of the encoder.
+ * @param[in]      encoderChannel    The encoder channel (0-9).
+ *
+ * @return the configure status.
+ */
+int32_t PinMux_AssignEncoder(PinMux_Plan* plan, PinMux_Bank bank, uint8_t encoderChannel)
+{
+	return PinMux_Assign(plan, bank, encoderChannel * 2, 2, PinMux_Encoder);
+}
+
+/**
+ * Assign the SPI pins in a plan. SPI uses DIO5 (CLK), DIO6 (MISO) and DIO7 (MOSI).
+ *
+ * @param[in,out]  plan    The plan to modify.
+ * @param[in]      bank    The bank of the SPI.
+ *
+ * @return the configure status.
+ */
+int32_t PinMux_AssignSpi(PinMux_Plan* plan, PinMux_Bank bank)
+{
+	return PinMux_Assign(plan, bank, 5, 3, PinMux_SpiI2c);
+}
+
+/**
+ * Assign the I2C pins in a plan. I2C uses DIO14 (SCL) and DIO15 (SDA).
+ *
+ * @param[in,out]  plan    The plan to modify.
+ * @param[in]      bank    The bank of the I2C.
+ *
+ * @return the configure status.
+ */
+int32_t PinMux_AssignI2c(PinMux_Plan* plan, PinMux_Bank bank)
+{
+	return PinMux_Assign(plan, bank, 14, 2, PinMux_SpiI2c);
+}
+
+/**
+ * Validate a plan against the committed allocation and write it to the device.
+ *
+ * The whole plan is checked before anything is written. If no pin conflicts with
+ * a previously committed plan, each bank that the plan uses is written with a
+ * single write of its SYS.SELECTx register and the assigned pins become owned:
+ * PinMux_Select refuses to route another function to them until the plan is released.
+ * A pin can be owned by several plans with the same function, for example an SPI
+ * and an I2C device, and stays owned until each of them is released.
+ * If a write fails, the banks already written are restored, so either the whole
+ * plan is committed or nothing changes.
+ *
+ * @param[in]  plan    The plan to commit.
+ *
+ * @return the configure status.
+ */
+int32_t PinMux_Commit(const PinMux_Plan* plan)
+{
+	NiFpga_Status status = NiFpga_Status_Success;
+	uint64_t mask[PINMUX_BANK_NUM];
+	uint64_t value[PINMUX_BANK_NUM];
+	uint64_t previous[PINMUX_BANK_NUM];
+	uint64_t selectReg;
+	int written = 0;
+	int bank;
+	int pin;
+
+	PinMux_Lock();
+
+	// Read every bank the plan uses before checking it, so the check never uses
+	// a cache that was not loaded.
+	for (bank = 0; bank < PINMUX_BANK_NUM; bank++)
+	{
+		PinMux_PlanBits(plan, bank, &mask[bank], &value[bank]);
+		if (mask[bank] == 0)
+		{
+			continue;
+		}
+
+		status = PinMux_LoadCache(bank);
+		if (NiELVISIIIv10_IsNotSuccess(status))
+		{
+			PinMux_Unlock();
+			NiELVISIIIv10_PrintStatus(status);
+			printf("Could not read from the System Select Register!\n");
+			return status;
+		}
+
+		// Pins owned by an earlier plan may only be committed again with the same function.
+		if ((pinmux_cache[bank] & pinmux_owned[bank] & mask[bank]) != (value[bank] & pinmux_owned[bank] & mask[bank]))
+		{
+			PinMux_Unlock();
+			printf("The plan conflicts with the pins owned on bank %c.\n", 'A' + bank);
+			return NiELVISIIIv10_Status_PinMuxConflict;
+		}
+	}
+
+	// Write each bank once.
+	for (bank = 0; bank < PINMUX_BANK_NUM; bank++)
+	{
+		previous[bank] = pinmux_cache[bank];
+		if (mask[bank] == 0)
+		{
+			continue;
+		}
+
+		selectReg = (pinmux_cache[bank] & ~mask[bank]) | value[bank];
+		if (selectReg != pinmux_cache[bank])
+		{
+			status = NiFpga_WriteU64(NiELVISIIIv10_session, pinmux_register[bank], selectReg);
+			if (NiELVISIIIv10_IsNotSuccess(status))
+			{
+				// The device no longer matches the cache, so read it again next time.
+				pinmux_cacheValid[bank] = NiFpga_False;
+				break;
+			}
+			pinmux_cache[bank] = selectReg;
+		}
+		written = bank + 1;
+	}
+
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		// Restore the banks written before the failure.
+		for (bank = 0; bank < written; bank++)
+		{
+			if (pinmux_cache[bank] != previous[bank])
+			{
+				if (NiELVISIIIv10_IsNotSuccess(NiFpga_WriteU64(NiELVISIIIv10_session, pinmux_register[bank], previous[bank])))
+				{
+					pinmux_cacheValid[bank] = NiFpga_False;
+				}
+				pinmux_cache[bank] = previous[bank];
+			}
+		}
+	}
+	else
+	{
+		// The pins become owned only once every bank is written.
+		for (bank = 0; bank < PINMUX_BANK_NUM; bank++)
+		{
+			for (pin = 0; pin < PINMUX_PIN_NUM; pin++)
+			{
+				if (plan->function[bank][pin] != PinMux_Unassigned)
+				{
+					pinmux_refs[bank][pin]++;
+				}
+			}
+			pinmux_owned[bank] = pinmux_owned[bank] | mask[bank];
+		}
+	}
+
+	PinMux_Unlock();
+
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		NiELVISIIIv10_PrintStatus(status);
+		printf("Could not write to the System Select Register!\n");
+	}
+
+	return status;
+}
+
+/**
+ * Give up the ownership of the pins assigned in a committed plan.
+ * A pin that another committed plan also assigned stays owned by it.
+ * The select registers are not changed.
+ *
+ * @param[in]  plan    The committed plan.
+ */
+void PinMux_Release(const PinMux_Plan* plan)
+{
+	int bank;
+	int pin;
+
+	PinMux_Lock();
+	for (bank = 0; bank < PINMUX_BANK_NUM; bank++)
+	{
+		for (pin = 0; pin < PINMUX_PIN_NUM; pin++)
+		{
+			if (plan->function[bank][pin] == PinMux_Unassigned || pinmux_refs[bank][pin] == 0)
+			{
+				continue;
+			}
+
+			pinmux_refs[bank][pin]--;
+			if (pinmux_refs[bank][pin] == 0)
+			{
+				pinmux_owned[bank] = pinmux_owned[bank] & ~((uint64_t)0b11 << (pin * 2));
+			}
+		}
+	}
+	PinMux_Unlock();
+}
+
+/**
+ * Route a function to a range of pins of the bank controlled by a select register.
+ *
+ * This is used by the Select functions of the peripheral modules. When the pins
+ * already have the requested function, which is the normal case after the first call
+ * or after a plan was committed, the function returns without accessing the device.
+ * Otherwise the select register is updated with one write. Pins owned by a
+ * committed plan are never re-routed to a different function.
+ *
+ * @param[in]  selectRegister    SYSSELECTA or SYSSELECTB.
+ * @param[in]  firstPin          The first DIO pin (0-19).
+ * @param[in]  pinCount          The number of consecutive pins.
+ * @param[in]  function          The function to route to the pins.
+ *
+ * @return the configure status.
+ */
+int32_t PinMux_Select(uint32_t        selectRegister,
+                      uint8_t         firstPin,
+                      uint8_t         pinCount,
+                      PinMux_Function function)
+{
+	NiFpga_Status status;
+	uint64_t mask = 0;
+	uint64_t value = 0;
+	uint64_t selectReg;
+	int bank;
+	int pin;
+
+	bank = (selectRegister == SYSSELECTB) ? PinMux_BankB : PinMux_BankA;
+
+	for (pin = firstPin; pin < firstPin + pinCount && pin < PINMUX_PIN_NUM; pin++)
+	{
+		mask  = mask | ((uint64_t)0b11 << (pin * 2));
+		value = value | ((uint64_t)function << (pin * 2));
+	}
+
+	PinMux_Lock();
+
+	status = PinMux_LoadCache(bank);
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		PinMux_Unlock();
+		NiELVISIIIv10_PrintStatus(status);
+		printf("Could not read from the System Select Register!\n");
+		return status;
+	}
+
+	// Nothing to do if the pins are already routed to the function.
+	if ((pinmux_cache[bank] & mask) == value)
+	{
+		PinMux_Unlock();
+		return NiFpga_Status_Success;
+	}
+
+	// Do not take pins away from a committed plan.
+	if (pinmux_owned[bank] & mask)
+	{
+		PinMux_Unlock();
+		printf("DIO%d:%d on bank %c is owned by another function.\n", firstPin + pinCount - 1, firstPin, 'A' + bank);
+		return NiELVISIIIv10_Status_PinMuxConflict;
+	}
+
+	selectReg = (pinmux_cache[bank] & ~mask) | value;
+	status = NiFpga_WriteU64(NiELVISIIIv10_session, pinmux_register[bank], selectReg);
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		pinmux_cacheValid[bank] = NiFpga_False;
+	}
+	else
+	{
+		pinmux_cache[bank] = selectReg;
+	}
+
+	PinMux_Unlock();
+
+	if (NiELVISIIIv10_IsNotSuccess(status))
+	{
+		NiELVISIIIv10_PrintStatus(status);
+		printf("Could not write to the System Select Register!\n");
+	}
+
+	return status;
+}
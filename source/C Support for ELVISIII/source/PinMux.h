@@ -0,0 +1,118 @@
+/**
+ * PinMux.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef PinMux_h_
+#define PinMux_h_
+
+#include "NiELVISIIIv10.h"
+
+/**
+ * The number of banks (connectors) and the number of shared pins on each bank.
+ */
+#define PINMUX_BANK_NUM  2
+#define PINMUX_PIN_NUM   20
+
+/**
+ * The specified pin is already selected for another function by a committed plan.
+ * Release the plan that owns the pin or change the allocation.
+ */
+static const int32_t NiELVISIIIv10_Status_PinMuxConflict = -363026;
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/*
+ * Functions that can be routed to a shared pin. The value is the 2-bit code
+ * written to the SYS.SELECTx register for the pin.
+ */
+typedef enum
+{
+	PinMux_Dio     = 0,     /* 00: DIO */
+	PinMux_Pwm     = 1,     /* 01: PWM */
+	PinMux_Encoder = 2,     /* 10: Encoder */
+	PinMux_SpiI2c  = 3,     /* 11: SPI or I2C */
+
+	PinMux_Unassigned = 0xFF,   /* The pin is not part of the plan */
+} PinMux_Function;
+
+/*
+ * Banks controlled by SYS.SELECTA and SYS.SELECTB.
+ */
+typedef enum
+{
+	PinMux_BankA = 0,
+	PinMux_BankB = 1,
+} PinMux_Bank;
+
+/**
+ * A whole-board pin allocation. Build it with PinMux_Assign* and apply it with PinMux_Commit.
+ */
+typedef struct
+{
+	uint8_t function[PINMUX_BANK_NUM][PINMUX_PIN_NUM];   /* PinMux_Function of each pin */
+} PinMux_Plan;
+
+/**
+ * Forget the cached select registers and the committed plans.
+ */
+void PinMux_Reset(void);
+
+/**
+ * Clear all the assignments of a plan.
+ */
+void PinMux_InitPlan(PinMux_Plan* plan);
+
+/**
+ * Assign a function to a range of pins in a plan.
+ */
+int32_t PinMux_Assign(PinMux_Plan*    plan,
+                      PinMux_Bank     bank,
+                      uint8_t         firstPin,
+                      uint8_t         pinCount,
+                      PinMux_Function function);
+
+/**
+ * Assign the pins of one encoder channel (ENC.A and ENC.B) in a plan.
+ */
+int32_t PinMux_AssignEncoder(PinMux_Plan* plan, PinMux_Bank bank, uint8_t encoderChannel);
+
+/**
+ * Assign the SPI pins (DIO5:7) in a plan.
+ */
+int32_t PinMux_AssignSpi(PinMux_Plan* plan, PinMux_Bank bank);
+
+/**
+ * Assign the I2C pins (DIO14:15) in a plan.
+ */
+int32_t PinMux_AssignI2c(PinMux_Plan* plan, PinMux_Bank bank);
+
+/**
+ * Validate a plan against the committed allocation and write it to the device.
+ */
+int32_t PinMux_Commit(const PinMux_Plan* plan);
+
+/**
+ * Give up the ownership of the pins assigned in a committed plan.
+ * A pin is owned until every plan that committed it is released.
+ */
+void PinMux_Release(const PinMux_Plan* plan);
+
+/**
+ * Route a function to a range of pins of the bank controlled by a select register.
+ */
+int32_t PinMux_Select(uint32_t        selectRegister,
+                      uint8_t         firstPin,
+                      uint8_t         pinCount,
+                      PinMux_Function function);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* PinMux_h_ */
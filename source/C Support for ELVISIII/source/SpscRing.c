@@ -0,0 +1,106 @@
+/**
+ * Single-producer single-consumer ring source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "SpscRing.h"
+
+/**
+ * Attach the storage to a ring and empty it.
+ *
+ * @param[in]  ring          The ring to initialize.
+ * @param[in]  buffer        Storage for capacity elements.
+ * @param[in]  elementSize   Size of one element in bytes.
+ * @param[in]  capacity      Number of elements. It must be a power of two.
+ *
+ * @return the configure status.
+ */
+int32_t SpscRing_Init(SpscRing* ring, void* buffer, size_t elementSize, uint32_t capacity)
+{
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+	{
+		printf("The capacity of the ring must be a power of two.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	ring->buffer      = (uint8_t*)buffer;
+	ring->elementSize = elementSize;
+	ring->capacity    = capacity;
+	ring->head        = 0;
+	ring->tail        = 0;
+	ring->dropped     = 0;
+
+	return NiFpga_Status_Success;
+}
+
+/**
+ * Add an element. Only called by the producer.
+ *
+ * @param[in]  ring      The ring.
+ * @param[in]  element   The element to copy into the ring.
+ *
+ * @return NiFpga_True if the element was added, NiFpga_False if the ring is full.
+ */
+NiFpga_Bool SpscRing_Push(SpscRing* ring, const void* element)
+{
+	uint32_t head = ring->head;
+
+	if (head - ring->tail >= ring->capacity)
+	{
+		++ring->dropped;
+		return NiFpga_False;
+	}
+
+	memcpy(ring->buffer + (head & (ring->capacity - 1)) * ring->elementSize, element, ring->elementSize);
+
+	/* Make the element visible before the consumer can see the new head. */
+	__sync_synchronize();
+	ring->head = head + 1;
+
+	return NiFpga_True;
+}
+
+/**
+ * Remove the oldest element. Only called by the consumer.
+ *
+ * @param[in]  ring      The ring.
+ * @param[out] element   The element removed.
+ *
+ * @return NiFpga_True if an element was removed, NiFpga_False if the ring is empty.
+ */
+NiFpga_Bool SpscRing_Pop(SpscRing* ring, void* element)
+{
+	uint32_t tail = ring->tail;
+
+	if (tail == ring->head)
+	{
+		return NiFpga_False;
+	}
+
+	/* Read the element only after the head that published it. */
+	__sync_synchronize();
+	memcpy(element, ring->buffer + (tail & (ring->capacity - 1)) * ring->elementSize, ring->elementSize);
+
+	/* Finish reading before the producer can reuse the slot. */
+	__sync_synchronize();
+	ring->tail = tail + 1;
+
+	return NiFpga_True;
+}
+
+/**
+ * Get the number of elements in the ring.
+ *
+ * @param[in]  ring   The ring.
+ *
+ * @return the number of elements.
+ */
+uint32_t SpscRing_Count(const SpscRing* ring)
+{
+	return ring->head - ring->tail;
+}
@@ -0,0 +1,56 @@
+/**
+ * SpscRing.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef SpscRing_h_
+#define SpscRing_h_
+
+#include "NiELVISIIIv10.h"
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/**
+ * A lock-free ring of fixed-size elements with one producer thread and one
+ * consumer thread. The capacity must be a power of two.
+ */
+typedef struct
+{
+	uint8_t*          buffer;         /* Storage for capacity elements */
+	size_t            elementSize;    /* Size of one element in bytes */
+	uint32_t          capacity;       /* Number of elements, a power of two */
+	volatile uint32_t head;           /* Elements pushed, written by the producer only */
+	volatile uint32_t tail;           /* Elements popped, written by the consumer only */
+	volatile uint32_t dropped;        /* Elements that were pushed while the ring was full */
+} SpscRing;
+
+/**
+ * Attach the storage to a ring and empty it.
+ */
+int32_t SpscRing_Init(SpscRing* ring, void* buffer, size_t elementSize, uint32_t capacity);
+
+/**
+ * Add an element. Only called by the producer.
+ */
+NiFpga_Bool SpscRing_Push(SpscRing* ring, const void* element);
+
+/**
+ * Remove the oldest element. Only called by the consumer.
+ */
+NiFpga_Bool SpscRing_Pop(SpscRing* ring, void* element);
+
+/**
+ * Get the number of elements in the ring.
+ */
+uint32_t SpscRing_Count(const SpscRing* ring);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* SpscRing_h_ */
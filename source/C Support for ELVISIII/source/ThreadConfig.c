@@ -0,0 +1,336 @@
+/**
+ * NI ELVIS III real-time thread configuration source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "ThreadConfig.h"
+
+/**
+ * Part of the stack that is not prefaulted, for the frames of the thread
+ * start-up and of the prefault itself.
+ */
+#define THREAD_STACK_MARGIN (16 * 1024)
+
+/*
+ * What the new thread runs, passed from Thread_Create to Thread_Start.
+ */
+typedef struct
+{
+	void*         (*start)(void*);
+	void*         arg;
+	size_t        prefault;           /* Bytes of stack to touch, or 0 */
+	Thread_Stats* stats;
+} Thread_StartArgs;
+
+/**
+ * Touch size bytes of the stack so the thread does not take page faults when
+ * its stack grows later. The frame is released when the function returns.
+ */
+static void __attribute__((noinline)) Thread_PrefaultStack(size_t size)
+{
+	volatile uint8_t* stack = (volatile uint8_t*)alloca(size);
+	size_t i;
+
+	for (i = 0; i < size; i += 4096)
+	{
+		stack[i] = 0;
+	}
+}
+
+/**
+ * Get the number of bytes of stack to prefault for a configuration.
+ */
+static size_t Thread_PrefaultSize(const Thread_Config* config)
+{
+	size_t stackSize = config->stackSize ? config->stackSize : THREAD_STACK_SIZE;
+
+	if (!config->prefault || stackSize <= THREAD_STACK_MARGIN)
+	{
+		return 0;
+	}
+
+	return stackSize - THREAD_STACK_MARGIN;
+}
+
+/**
+ * Fill the statistics when the thread returns or calls pthread_exit.
+ */
+static void Thread_End(void* resource)
+{
+	Thread_UpdateStats((Thread_Stats*)resource);
+}
+
+/**
+ * Start routine of a configured thread. Prefaults the stack, starts the
+ * statistics and runs the thread function.
+ *
+ * @param[in]  resource   The Thread_StartArgs, freed here.
+ */
+static void* Thread_Start(void* resource)
+{
+	Thread_StartArgs args = *(Thread_StartArgs*)resource;
+	void* result;
+
+	free(resource);
+
+	if (args.prefault != 0)
+	{
+		Thread_PrefaultStack(args.prefault);
+	}
+
+	if (args.stats == NULL)
+	{
+		return args.start(args.arg);
+	}
+
+	Thread_BeginStats(args.stats);
+
+	pthread_cleanup_push(Thread_End, args.stats);
+	result = args.start(args.arg);
+	pthread_cleanup_pop(1);
+
+	return result;
+}
+
+/**
+ * Set a configuration to SCHED_FIFO at a priority, on any CPU, with a
+ * THREAD_STACK_SIZE stack that is prefaulted.
+ *
+ * @param[in]  config     The configuration to set.
+ * @param[in]  priority   SCHED_FIFO priority, such as THREAD_IRQ_PRIORITY.
+ */
+void Thread_InitConfig(Thread_Config* config, int priority)
+{
+	config->policy    = SCHED_FIFO;
+	config->priority  = priority;
+	config->cpu       = THREAD_ANY_CPU;
+	config->stackSize = THREAD_STACK_SIZE;
+	config->prefault  = NiFpga_True;
+	config->stats     = NULL;
+}
+
+/**
+ * Lock the current and future memory of the process in RAM, and keep the heap
+ * from returning memory to the system or using mmap, so that the memory of a
+ * real-time thread is never paged out or faulted in again.
+ * Call it once, before the threads are created.
+ *
+ * @return 0 if successful, or the errno value of mlockall.
+ */
+int32_t Thread_LockMemory(void)
+{
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		printf("Could not lock the memory of the process. Page faults can delay real-time threads.\n");
+		return errno;
+	}
+
+	return 0;
+}
+
+/**
+ * Create a thread with a configuration.
+ *
+ * If the process is not permitted to use a real-time policy, the thread is
+ * created with the scheduling of the calling thread instead and a message is
+ * printed.
+ *
+ * @param[out] thread   The new thread.
+ * @param[in]  config   How the thread is scheduled.
+ * @param[in]  start    Thread function.
+ * @param[in]  arg      Passed to start.
+ *
+ * @return 0 if successful, or the error number of pthread_create.
+ */
+int32_t Thread_Create(pthread_t* thread, const Thread_Config* config, void* (*start)(void*), void* arg)
+{
+	pthread_attr_t      attr;
+	struct sched_param  param;
+	Thread_StartArgs*   args;
+	int                 status;
+
+	args = (Thread_StartArgs*)malloc(sizeof(Thread_StartArgs));
+	if (args == NULL)
+	{
+		return ENOMEM;
+	}
+	args->start    = start;
+	args->arg      = arg;
+	args->prefault = Thread_PrefaultSize(config);
+	args->stats    = config->stats;
+
+	pthread_attr_init(&attr);
+
+	if (config->stackSize != 0)
+	{
+		pthread_attr_setstacksize(&attr, config->stackSize);
+	}
+
+	if (config->cpu != THREAD_ANY_CPU)
+	{
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(config->cpu, &cpus);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+	}
+
+	if (config->policy != SCHED_OTHER)
+	{
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = config->priority;
+
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, config->policy);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	status = pthread_create(thread, &attr, Thread_Start, args);
+	if (status == EPERM && config->policy != SCHED_OTHER)
+	{
+		printf("Not permitted to use a real-time priority. The thread runs with the default priority.\n");
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		status = pthread_create(thread, &attr, Thread_Start, args);
+	}
+
+	pthread_attr_destroy(&attr);
+
+	if (status != 0)
+	{
+		free(args);
+	}
+
+	return status;
+}
+
+/**
+ * Apply a configuration to the calling thread. The stack size is ignored.
+ *
+ * @param[in]  config   How the thread is scheduled.
+ *
+ * @return 0 if successful, or the error number of pthread_setschedparam.
+ */
+int32_t Thread_ConfigureCurrent(const Thread_Config* config)
+{
+	struct sched_param param;
+	int status = 0;
+
+	if (config->cpu != THREAD_ANY_CPU)
+	{
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(config->cpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = config->priority;
+
+	status = pthread_setschedparam(pthread_self(), config->policy, &param);
+	if (status == EPERM)
+	{
+		printf("Not permitted to use a real-time priority. The thread runs with the default priority.\n");
+	}
+
+	if (Thread_PrefaultSize(config) != 0)
+	{
+		Thread_PrefaultStack(Thread_PrefaultSize(config));
+	}
+
+	if (config->stats != NULL)
+	{
+		Thread_BeginStats(config->stats);
+	}
+
+	return status;
+}
+
+/**
+ * Start counting the page faults of the calling thread.
+ *
+ * @param[in]  stats   The statistics to reset.
+ */
+void Thread_BeginStats(Thread_Stats* stats)
+{
+	memset(stats, 0, sizeof(Thread_Stats));
+	getrusage(RUSAGE_THREAD, &stats->start);
+}
+
+/**
+ * Update the page faults and preemptions of the calling thread since
+ * Thread_BeginStats. Only the thread itself can update them.
+ *
+ * @param[in]  stats   The statistics to update.
+ */
+void Thread_UpdateStats(Thread_Stats* stats)
+{
+	struct rusage now;
+
+	getrusage(RUSAGE_THREAD, &now);
+
+	stats->minorFaults = now.ru_minflt - stats->start.ru_minflt;
+	stats->majorFaults = now.ru_majflt - stats->start.ru_majflt;
+	stats->preemptions = now.ru_nivcsw - stats->start.ru_nivcsw;
+}
+
+/**
+ * Record the duration of one iteration of a loop and count it if it is over
+ * its budget, such as the period of the IRQ it handles.
+ *
+ * @param[in]  stats     The statistics.
+ * @param[in]  elapsed   Duration of the iteration, in nanoseconds.
+ * @param[in]  budget    Longest duration allowed, in nanoseconds.
+ *
+ * @return NiFpga_True if the iteration was over its budget.
+ */
+NiFpga_Bool Thread_CheckOverrun(Thread_Stats* stats, uint64_t elapsed, uint64_t budget)
+{
+	if (elapsed > stats->worst)
+	{
+		stats->worst = elapsed;
+	}
+
+	if (elapsed > budget)
+	{
+		++stats->overruns;
+		return NiFpga_True;
+	}
+
+	return NiFpga_False;
+}
+
+/**
+ * Print the page faults and overruns of a thread.
+ *
+ * @param[in]  name    Name of the thread.
+ * @param[in]  stats   The statistics.
+ */
+void Thread_PrintStats(const char* name, const Thread_Stats* stats)
+{
+	printf("%s: %ld minor page faults, %ld major page faults, %ld preemptions, %u overruns, worst %llu us\n",
+	       name,
+	       stats->minorFaults,
+	       stats->majorFaults,
+	       stats->preemptions,
+	       stats->overruns,
+	       (unsigned long long)(stats->worst / 1000));
+}
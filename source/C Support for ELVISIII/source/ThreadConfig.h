@@ -0,0 +1,114 @@
+/**
+ * ThreadConfig.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef ThreadConfig_h_
+#define ThreadConfig_h_
+
+#include <pthread.h>
+#include <sys/resource.h>
+#include "NiELVISIIIv10.h"
+
+/**
+ * Run the thread on any CPU.
+ */
+#define THREAD_ANY_CPU -1
+
+/**
+ * Default SCHED_FIFO priorities. IRQ waiters run above streaming readers so a
+ * long FIFO read does not delay an IRQ.
+ */
+#if !defined(THREAD_IRQ_PRIORITY)
+#define THREAD_IRQ_PRIORITY 80
+#endif
+
+#if !defined(THREAD_STREAM_PRIORITY)
+#define THREAD_STREAM_PRIORITY 70
+#endif
+
+/**
+ * Default stack size of a configured thread, in bytes.
+ */
+#if !defined(THREAD_STACK_SIZE)
+#define THREAD_STACK_SIZE (256 * 1024)
+#endif
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/*
+ * Page faults and overruns of a thread.
+ */
+typedef struct
+{
+	struct rusage start;              /* Usage of the thread once its stack was prefaulted */
+	long          minorFaults;        /* Minor page faults since the thread started */
+	long          majorFaults;        /* Major page faults since the thread started */
+	long          preemptions;        /* Involuntary context switches since the thread started */
+	uint32_t      overruns;           /* Iterations that took longer than their budget */
+	uint64_t      worst;              /* Longest iteration, in nanoseconds */
+} Thread_Stats;
+
+/*
+ * How a thread is scheduled.
+ */
+typedef struct
+{
+	int           policy;             /* SCHED_FIFO, SCHED_RR or SCHED_OTHER */
+	int           priority;           /* 1 to 99 for SCHED_FIFO and SCHED_RR, 0 for SCHED_OTHER */
+	int           cpu;                /* CPU to run on, or THREAD_ANY_CPU */
+	size_t        stackSize;          /* Stack size in bytes, 0 for the default */
+	NiFpga_Bool   prefault;           /* Touch the whole stack before the thread function runs */
+	Thread_Stats* stats;              /* Filled when the thread ends, or NULL */
+} Thread_Config;
+
+/**
+ * Set a configuration to SCHED_FIFO at a priority, on any CPU, with a prefaulted stack.
+ */
+void Thread_InitConfig(Thread_Config* config, int priority);
+
+/**
+ * Lock the memory of the process and keep the heap from returning memory to the system.
+ */
+int32_t Thread_LockMemory(void);
+
+/**
+ * Create a thread with a configuration.
+ */
+int32_t Thread_Create(pthread_t* thread, const Thread_Config* config, void* (*start)(void*), void* arg);
+
+/**
+ * Apply a configuration to the calling thread.
+ */
+int32_t Thread_ConfigureCurrent(const Thread_Config* config);
+
+/**
+ * Start counting the page faults of the calling thread.
+ */
+void Thread_BeginStats(Thread_Stats* stats);
+
+/**
+ * Update the page faults of the calling thread.
+ */
+void Thread_UpdateStats(Thread_Stats* stats);
+
+/**
+ * Record the duration of one iteration and count it if it is over its budget.
+ */
+NiFpga_Bool Thread_CheckOverrun(Thread_Stats* stats, uint64_t elapsed, uint64_t budget);
+
+/**
+ * Print the page faults and overruns of a thread.
+ */
+void Thread_PrintStats(const char* name, const Thread_Stats* stats);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* ThreadConfig_h_ */
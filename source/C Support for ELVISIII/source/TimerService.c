@@ -0,0 +1,486 @@
+/**
+ * NI ELVIS III FPGA timer service source file.
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "TimerService.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+/**
+ * Read the FPGA timer and extend it to 64 bits. Called with the lock held.
+ *
+ * IRQTIMERREAD counts microseconds and wraps around every 71 minutes. The
+ * service reads it at least every TIMER_SERVICE_TIMEOUT milliseconds, so every
+ * wrap-around is seen.
+ *
+ * @return the time in nanoseconds.
+ */
+static uint64_t Timer_ReadNow(Timer_Service* service)
+{
+	uint32_t value = service->lastRead;
+
+	NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &value);
+	if (value < service->lastRead)
+	{
+		service->wraps += (uint64_t)1 << 32;
+	}
+	service->lastRead = value;
+
+	return (service->wraps + value) * 1000;
+}
+
+/**
+ * Move the heap entry at index up until its parent is not later.
+ */
+static void Timer_SiftUp(Timer_Service* service, uint32_t index)
+{
+	uint32_t id = service->heap[index];
+
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1) / 2;
+
+		if (service->timer[service->heap[parent]].deadline <= service->timer[id].deadline)
+		{
+			break;
+		}
+		service->heap[index] = service->heap[parent];
+		index = parent;
+	}
+	service->heap[index] = id;
+}
+
+/**
+ * Move the heap entry at index down until no child is earlier.
+ */
+static void Timer_SiftDown(Timer_Service* service, uint32_t index)
+{
+	uint32_t id = service->heap[index];
+
+	for (;;)
+	{
+		uint32_t child = 2 * index + 1;
+
+		if (child >= service->heapSize)
+		{
+			break;
+		}
+		if (child + 1 < service->heapSize
+		    && service->timer[service->heap[child + 1]].deadline < service->timer[service->heap[child]].deadline)
+		{
+			++child;
+		}
+		if (service->timer[id].deadline <= service->timer[service->heap[child]].deadline)
+		{
+			break;
+		}
+		service->heap[index] = service->heap[child];
+		index = child;
+	}
+	service->heap[index] = id;
+}
+
+/**
+ * Remove the heap entry at index.
+ */
+static void Timer_HeapRemove(Timer_Service* service, uint32_t index)
+{
+	--service->heapSize;
+	if (index == service->heapSize)
+	{
+		return;
+	}
+
+	service->heap[index] = service->heap[service->heapSize];
+	Timer_SiftDown(service, index);
+	Timer_SiftUp(service, index);
+}
+
+/**
+ * Set the FPGA timer for the earliest deadline if it is not set for it yet.
+ * Called with the lock held.
+ *
+ * The FPGA timer takes a delay in microseconds. The delay is computed from the
+ * absolute deadline and rounded up, so the IRQ never comes early and the
+ * rounding does not add up from one period to the next.
+ *
+ * @param[in]  service   The service.
+ * @param[in]  now       The current time, in nanoseconds.
+ */
+static void Timer_Arm(Timer_Service* service, uint64_t now)
+{
+	uint64_t next;
+	uint64_t delay;
+
+	if (service->heapSize == 0)
+	{
+		return;
+	}
+
+	next = service->timer[service->heap[0]].deadline;
+	if (next == service->armed)
+	{
+		return;
+	}
+
+	delay = (next > now) ? (next - now + 999) / 1000 : 1;
+	if (delay > UINT32_MAX)
+	{
+		delay = UINT32_MAX;
+	}
+
+	NiFpga_WriteU32(NiELVISIIIv10_session, IRQTIMERWRITE, (uint32_t)delay);
+	NiFpga_WriteBool(NiELVISIIIv10_session, IRQTIMERSETTIME, NiFpga_True);
+
+	service->armed = next;
+}
+
+/**
+ * Call the timers that are due and set the FPGA timer for the next one.
+ *
+ * A periodic timer is due again one period after its previous deadline, not
+ * after its callback, so the callback latency does not drift the schedule.
+ * If a whole period was missed, the missed periods are skipped and counted.
+ *
+ * @param[in]  service   The service.
+ */
+static void Timer_Run(Timer_Service* service)
+{
+	uint64_t now;
+
+	pthread_mutex_lock(&service->lock);
+
+	now = Timer_ReadNow(service);
+	while (service->heapSize > 0 && service->timer[service->heap[0]].deadline <= now)
+	{
+		uint32_t       id       = service->heap[0];
+		Timer_Entry*   entry    = &service->timer[id];
+		uint64_t       deadline = entry->deadline;
+		uint64_t       lateness = now - deadline;
+		Timer_Callback callback = entry->callback;
+		void*          data     = entry->data;
+
+		++entry->expirations;
+		if (lateness > entry->maxLateness)
+		{
+			entry->maxLateness = lateness;
+		}
+
+		if (entry->period != 0)
+		{
+			uint64_t skipped = lateness / entry->period;
+
+			entry->missed  += (uint32_t)skipped;
+			entry->deadline = deadline + (skipped + 1) * entry->period;
+			Timer_SiftDown(service, 0);
+			Thread_CheckOverrun(&service->stats, lateness, entry->period);
+		}
+		else
+		{
+			Timer_HeapRemove(service, 0);
+			entry->callback = NULL;
+		}
+
+		/*
+		 * Call without the lock so the callback can add and cancel timers.
+		 */
+		pthread_mutex_unlock(&service->lock);
+		callback(id, deadline, now, data);
+		pthread_mutex_lock(&service->lock);
+
+		now = Timer_ReadNow(service);
+	}
+
+	Timer_Arm(service, now);
+
+	pthread_mutex_unlock(&service->lock);
+}
+
+/**
+ * The service thread. Calls the timers that are due and waits for the FPGA timer IRQ.
+ *
+ * @param[in]  resource   The service.
+ */
+static void* Timer_ServiceThread(void* resource)
+{
+	Timer_Service* service = (Timer_Service*)resource;
+	NiFpga_Status  status;
+	NiFpga_Bool    timedOut;
+	uint32_t       irqAssert;
+
+	while (service->running)
+	{
+		Timer_Run(service);
+
+		irqAssert = 0;
+		timedOut  = NiFpga_False;
+		status = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
+		                           service->irqContext,
+		                           (uint32_t)1 << TIMER_SERVICE_IRQNO,
+		                           TIMER_SERVICE_TIMEOUT,
+		                           &irqAssert,
+		                           &timedOut);
+		if (NiFpga_IsError(status))
+		{
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not enter the NiFpga_WaitOnIrqs().\n");
+			continue;
+		}
+
+		if (!timedOut && (irqAssert & ((uint32_t)1 << TIMER_SERVICE_IRQNO)))
+		{
+			status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, (uint32_t)1 << TIMER_SERVICE_IRQNO);
+			NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not acknowledge IRQ(s)!");
+
+			/*
+			 * The FPGA timer is not set anymore.
+			 */
+			pthread_mutex_lock(&service->lock);
+			service->armed = 0;
+			pthread_mutex_unlock(&service->lock);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Reserve the timer IRQ and start the service thread.
+ *
+ * The service uses the only FPGA timer, so Irq_RegisterTimerIrq cannot be used
+ * while it runs.
+ *
+ * @param[in]  service   The service to start.
+ * @param[in]  config    How the service thread is scheduled, or NULL for
+ *                       SCHED_FIFO at THREAD_IRQ_PRIORITY.
+ *
+ * @return the configure status.
+ */
+int32_t Timer_StartService(Timer_Service* service, const Thread_Config* config)
+{
+	Thread_Config threadConfig;
+	int32_t       status;
+
+	memset(service, 0, sizeof(Timer_Service));
+
+	if (config != NULL)
+	{
+		threadConfig = *config;
+	}
+	else
+	{
+		Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+	}
+	threadConfig.stats = &service->stats;
+
+	status = Irq_AddReserved(Irq_Timer_0, TIMER_SERVICE_IRQNO);
+	if (status != NiELVISIIIv10_Status_Success)
+	{
+		printf("You have already registered the only timer interrupt.\n");
+		return status;
+	}
+
+	status = Irq_AcquireContext(&service->irqContext);
+	if (NiFpga_IsError(status))
+	{
+		NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not acquired.");
+		Irq_RemoveReserved(TIMER_SERVICE_IRQNO);
+		return status;
+	}
+
+	pthread_mutex_init(&service->lock, NULL);
+	Timer_ReadNow(service);
+
+	service->running = NiFpga_True;
+
+	status = Thread_Create(&service->thread, &threadConfig, Timer_ServiceThread, service);
+	if (status != 0)
+	{
+		printf("Failed to create the timer service thread!\n");
+		service->running = NiFpga_False;
+		pthread_mutex_destroy(&service->lock);
+		Irq_ReleaseContext(service->irqContext);
+		Irq_RemoveReserved(TIMER_SERVICE_IRQNO);
+		return status;
+	}
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Stop the service thread, disable the FPGA timer and release the timer IRQ.
+ * The thread stops within TIMER_SERVICE_TIMEOUT milliseconds.
+ *
+ * @param[in]  service   The service to stop.
+ *
+ * @return the configure status.
+ */
+int32_t Timer_StopService(Timer_Service* service)
+{
+	int32_t status;
+
+	service->running = NiFpga_False;
+	pthread_join(service->thread, NULL);
+
+	/*
+	 * Disable the FPGA timer.
+	 */
+	NiFpga_WriteU32(NiELVISIIIv10_session, IRQTIMERWRITE, 0);
+	status = NiFpga_WriteBool(NiELVISIIIv10_session, IRQTIMERSETTIME, NiFpga_True);
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not write to IRQTIMERSETTIME register!");
+
+	pthread_mutex_destroy(&service->lock);
+	Irq_RemoveReserved(TIMER_SERVICE_IRQNO);
+
+	status = Irq_ReleaseContext(service->irqContext);
+	NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
+
+	return status;
+}
+
+/**
+ * Add a periodic or one-shot timer.
+ *
+ * The first expiration is delay nanoseconds from now. A periodic timer then
+ * expires every period nanoseconds after its previous deadline. Deadlines are
+ * kept in nanoseconds, so periods that are not a whole number of microseconds
+ * do not drift.
+ *
+ * @param[in]  service    The service.
+ * @param[in]  delay      Time to the first expiration, in nanoseconds.
+ * @param[in]  period     Period in nanoseconds, or 0 for a one-shot timer.
+ * @param[in]  callback   Function called by the service thread.
+ * @param[in]  data       Passed to callback.
+ * @param[out] timerId    ID to pass to Timer_Cancel.
+ *
+ * @return the configure status.
+ */
+int32_t Timer_Add(Timer_Service* service,
+                  uint64_t       delay,
+                  uint64_t       period,
+                  Timer_Callback callback,
+                  void*          data,
+                  uint32_t*      timerId)
+{
+	Timer_Entry* entry;
+	uint32_t     id;
+	uint64_t     now;
+
+	if (callback == NULL)
+	{
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	pthread_mutex_lock(&service->lock);
+
+	for (id = 0; id < TIMER_SERVICE_MAX; ++id)
+	{
+		if (service->timer[id].callback == NULL)
+		{
+			break;
+		}
+	}
+	if (id == TIMER_SERVICE_MAX)
+	{
+		pthread_mutex_unlock(&service->lock);
+		printf("All the timers of the timer service are used.\n");
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	now = Timer_ReadNow(service);
+
+	entry = &service->timer[id];
+	memset(entry, 0, sizeof(Timer_Entry));
+	entry->callback = callback;
+	entry->data     = data;
+	entry->deadline = now + delay;
+	entry->period   = period;
+
+	service->heap[service->heapSize] = id;
+	Timer_SiftUp(service, service->heapSize++);
+
+	/*
+	 * Set the FPGA timer again if the new timer is the earliest.
+	 */
+	if (service->armed == 0 || entry->deadline < service->armed)
+	{
+		Timer_Arm(service, now);
+	}
+
+	pthread_mutex_unlock(&service->lock);
+
+	*timerId = id;
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Remove a timer. Its callback is not called anymore unless it is running.
+ *
+ * @param[in]  service   The service.
+ * @param[in]  timerId   ID returned by Timer_Add.
+ *
+ * @return the configure status.
+ */
+int32_t Timer_Cancel(Timer_Service* service, uint32_t timerId)
+{
+	uint32_t index;
+
+	if (timerId >= TIMER_SERVICE_MAX)
+	{
+		return NiFpga_Status_InvalidParameter;
+	}
+
+	pthread_mutex_lock(&service->lock);
+
+	for (index = 0; index < service->heapSize; ++index)
+	{
+		if (service->heap[index] == timerId)
+		{
+			Timer_HeapRemove(service, index);
+			break;
+		}
+	}
+	service->timer[timerId].callback = NULL;
+
+	pthread_mutex_unlock(&service->lock);
+
+	return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Get the time of the FPGA timer, on the same time base as the deadlines.
+ *
+ * @param[in]  service   The service.
+ *
+ * @return the time in nanoseconds.
+ */
+uint64_t Timer_GetNow(Timer_Service* service)
+{
+	uint64_t now;
+
+	pthread_mutex_lock(&service->lock);
+	now = Timer_ReadNow(service);
+	pthread_mutex_unlock(&service->lock);
+
+	return now;
+}
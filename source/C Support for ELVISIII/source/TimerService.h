@@ -0,0 +1,115 @@
+/**
+ * TimerService.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef TimerService_h_
+#define TimerService_h_
+
+#include <pthread.h>
+#include "NiELVISIIIv10.h"
+#include "IRQConfigure.h"
+#include "ThreadConfig.h"
+
+/**
+ * The IRQ number of the FPGA timer.
+ */
+#if !defined(TIMER_SERVICE_IRQNO)
+#define TIMER_SERVICE_IRQNO 0
+#endif
+
+/**
+ * The maximum number of logical timers.
+ */
+#if !defined(TIMER_SERVICE_MAX)
+#define TIMER_SERVICE_MAX 32
+#endif
+
+/**
+ * How long the service thread waits before it checks for a stop request, in milliseconds.
+ */
+#if !defined(TIMER_SERVICE_TIMEOUT)
+#define TIMER_SERVICE_TIMEOUT 100
+#endif
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/*
+ * Function called by the service thread when a timer expires.
+ * deadline is when the timer was due and now is when it was handled, both on the
+ * FPGA timer, in nanoseconds.
+ */
+typedef void (*Timer_Callback)(uint32_t timerId, uint64_t deadline, uint64_t now, void* data);
+
+/*
+ * One logical timer.
+ */
+typedef struct
+{
+	Timer_Callback callback;      /* Function to call, or NULL if the timer is free */
+	void*          data;          /* Passed to callback */
+	uint64_t       deadline;      /* Next expiration on the FPGA timer, in nanoseconds */
+	uint64_t       period;        /* Period in nanoseconds, 0 for a one-shot timer */
+	uint32_t       expirations;   /* Number of times the callback was called */
+	uint32_t       missed;        /* Periods skipped because the callback was too late */
+	uint64_t       maxLateness;   /* Longest time from a deadline to its callback, in nanoseconds */
+} Timer_Entry;
+
+/*
+ * Logical timers that share the FPGA timer IRQ.
+ */
+typedef struct
+{
+	Timer_Entry        timer[TIMER_SERVICE_MAX];
+	uint32_t           heap[TIMER_SERVICE_MAX];   /* Active timer IDs, ordered by deadline */
+	uint32_t           heapSize;
+	pthread_mutex_t    lock;                      /* Protects the timers, the heap and the FPGA timer */
+	NiFpga_IrqContext  irqContext;
+	pthread_t          thread;
+	volatile NiFpga_Bool running;
+	uint32_t           lastRead;                  /* Last value read from IRQTIMERREAD */
+	uint64_t           wraps;                     /* Microseconds added for the wrap-arounds of IRQTIMERREAD */
+	uint64_t           armed;                     /* Deadline the FPGA timer is set for, or 0 */
+	Thread_Stats       stats;                     /* Page faults and overruns of the service thread */
+} Timer_Service;
+
+/**
+ * Reserve the timer IRQ and start the service thread.
+ */
+int32_t Timer_StartService(Timer_Service* service, const Thread_Config* config);
+
+/**
+ * Stop the service thread and release the timer IRQ.
+ */
+int32_t Timer_StopService(Timer_Service* service);
+
+/**
+ * Add a periodic or one-shot timer.
+ */
+int32_t Timer_Add(Timer_Service* service,
+                  uint64_t       delay,
+                  uint64_t       period,
+                  Timer_Callback callback,
+                  void*          data,
+                  uint32_t*      timerId);
+
+/**
+ * Remove a timer.
+ */
+int32_t Timer_Cancel(Timer_Service* service, uint32_t timerId);
+
+/**
+ * Get the time of the FPGA timer in nanoseconds.
+ */
+uint64_t Timer_GetNow(Timer_Service* service);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif /* TimerService_h_ */
@@ -265,17 +265,6 @@ int32_t Irq_RegisterAiIrq(ELVISIII_IrqAi*    bank,
     uint32_t Threshold;
     uint32_t Hysteresis;
 
-    // Reserve an IRQ context. IRQ contexts are single-threaded; only one thread
-    // can wait with a particular context at any given time. To minimize jitter
-    // when first waiting on IRQs, reserve as many contexts as the application requires.
-    // If a context is successfully reserved, you must unreserve it later.
-    // Otherwise a memory leak will occur.
-    status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, irqContext);
-
-    // Check if there was an error when you reserve an IRQ.
-    // If there was an error, print an error message to stdout and return configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
-
     // Limit the IRQ number within a range,
     // if the entered value is out of range, print an error message.
     if (irqNumber > IRQNO_MAX || irqNumber < IRQNO_MIN)
@@ -284,9 +273,10 @@ int32_t Irq_RegisterAiIrq(ELVISIII_IrqAi*    bank,
         return NiELVISIIIv10_Status_IrqNumberNotUsable;
     }
 
-    // Check if the IRQ number or channel value already existed in the resource list,
-    // return configuration status, and print an error message.
-    status = Irq_CheckReserved(bank->aiChannel, irqNumber);
+    // Reserve the IRQ number and channel value in the resource list. The reservation is
+    // atomic, so it fails if another thread already reserved either of them.
+    // If it fails, return the configuration status and print an error message.
+    status = Irq_AddReserved(bank->aiChannel, irqNumber);
     if (status == NiELVISIIIv10_Status_IrqNumberNotUsable)
     {
         printf("You have already registered an interrupt with the same interrupt number.\n");
@@ -298,6 +288,21 @@ int32_t Irq_RegisterAiIrq(ELVISIII_IrqAi*    bank,
         return status;
     }
 
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once the IRQ
+    // is reserved, so an IRQ that cannot be registered never holds a context. IRQ contexts
+    // are single-threaded; only one thread can wait with a particular context at
+    // any given time. The context must be returned to the pool later.
+    status = Irq_AcquireContext(irqContext);
+
+    // Check if there was an error when you took the IRQ context.
+    // If there was an error, release the IRQ, print an error message to stdout and return the configuration status.
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        Irq_RemoveReserved(irqNumber);
+        printf("A required NiFpga_IrqContext was not acquired.\n");
+        return status;
+    }
+
     // Write the value to the AI IRQ number register.
     // The returned NiFpga_Status value is stored for error checking.
     status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->aiIrqNumber[bank->aiChannel], irqNumber);
@@ -401,9 +406,6 @@ int32_t Irq_RegisterAiIrq(ELVISIII_IrqAi*    bank,
     // If there was an error, print an error message to stdout and return configuration status.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to the AI Configuration Register!");
 
-    // Add the channel value and IRQ number in the list.
-    Irq_AddReserved(bank->aiChannel, irqNumber);
-
     return NiELVISIIIv10_Status_Success;
 }
 
@@ -478,13 +480,13 @@ int32_t Irq_UnregisterAiIrq(ELVISIII_IrqAi*   bank,
     // If there was an error, print an error message to stdout and return configuration status.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not release the IRQ resource!");
 
-    // Unreserve an IRQ context obtained from Irq_ReserveIrqContext.
+    // Return the IRQ context obtained from Irq_AcquireContext() to the pool.
     // The returned NiFpga_Status value is stored for error checking.
-    status = NiFpga_UnreserveIrqContext(NiELVISIIIv10_session, irqContext);
+    status = Irq_ReleaseContext(irqContext);
 
     // Check if there was an error when you wrote to the AI Threshold Register.
     // If there was an error, print an error message to stdout and return configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not unreserved.");
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
 
     return NiELVISIIIv10_Status_Success;
 }
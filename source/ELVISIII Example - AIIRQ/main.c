@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <pthread.h>
+#include "ThreadConfig.h"
 #include "AIIRQ.h"
 
 #if !defined(LoopDuration)
@@ -49,6 +50,8 @@ int main(int argc, char **argv)
     ThreadResource irqThread0;
 
     pthread_t thread;
+    Thread_Config threadConfig;
+    Thread_Stats threadStats;
 
     time_t currentTime;
     time_t finalTime;
@@ -102,12 +105,22 @@ int main(int argc, char **argv)
         return status;
     }
 
+    // Reserve the timer IRQ to wake the IRQ thread when it is stopped, so it
+    // waits without a timeout and stops at once.
+    Irq_ReserveCancelIrq();
+
     // Set the indicator to allow the new thread.
     irqThread0.irqThreadRdy = NiFpga_True;
 
+    // Lock the memory of the process so the IRQ thread never waits for a page fault.
+    Thread_LockMemory();
+
     // Create new threads to catch the specified IRQ numbers.
     // Different IRQs should have different corresponding threads.
-    status = pthread_create(&thread, NULL, AI_Irq_Thread, &irqThread0);
+    // The IRQ thread runs with SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+    Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+    threadConfig.stats = &threadStats;
+    status = Thread_Create(&thread, &threadConfig, AI_Irq_Thread, &irqThread0);
     if (status != NiELVISIIIv10_Status_Success)
     {
         printf("CONFIGURE ERROR: %d\n, Failed to create a new thread!", status);
@@ -137,9 +150,18 @@ int main(int argc, char **argv)
     // Set the indicator to end the new thread.
     irqThread0.irqThreadRdy = NiFpga_False;
 
+    // Wake the IRQ thread from its wait.
+    Irq_CancelWaits();
+
     // Wait for the end of the IRQ thread.
     pthread_join(thread, NULL);
 
+    // Report the page faults the IRQ thread took after it started.
+    Thread_PrintStats("IRQ thread", &threadStats);
+
+    // Allow waiting again and release the timer IRQ reserved for cancellation.
+    Irq_ReleaseCancelIrq();
+
     // Disable AI0, so you can configure this I/O next time.
     // Every IrqConfigure() function should have its corresponding clear function,
     // and their parameters should also match.
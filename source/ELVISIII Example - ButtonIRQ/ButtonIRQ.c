@@ -48,17 +48,6 @@ int32_t Irq_RegisterButtonIrq(ELVISIII_IrqButton* irqButton,
 {
     NiFpga_Bool status;
 
-    // Reserve an IRQ context. IRQ contexts are single-threaded; only one thread
-    // can wait with a particular context at any given time. To minimize jitter
-    // when first waiting on IRQs, reserve as many contexts as the application requires.
-    // If a context is successfully reserved, you must unreserve it later.
-    // Otherwise a memory leak will occur.
-    status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, irqContext);
-
-    // Check if there was an error when you reserved an IRQ.
-    // If there was an error, print an error message to stdout and return the configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
-
     // Limit the IRQ number within a range,
     // if the entered value is out of range, print an error message.
     if (irqNumber > IRQNO_MAX || irqNumber < IRQNO_MIN)
@@ -67,9 +56,10 @@ int32_t Irq_RegisterButtonIrq(ELVISIII_IrqButton* irqButton,
         return NiELVISIIIv10_Status_IrqNumberNotUsable;
     }
 
-    // Check if the IRQ number or channel value already exists in the resource list,
-    // return configuration status, and print an error message.
-    status = Irq_CheckReserved(irqButton->btnChannel, irqNumber);
+    // Reserve the IRQ number and channel value in the resource list. The reservation is
+    // atomic, so it fails if another thread already reserved either of them.
+    // If it fails, return the configuration status and print an error message.
+    status = Irq_AddReserved(irqButton->btnChannel, irqNumber);
     if (status == NiELVISIIIv10_Status_IrqNumberNotUsable)
     {
         printf("You have already registered an interrupt with the same interrupt number.\n");
@@ -81,6 +71,21 @@ int32_t Irq_RegisterButtonIrq(ELVISIII_IrqButton* irqButton,
         return status;
     }
 
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once the IRQ
+    // is reserved, so an IRQ that cannot be registered never holds a context. IRQ contexts
+    // are single-threaded; only one thread can wait with a particular context at
+    // any given time. The context must be returned to the pool later.
+    status = Irq_AcquireContext(irqContext);
+
+    // Check if there was an error when you took the IRQ context.
+    // If there was an error, release the IRQ, print an error message to stdout and return the configuration status.
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        Irq_RemoveReserved(irqNumber);
+        printf("A required NiFpga_IrqContext was not acquired.\n");
+        return status;
+    }
+
     // Write the value to the Button IRQ Number Register.
     status = NiFpga_WriteU8(NiELVISIIIv10_session, irqButton->btnIrqNumber, irqNumber);
 
@@ -122,9 +127,6 @@ int32_t Irq_RegisterButtonIrq(ELVISIII_IrqButton* irqButton,
         NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to IRQ Fall-Trigger Register!");
     }
 
-    // Add the channel value and IRQ number to the list.
-    Irq_AddReserved(irqButton->btnChannel, irqNumber);
-
     return NiELVISIIIv10_Status_Success;
 }
 
@@ -173,13 +175,13 @@ int32_t Irq_UnregisterButtonIrq(ELVISIII_IrqButton* irqButton,
     // If there was an error, print an error message to stdout and return the configuration status.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not release the IRQ resource!");
 
-    // Unreserve an IRQ context obtained from Irq_ReserveIrqContext.
+    // Return the IRQ context obtained from Irq_AcquireContext() to the pool.
     // The returned NiFpga_Status value is stored for error checking.
-    status = NiFpga_UnreserveIrqContext(NiELVISIIIv10_session, irqContext);
+    status = Irq_ReleaseContext(irqContext);
 
     // Check if there was an error when you reserved an IRQ.
     // If there was an error, print an error message to stdout and return the configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not unreserved.");
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
 
     return NiELVISIIIv10_Status_Success;
 }
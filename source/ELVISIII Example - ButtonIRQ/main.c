@@ -8,9 +8,13 @@
  * IRQ number, trigger times, and main loop count number in the console.
  * The main thread runs for 60s.
  *
+ * Run with -d to receive the IRQ through the IRQ dispatcher of the C Support
+ * project instead of a thread of its own. The callback is set before the
+ * dispatcher starts, and the dispatcher is stopped without cancelling other waits.
+ *
  * Instructions:
  * 1. Push the button if you select the button IRQ.
- * 2. Run this program and observe the console.
+ * 2. Run this program, optionally with -d, and observe the console.
  *
  * Output:
  * IRQ3, triggered times and main loop count number are shown in the console.
@@ -20,7 +24,10 @@
  */
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
 #include <pthread.h>
+#include "ThreadConfig.h"
+#include "IRQDispatcher.h"
 #include "ButtonIRQ.h"
 
 #if !defined(LoopDuration)
@@ -41,6 +48,20 @@ typedef struct
     uint8_t           irqNumber;       // IRQ number value 
 } ThreadResource;
 
+/**
+ * Print the IRQ on the dispatcher thread.
+ * The dispatcher acknowledges the IRQ when the callback returns.
+ *
+ * @param[in]  event   The IRQ received.
+ * @param[in]  data    Not used.
+ */
+static void Button_Irq_Callback(const Irq_Event* event, void* data)
+{
+    (void)data;
+
+    printf("IRQ%d,%d\n", event->irqNumber, event->count);
+}
+
 int main(int argc, char **argv)
 {
     NiFpga_Bool status;
@@ -48,6 +69,12 @@ int main(int argc, char **argv)
     ThreadResource irqThread0;
 
     pthread_t thread;
+    Thread_Config threadConfig;
+    Thread_Stats threadStats;
+
+    Irq_Dispatcher dispatcher;
+    NiFpga_Bool useDispatcher = NiFpga_False;
+    int option;
 
     time_t currentTime;
     time_t finalTime;
@@ -58,6 +85,19 @@ int main(int argc, char **argv)
     const uint32_t CountConfigure = 1;
     const Irq_Button_Type TriggerTypeConfigure = Irq_Button_RisingEdge;
 
+    while ((option = getopt(argc, argv, "d")) != -1)
+    {
+        if (option == 'd')
+        {
+            useDispatcher = NiFpga_True;
+        }
+        else
+        {
+            printf("Usage: %s [-d]\n", argv[0]);
+            return 1;
+        }
+    }
+
     printf("Button Input IRQ:\n");
 
     irqButton.btnChannel = Irq_Button_0;
@@ -89,16 +129,43 @@ int main(int argc, char **argv)
         return status;
     }
 
+    // Reserve the timer IRQ to wake the IRQ thread when it is stopped, so it
+    // waits without a timeout and stops at once.
+    Irq_ReserveCancelIrq();
+
     // Set the indicator to allow the new thread.
     irqThread0.irqThreadRdy = NiFpga_True;
 
-    // Create new threads to catch the specified IRQ numbers.
-    // Different IRQs should have different corresponding threads.
-    status = pthread_create(&thread, NULL, Button_Irq_Thread, &irqThread0);
-    if (status != NiELVISIIIv10_Status_Success)
+    // Lock the memory of the process so the IRQ thread never waits for a page fault.
+    Thread_LockMemory();
+
+    if (useDispatcher)
     {
-        printf("CONFIGURE ERROR: %d, Failed to create a new thread!",status);
-        return status;
+        // Set the callback of the IRQ, then start the dispatcher. Its thread
+        // waits on every IRQ set, with one IRQ context of its own, and runs with
+        // SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+        Irq_InitDispatcher(&dispatcher);
+        Irq_SetCallback(&dispatcher, IrqNumberConfigure, Button_Irq_Callback, NULL);
+        status = Irq_StartDispatcher(&dispatcher);
+        if (status != NiELVISIIIv10_Status_Success)
+        {
+            printf("CONFIGURE ERROR: %d, Failed to start the IRQ dispatcher!", status);
+            return status;
+        }
+    }
+    else
+    {
+        // Create new threads to catch the specified IRQ numbers.
+        // Different IRQs should have different corresponding threads.
+        // The IRQ thread runs with SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+        Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+        threadConfig.stats = &threadStats;
+        status = Thread_Create(&thread, &threadConfig, Button_Irq_Thread, &irqThread0);
+        if (status != NiELVISIIIv10_Status_Success)
+        {
+            printf("CONFIGURE ERROR: %d, Failed to create a new thread!",status);
+            return status;
+        }
     }
 
     // Normally, the main function runs a long running or infinite loop.
@@ -121,11 +188,32 @@ int main(int argc, char **argv)
         }
     }
 
-    // Set the indicator to end the new thread.
-    irqThread0.irqThreadRdy = NiFpga_False;
+    if (useDispatcher)
+    {
+        // Wake the dispatcher thread and wait for its end. The other waits are
+        // not cancelled.
+        Irq_StopDispatcher(&dispatcher);
+
+        // Report the page faults the dispatcher thread took after it started.
+        Thread_PrintStats("IRQ dispatcher", &dispatcher.stats);
+    }
+    else
+    {
+        // Set the indicator to end the new thread.
+        irqThread0.irqThreadRdy = NiFpga_False;
+
+        // Wake the IRQ thread from its wait.
+        Irq_CancelWaits();
+
+        // Wait for the end of the IRQ thread.
+        pthread_join(thread, NULL);
+
+        // Report the page faults the IRQ thread took after it started.
+        Thread_PrintStats("IRQ thread", &threadStats);
+    }
 
-    // Wait for the end of the IRQ thread.
-    pthread_join(thread, NULL);
+    // Allow waiting again and release the timer IRQ reserved for cancellation.
+    Irq_ReleaseCancelIrq();
 
     // Disable the button interrupt, so you can configure this I/O next time.
     // Every IrqConfigure() function should have its corresponding clear function,
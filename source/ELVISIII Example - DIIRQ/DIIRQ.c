@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
 /**
  * Include the ELVIS III header file.
@@ -55,17 +56,6 @@ int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
     uint8_t cnfgValue;
     uint16_t typeValue;
 
-    // Reserve an IRQ context. IRQ contexts are single-threaded; only one thread
-    // can wait with a particular context at any given time. To minimize jitter
-    // when first waiting on IRQs, reserve as many contexts as the application requires.
-    // If a context is successfully reserved, you must unreserve it later.
-    // Otherwise a memory leak will occur.
-    status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, irqContext);
-
-    // Check if there was an error when you reserved an IRQ.
-    // If there was an error, print an error message to stdout and return the configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
-
     // Limit the IRQ number within a range,
     // if the entered value is out of range, print an error message.
     if (irqNumber > IRQNO_MAX || irqNumber < IRQNO_MIN)
@@ -74,9 +64,10 @@ int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
         return NiELVISIIIv10_Status_IrqNumberNotUsable;
     }
 
-    // Check if the IRQ number or channel value already exists in the resource list,
-    // return the configuration status and print error message.
-    status = Irq_CheckReserved(bank->dioChannel, irqNumber);
+    // Reserve the IRQ number and channel value in the resource list. The reservation is
+    // atomic, so it fails if another thread already reserved either of them.
+    // If it fails, return the configuration status and print an error message.
+    status = Irq_AddReserved(bank->dioChannel, irqNumber);
     if (status == NiELVISIIIv10_Status_IrqNumberNotUsable)
     {
         printf("You have already registered an interrupt with the same interrupt number.\n");
@@ -88,6 +79,21 @@ int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
         return status;
     }
 
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once the IRQ
+    // is reserved, so an IRQ that cannot be registered never holds a context. IRQ contexts
+    // are single-threaded; only one thread can wait with a particular context at
+    // any given time. The context must be returned to the pool later.
+    status = Irq_AcquireContext(irqContext);
+
+    // Check if there was an error when you took the IRQ context.
+    // If there was an error, release the IRQ, print an error message to stdout and return the configuration status.
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        Irq_RemoveReserved(irqNumber);
+        printf("A required NiFpga_IrqContext was not acquired.\n");
+        return status;
+    }
+
     // Write the value to the DI IRQ number register.
     status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->dioIrqNumber[bank->dioChannel - 2], irqNumber);
 
@@ -234,9 +240,6 @@ int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
     // If there was an error then print an error message to stdout.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to the DI Rise/Fall Configuration Register!");
 
-    // Add the channel value and IRQ number in the list.
-    Irq_AddReserved(bank->dioChannel, irqNumber);
-
     return NiELVISIIIv10_Status_Success;
 }
 
@@ -321,13 +324,318 @@ int32_t Irq_UnregisterDiIrq(ELVISIII_IrqDi*   bank,
     // If there was an error then print an error message to stdout.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not release the IRQ resource!");
 
-    // Unreserve an IRQ context obtained from Irq_ReserveIrqContext.
+    // Return the IRQ context obtained from Irq_AcquireContext() to the pool.
     // The returned NiFpga_Status value is stored for error checking.
-    status = NiFpga_UnreserveIrqContext(NiELVISIIIv10_session, irqContext);
+    status = Irq_ReleaseContext(irqContext);
 
     // Check if there was an error when unreserve an IRQ.
     // If there was an error then print an error message to stdout and return configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not unreserved.");
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
+
+    return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Write a new count to the DI IRQ count register of the channel.
+ *
+ * @param[in]  bank       A struct containing the registers and settings for a particular digital IRQ IO.
+ * @param[in]  coalesce   The coalescing state.
+ * @param[in]  count      The new count.
+ *
+ * @return the configuration status.
+ */
+static int32_t Irq_WriteDiCount(ELVISIII_IrqDi* bank, Irq_DiCoalesce* coalesce, uint32_t count)
+{
+    NiFpga_Status status;
+
+    status = NiFpga_WriteU32(NiELVISIIIv10_session, bank->dioCount[bank->dioChannel - 2], count);
+
+    // Check if there was an error writing to the DI IRQ count register.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to DI IRQ Count Register!");
+
+    coalesce->count = count;
 
     return NiELVISIIIv10_Status_Success;
 }
+
+/**
+ * Let the DI IRQ count follow the edge rate of the input.
+ * Call it after Irq_RegisterDiIrq, then call Irq_UpdateDiCoalesce every time the IRQ is received.
+ *
+ * The count is raised until the host receives at most rateBound IRQs per second, but
+ * never so high that the first edge of a batch waits longer than latencyBound for the IRQ.
+ * The latency bound wins when both cannot be met.
+ *
+ * @param[in]  bank           A struct containing the registers and settings for a particular digital IRQ IO.
+ * @param[in]  coalesce       The coalescing state to initialize.
+ * @param[in]  minCount       The smallest count, used until the rate is known.
+ * @param[in]  maxCount       The largest count.
+ * @param[in]  latencyBound   Longest time the first edge of a batch may wait for the IRQ, in microseconds.
+ * @param[in]  rateBound      Most IRQs per second the host should receive.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_EnableDiCoalesce(ELVISIII_IrqDi* bank,
+                             Irq_DiCoalesce* coalesce,
+                             uint32_t        minCount,
+                             uint32_t        maxCount,
+                             uint32_t        latencyBound,
+                             uint32_t        rateBound)
+{
+    NiFpga_Status status;
+
+    // The count must be at least 1 and the bounds must leave a range to adapt in.
+    if (minCount == 0 || maxCount < minCount || rateBound == 0)
+    {
+        printf("The coalescing bounds of the DI IRQ are not valid.\n");
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    memset(coalesce, 0, sizeof(Irq_DiCoalesce));
+    coalesce->minCount     = minCount;
+    coalesce->maxCount     = maxCount;
+    coalesce->latencyBound = latencyBound;
+    coalesce->rateBound    = rateBound;
+
+    // Start from the FPGA timer now, so the first IRQ measures the rate since coalescing was enabled.
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &coalesce->lastIrqTime);
+
+    // Check if there was an error reading from the timer.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not read from the IRQ Timer Register!");
+
+    return Irq_WriteDiCount(bank, coalesce, minCount);
+}
+
+/**
+ * Choose the DI IRQ count for the smoothed edge rate.
+ *
+ * @param[in]  coalesce   The coalescing state.
+ *
+ * @return the count, within minCount and maxCount.
+ */
+static uint32_t Irq_ChooseDiCount(const Irq_DiCoalesce* coalesce)
+{
+    uint32_t rateCount;
+    uint32_t latencyCount;
+    uint32_t count;
+
+    // The count that keeps the IRQ rate within its bound, and the largest count
+    // that keeps the first edge of a batch within the latency bound.
+    rateCount    = (uint32_t)(coalesce->edgeRate / coalesce->rateBound) + 1;
+    latencyCount = (uint32_t)(coalesce->edgeRate * coalesce->latencyBound / 1e6) + 1;
+
+    count = (rateCount < latencyCount) ? rateCount : latencyCount;
+    if (count < coalesce->minCount)
+    {
+        count = coalesce->minCount;
+    }
+    if (count > coalesce->maxCount)
+    {
+        count = coalesce->maxCount;
+    }
+
+    return count;
+}
+
+/**
+ * Measure the rate of the DI IRQ that was just received and adjust its count.
+ * Call it before the IRQ is acknowledged, so the FPGA counts the next batch with the new count.
+ *
+ * The edge rate is smoothed when it rises and followed at once when it falls,
+ * so a slower input does not keep a count that breaks the latency bound.
+ * When the input stops, the edges of an unfinished batch are only reported
+ * with the next IRQ.
+ *
+ * @param[in]  bank       A struct containing the registers and settings for a particular digital IRQ IO.
+ * @param[in]  coalesce   The coalescing state.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_UpdateDiCoalesce(ELVISIII_IrqDi* bank,
+                             Irq_DiCoalesce* coalesce)
+{
+    NiFpga_Status status;
+    uint32_t now;
+    uint32_t interval;
+    uint32_t count;
+    double   edgeRate;
+    double   irqRate;
+
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &now);
+
+    // Check if there was an error reading from the timer.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not read from the IRQ Timer Register!");
+
+    // The state is odd while it is updated, so Irq_ReadDiCoalesce retries.
+    ++coalesce->sequence;
+    __sync_synchronize();
+
+    // The subtraction is correct when the timer wraps around.
+    interval = now - coalesce->lastIrqTime;
+    coalesce->lastIrqTime = now;
+    if (interval == 0)
+    {
+        interval = 1;
+    }
+
+    ++coalesce->irqs;
+    coalesce->edges += coalesce->count;
+
+    // The first edge of the batch came about count - 1 edge periods before the IRQ.
+    coalesce->latency = (uint32_t)((uint64_t)interval * (coalesce->count - 1) / coalesce->count);
+    if (coalesce->latency > coalesce->maxLatency)
+    {
+        coalesce->maxLatency = coalesce->latency;
+    }
+
+    // Smooth the rates over about 8 IRQs, but follow a falling edge rate at once.
+    edgeRate = coalesce->count * 1e6 / interval;
+    irqRate  = 1e6 / interval;
+    if (coalesce->irqs == 1 || edgeRate < coalesce->edgeRate)
+    {
+        coalesce->edgeRate = edgeRate;
+    }
+    else
+    {
+        coalesce->edgeRate += (edgeRate - coalesce->edgeRate) / 8;
+    }
+    if (coalesce->irqs == 1)
+    {
+        coalesce->irqRate = irqRate;
+    }
+    else
+    {
+        coalesce->irqRate += (irqRate - coalesce->irqRate) / 8;
+    }
+
+    // Lower the count at once, but only raise it by more than an eighth, so a
+    // steady input does not rewrite the register on every IRQ.
+    count = Irq_ChooseDiCount(coalesce);
+    if (count < coalesce->count || count > coalesce->count + coalesce->count / 8)
+    {
+        ++coalesce->changes;
+        status = Irq_WriteDiCount(bank, coalesce, count);
+    }
+
+    __sync_synchronize();
+    ++coalesce->sequence;
+
+    return status;
+}
+
+/**
+ * Get how long the IRQ thread may wait for the DI IRQ. When the wait times out,
+ * call Irq_TimeoutDiCoalesce, so the edges of a batch that the input stopped
+ * filling are not held longer than about latencyBound.
+ *
+ * @param[in]  coalesce   The coalescing state.
+ *
+ * @return the timeout in milliseconds, or NiFpga_InfiniteTimeout when the count
+ *         is already the smallest count.
+ */
+uint32_t Irq_GetDiCoalesceTimeout(const Irq_DiCoalesce* coalesce)
+{
+    if (coalesce->count <= coalesce->minCount)
+    {
+        return NiFpga_InfiniteTimeout;
+    }
+
+    return (coalesce->latencyBound + 999) / 1000;
+}
+
+/**
+ * Lower the DI IRQ count when no IRQ was received for latencyBound.
+ * Call it from the IRQ thread when the wait of Irq_GetDiCoalesceTimeout times out.
+ *
+ * Fewer than count edges came since the last IRQ, so the edge rate is lowered to
+ * at most that and the count is at least halved. Repeated timeouts bring the
+ * count down to minCount.
+ *
+ * @param[in]  bank       A struct containing the registers and settings for a particular digital IRQ IO.
+ * @param[in]  coalesce   The coalescing state.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_TimeoutDiCoalesce(ELVISIII_IrqDi* bank,
+                              Irq_DiCoalesce* coalesce)
+{
+    NiFpga_Status status;
+    uint32_t now;
+    uint32_t interval;
+    uint32_t count;
+    double   edgeRate;
+
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, IRQTIMERREAD, &now);
+
+    // Check if there was an error reading from the timer.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not read from the IRQ Timer Register!");
+
+    // Nothing to lower, or the wait returned early.
+    interval = now - coalesce->lastIrqTime;
+    if (coalesce->count <= coalesce->minCount || interval < coalesce->latencyBound)
+    {
+        return NiELVISIIIv10_Status_Success;
+    }
+
+    ++coalesce->sequence;
+    __sync_synchronize();
+
+    edgeRate = (coalesce->count - 1) * 1e6 / interval;
+    if (edgeRate < coalesce->edgeRate)
+    {
+        coalesce->edgeRate = edgeRate;
+    }
+
+    count = Irq_ChooseDiCount(coalesce);
+    if (count > coalesce->count / 2)
+    {
+        count = coalesce->count / 2;
+    }
+    if (count < coalesce->minCount)
+    {
+        count = coalesce->minCount;
+    }
+
+    ++coalesce->timeouts;
+    ++coalesce->changes;
+    status = Irq_WriteDiCount(bank, coalesce, count);
+
+    __sync_synchronize();
+    ++coalesce->sequence;
+
+    return status;
+}
+
+/**
+ * Copy the coalescing state while the IRQ thread may update it.
+ * The copy is retried until it holds the state between two updates.
+ *
+ * @param[in]  coalesce   The coalescing state.
+ * @param[out] snapshot   The copy.
+ */
+void Irq_ReadDiCoalesce(const Irq_DiCoalesce* coalesce, Irq_DiCoalesce* snapshot)
+{
+    uint32_t sequence;
+
+    for (;;)
+    {
+        sequence = coalesce->sequence;
+        __sync_synchronize();
+        if (sequence & 1)
+        {
+            continue;
+        }
+
+        memcpy(snapshot, (const void*)coalesce, sizeof(Irq_DiCoalesce));
+
+        __sync_synchronize();
+        if (coalesce->sequence == sequence)
+        {
+            break;
+        }
+    }
+}
@@ -68,6 +68,31 @@ typedef struct
     Irq_Channel dioChannel;              // DI IRQ supported I/O 
 } ELVISIII_IrqDi;
 
+// Bounds, state and metrics of the adaptive coalescing of a DI IRQ.
+// The count written to the DI IRQ count register follows the edge rate of the input.
+// Only the IRQ thread updates it; other threads copy it with Irq_ReadDiCoalesce.
+typedef struct
+{
+    volatile uint32_t sequence;  // Odd while the IRQ thread updates the state
+
+    uint32_t minCount;       // Smallest count written to the DI IRQ count register
+    uint32_t maxCount;       // Largest count written to the DI IRQ count register
+    uint32_t latencyBound;   // Longest time the first edge of a batch may wait for the IRQ, in microseconds
+    uint32_t rateBound;      // Most IRQs per second the host should receive
+
+    uint32_t count;          // Count written to the DI IRQ count register
+    uint32_t lastIrqTime;    // IRQTIMERREAD value at the previous IRQ
+
+    double   edgeRate;       // Smoothed edges per second
+    double   irqRate;        // Smoothed IRQs per second
+    uint32_t latency;        // Time the first edge of the last batch waited for the IRQ, in microseconds
+    uint32_t maxLatency;     // Longest latency since coalescing was enabled, in microseconds
+    uint32_t irqs;           // IRQs received since coalescing was enabled
+    uint64_t edges;          // Edges counted by these IRQs
+    uint32_t changes;        // Times the count was changed
+    uint32_t timeouts;       // Times the count was lowered because no IRQ came within the latency bound
+} Irq_DiCoalesce;
+
 // Configure the DI IRQ.
 int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
                           NiFpga_IrqContext* irqContext,
@@ -79,7 +104,29 @@ int32_t Irq_RegisterDiIrq(ELVISIII_IrqDi*    bank,
 int32_t Irq_UnregisterDiIrq(ELVISIII_IrqDi*   bank,
                             NiFpga_IrqContext irqContext,
                             uint8_t           irqNumber);
-							
+
+// Let the DI IRQ count follow the edge rate of the input.
+int32_t Irq_EnableDiCoalesce(ELVISIII_IrqDi* bank,
+                             Irq_DiCoalesce* coalesce,
+                             uint32_t        minCount,
+                             uint32_t        maxCount,
+                             uint32_t        latencyBound,
+                             uint32_t        rateBound);
+
+// Measure the rate of the DI IRQ that was just received and adjust its count.
+int32_t Irq_UpdateDiCoalesce(ELVISIII_IrqDi* bank,
+                             Irq_DiCoalesce* coalesce);
+
+// Get how long the IRQ thread may wait for the DI IRQ before it calls Irq_TimeoutDiCoalesce.
+uint32_t Irq_GetDiCoalesceTimeout(const Irq_DiCoalesce* coalesce);
+
+// Lower the DI IRQ count when no IRQ was received within the latency bound.
+int32_t Irq_TimeoutDiCoalesce(ELVISIII_IrqDi* bank,
+                              Irq_DiCoalesce* coalesce);
+
+// Copy the coalescing state while the IRQ thread may update it.
+void Irq_ReadDiCoalesce(const Irq_DiCoalesce* coalesce, Irq_DiCoalesce* snapshot);
+
 // Start a new thread to handle DI IRQ.
 void *DI_Irq_Thread(void* resource);
 
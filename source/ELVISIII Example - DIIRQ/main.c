@@ -6,6 +6,9 @@
  * Overview:
  * Demonstrates how to use the DI IRQ. Once the DI IRQ occurs, print
  * the IRQ number, trigger times and main loop count number in the console.
+ * The count of the DI IRQ adapts to the frequency of the input, so the IRQ
+ * rate and the latency of the first edge of each batch stay within bounds.
+ * When the input slows down, the IRQ thread times out and lowers the count.
  * The main thread runs for 60 s.
  *
  * Instructions:
@@ -16,7 +19,8 @@
  * 4. Run this program and observe the console.
  *
  * Output:
- * The IRQ2, triggered times and main loop count number.
+ * The IRQ2, triggered times, the DI IRQ count and main loop count number.
+ * Every 3 s, the edge rate, IRQ rate and latency of the DI IRQ.
  *
  * Note:
  * The Eclipse project defines the preprocessor symbol for the NI ELVIS III.
@@ -24,6 +28,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <pthread.h>
+#include "ThreadConfig.h"
 #include "DIIRQ.h"
 
 #if !defined(LoopDuration)
@@ -34,6 +39,18 @@
 #define LoopSteps             3    // How long to step between printing, in seconds 
 #endif
 
+#if !defined(CoalesceMaxCount)
+#define CoalesceMaxCount      10000 // Largest DI IRQ count the coalescing may set 
+#endif
+
+#if !defined(CoalesceLatency)
+#define CoalesceLatency       10000 // Longest time the first edge of a batch may wait, in microseconds 
+#endif
+
+#if !defined(CoalesceRate)
+#define CoalesceRate          100  // Most IRQs per second the IRQ thread should receive 
+#endif
+
 extern ELVISIII_IrqDi bank_A;
 
 // Resources for the new thread.
@@ -42,6 +59,8 @@ typedef struct
     NiFpga_IrqContext irqContext;      // IRQ context reserved by Irq_ReserveContext() 
     NiFpga_Bool       irqThreadRdy;    // IRQ thread ready flag 
     uint8_t           irqNumber;       // IRQ number value 
+    Irq_DiCoalesce    coalesce;        // Adaptive count and metrics of the DI IRQ 
+    volatile NiFpga_Bool woken;        // Set by Irq_WakeWait to stop the IRQ thread 
 } ThreadResource;
 
 int main(int argc, char **argv)
@@ -49,8 +68,11 @@ int main(int argc, char **argv)
     NiFpga_Status status;
 
     ThreadResource irqThread0;
+    Irq_DiCoalesce coalesce;
 
     pthread_t thread;
+    Thread_Config threadConfig;
+    Thread_Stats threadStats;
 
     time_t currentTime;
     time_t finalTime;
@@ -67,6 +89,7 @@ int main(int argc, char **argv)
 
     // Initiate the IRQ number resource of the new thread.
     irqThread0.irqNumber = IrqNumber;
+    irqThread0.woken = NiFpga_False;
 
     // Open the ELVIS III NiFpga Session.
     // This function MUST be called before all other functions. After this call
@@ -93,12 +116,37 @@ int main(int argc, char **argv)
         return status;
     }
 
+    // Let the DI IRQ count follow the edge rate of DI0. Count is the smallest
+    // count, used until the rate is known.
+    status = Irq_EnableDiCoalesce(&bank_A,
+                                  &(irqThread0.coalesce),
+                                  Count,
+                                  CoalesceMaxCount,
+                                  CoalesceLatency,
+                                  CoalesceRate);
+    if (status != NiELVISIIIv10_Status_Success)
+    {
+        printf("CONFIGURE ERROR: %d\n", status);
+        printf("Configuration of DI IRQ coalescing failed.");
+        return status;
+    }
+
+    // Reserve the timer IRQ to wake the IRQ thread when it is stopped, so it
+    // stops at once.
+    Irq_ReserveCancelIrq();
+
     // Set the indicator to allow the new thread.
     irqThread0.irqThreadRdy = NiFpga_True;
 
+    // Lock the memory of the process so the IRQ thread never waits for a page fault.
+    Thread_LockMemory();
+
     // Create new threads to catch the specified IRQ numbers.
     // Different IRQs should have different corresponding threads.
-    status = pthread_create(&thread, NULL, DI_Irq_Thread, &irqThread0);
+    // The IRQ thread runs with SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+    Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+    threadConfig.stats = &threadStats;
+    status = Thread_Create(&thread, &threadConfig, DI_Irq_Thread, &irqThread0);
     if (status != NiELVISIIIv10_Status_Success)
     {
         printf("CONFIGURE ERROR: %d\n", status);
@@ -122,6 +170,17 @@ int main(int argc, char **argv)
         {
             printf("main loop,%d\n", ++loopCount);
 
+            // Print the metrics of the adaptive coalescing, copied while the IRQ thread may update them.
+            Irq_ReadDiCoalesce(&(irqThread0.coalesce), &coalesce);
+            printf("DI IRQ count %u, %.0f edges/s, %.1f IRQs/s, latency %u us (max %u us), %u changes, %u timeouts\n",
+                   coalesce.count,
+                   coalesce.edgeRate,
+                   coalesce.irqRate,
+                   coalesce.latency,
+                   coalesce.maxLatency,
+                   coalesce.changes,
+                   coalesce.timeouts);
+
             printTime += LoopSteps;
         }
     }
@@ -129,9 +188,21 @@ int main(int argc, char **argv)
     // Set the indicator to end the new thread.
     irqThread0.irqThreadRdy = NiFpga_False;
 
+    // Wake the IRQ thread from its wait.
+    Irq_WakeWait(&(irqThread0.woken));
+
     // Wait the end of the IRQ thread.
     pthread_join(thread, NULL);
 
+    // Take the wake if the thread stopped before it waited again.
+    Irq_ClearWake(&(irqThread0.woken));
+
+    // Report the page faults the IRQ thread took after it started.
+    Thread_PrintStats("IRQ thread", &threadStats);
+
+    // Release the timer IRQ reserved to wake the IRQ thread.
+    Irq_ReleaseCancelIrq();
+
     // Distable DI0, so you can configure this I/O next time.
     // Every IrqConfigure() function should have its corresponding clear function,
     // and their parameters should also match.
@@ -163,15 +234,28 @@ void *DI_Irq_Thread(void* resource)
         static uint32_t irqCount = 0;
 
         // Stop the calling thread, wait until a selected IRQ is asserted.
-        Irq_Wait(threadResource->irqContext,
-                 threadResource->irqNumber,
-                 &irqAssert,
-                 (NiFpga_Bool*) &(threadResource->irqThreadRdy));
+        // The wait times out after about the latency bound while the count can be lowered.
+        Irq_WaitWakeable(threadResource->irqContext,
+                         1 << threadResource->irqNumber,
+                         Irq_GetDiCoalesceTimeout(&(threadResource->coalesce)),
+                         &irqAssert,
+                         &(threadResource->woken));
+
+        // If no IRQ came within the latency bound, the input slowed down, so
+        // lower the count to report the edges already counted sooner.
+        if (irqAssert == 0 && threadResource->irqThreadRdy)
+        {
+            Irq_TimeoutDiCoalesce(&bank_A, &(threadResource->coalesce));
+        }
 
         // If an IRQ was asserted.
         if (irqAssert & (1 << threadResource->irqNumber))
         {
-            printf("IRQ%d,%d\n", threadResource->irqNumber, ++irqCount);
+            printf("IRQ%d,%d,count %u\n", threadResource->irqNumber, ++irqCount, threadResource->coalesce.count);
+
+            // Measure the edge rate and adjust the count before the IRQ is acknowledged,
+            // so the next batch is counted with the new count.
+            Irq_UpdateDiCoalesce(&bank_A, &(threadResource->coalesce));
 
             // Acknowledge the IRQ(s) when the assertion is done.
             Irq_Acknowledge(irqAssert);
@@ -16,6 +16,7 @@
  */
 #include "NiELVISIIIv10.h"
 #include "DIO_N_Sample.h"
+#include "PinMux.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -37,33 +38,17 @@ ELVISIII_Dio bank_B = {DIBDMA_ENA, 99508, DIBDMA_CNTR, DOBDMA_CNTR, 99532, SYSSE
  *
  * @param[in]  bank        A struct containing the registers for one connecter.
  * @param[in]  channel     Enum containing 20 kinds of DIO channels.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the channel is owned by a committed plan.
  */
-void Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel)
+int32_t Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel)
 {
-    NiFpga_Status status;
-    uint64_t selectReg;
-
     // DIO outputs are on pins shared with other buses like PWM, Encoder, UART, SPI and I2C.
     // To output on a physical pin, select the DIO channel by setting the appropriate SELECT Register.
-    // Read the value of the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
-
-    // Clear bits of the SYSSELECTA/SYSSELECTB register.
-    // For DIO, the value for DIO select is 0, so we just need to clear the 2 bits and don't need to set.
-    selectReg = selectReg & ~((uint64_t)0b11 << (channel * 2));
-
-    // Write the new value to the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not Write to the System Select Register!");
-
-    return;
+    // For DIO, the value for DIO select is 0 (2 bits per channel).
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the channel is not already selected as DIO.
+    return PinMux_Select(bank->sel, channel, 1, PinMux_Dio);
 }
 
 /**
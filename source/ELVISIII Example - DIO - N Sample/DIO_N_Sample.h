@@ -86,7 +86,7 @@ typedef struct
 } ELVISIII_Dio;
 
 // Select DIO channel by setting the System Select Register.
-void Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel);
+int32_t Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel);
 
 // Set the DIO Direction Register.
 void Di_Direction(ELVISIII_Dio* bank, Dio_Channel channel);
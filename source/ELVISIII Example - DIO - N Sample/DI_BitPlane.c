@@ -0,0 +1,351 @@
+/**
+ * DI_BitPlane.c
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <string.h>
+#include "DI_BitPlane.h"
+
+/**
+ * Transpose a 32x32 bit matrix in place.
+ * On input, bit c of block[s] is channel c of sample s.
+ * On output, bit s of block[c] is sample s of channel c.
+ *
+ * The matrix is swapped in 16x16, 8x8, 4x4, 2x2 and 1x1 sub-blocks, so each
+ * stage moves 16 bits of every word with a few register operations.
+ * The transpose is its own inverse, so it also turns bit-planes back into
+ * FIFO values.
+ *
+ * @param[in,out]  block    32 words to transpose.
+ */
+void Di_TransposeBlock(uint32_t block[DI_PLANE_BLOCK])
+{
+    uint32_t mask = 0x0000FFFF;
+    uint32_t swap;
+    int j;
+    int k;
+
+    for (j = 16; j != 0; j >>= 1, mask ^= (mask << j))
+    {
+        for (k = 0; k < DI_PLANE_BLOCK; k = ((k | j) + 1) & ~j)
+        {
+            swap = ((block[k] >> j) ^ block[k | j]) & mask;
+            block[k] ^= (swap << j);
+            block[k | j] ^= swap;
+        }
+    }
+}
+
+/**
+ * Get the mask for the lowest bits of a word.
+ *
+ * @param[in]  count    The number of bits to keep (0 - 32).
+ *
+ * @return the mask.
+ */
+static uint32_t Di_LowMask(size_t count)
+{
+    return (count >= 32) ? 0xFFFFFFFF : (((uint32_t)1 << count) - 1);
+}
+
+/**
+ * Get up to 32 samples of one plane starting at any sample.
+ * Sample index is returned in bit 0.
+ *
+ * @param[in]  plane    The first word of the plane of one channel.
+ * @param[in]  index    The first sample to get.
+ * @param[in]  count    The number of samples to get (1 - 32).
+ *
+ * @return the samples. Bits above count are 0.
+ */
+static uint32_t Di_PlaneBits(const uint32_t* plane, size_t index, size_t count)
+{
+    size_t   word   = index / 32;
+    size_t   offset = index % 32;
+    uint32_t bits   = plane[word] >> offset;
+
+    if (offset != 0 && offset + count > 32)
+    {
+        bits |= plane[word + 1] << (32 - offset);
+    }
+
+    return bits & Di_LowMask(count);
+}
+
+/**
+ * Clamp a window of samples to the samples stored in the bit-planes.
+ *
+ * @param[in]  planes   The bit-planes.
+ * @param[in]  first    The first sample of the window.
+ * @param[in]  count    The number of samples in the window.
+ *
+ * @return the number of samples of the window that are stored.
+ */
+static size_t Di_ClampWindow(const Di_BitPlanes* planes, size_t first, size_t count)
+{
+    if (first >= planes->samples)
+    {
+        return 0;
+    }
+
+    if (count > planes->samples - first)
+    {
+        count = planes->samples - first;
+    }
+
+    return count;
+}
+
+/**
+ * Attach the storage to a set of bit-planes and clear it.
+ * The storage must hold DI_PLANE_CHANNELS * planeWords words. Use
+ * Di_BitPlaneWords to get planeWords for a number of samples.
+ *
+ * @param[in]  planes       The bit-planes to initialize.
+ * @param[in]  words        The storage for the planes.
+ * @param[in]  planeWords   The number of words for each plane.
+ */
+void Di_InitBitPlanes(Di_BitPlanes* planes, uint32_t* words, size_t planeWords)
+{
+    planes->words      = words;
+    planes->planeWords = planeWords;
+    planes->samples    = 0;
+
+    memset(words, 0, DI_PLANE_CHANNELS * planeWords * sizeof(uint32_t));
+
+    return;
+}
+
+/**
+ * Transpose a block of DI FIFO values into the bit-planes of all channels.
+ * Each FIFO value holds one sample of every channel (DIO0 = bit0, DIO1 = bit1, etc.).
+ * The samples are added after the samples that are already stored, so the
+ * FIFO can be read and appended block by block.
+ *
+ * Compared with ConvertU64ArrayToBoolArray, all 20 channels are extracted in
+ * one pass and each sample takes 1 bit instead of 1 byte.
+ *
+ * @param[in]  planes               The bit-planes.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ *
+ * @return the number of samples added. It is less than fifo_size if the planes are full.
+ */
+size_t Di_AppendBitPlanes(Di_BitPlanes* planes, const uint64_t* fxp_buffer_receive, size_t fifo_size)
+{
+    uint32_t block[DI_PLANE_BLOCK];
+    size_t   capacity = planes->planeWords * 32;
+    size_t   appended = 0;
+    size_t   count;
+    size_t   word;
+    size_t   offset;
+    size_t   i;
+    int      channel;
+
+    // Only keep the samples that fit in the planes.
+    if (fifo_size > capacity - planes->samples)
+    {
+        fifo_size = capacity - planes->samples;
+    }
+
+    while (appended < fifo_size)
+    {
+        count = fifo_size - appended;
+        if (count > DI_PLANE_BLOCK)
+        {
+            count = DI_PLANE_BLOCK;
+        }
+
+        // Load one sample per word. The tail of a short block is padded with 0.
+        for (i = 0; i < count; ++i)
+        {
+            block[i] = (uint32_t)fxp_buffer_receive[appended + i];
+        }
+        for (; i < DI_PLANE_BLOCK; ++i)
+        {
+            block[i] = 0;
+        }
+
+        Di_TransposeBlock(block);
+
+        // Merge the samples of each channel into its plane.
+        // The block starts at any bit of a word, so it can span two words.
+        word   = planes->samples / 32;
+        offset = planes->samples % 32;
+        for (channel = 0; channel < DI_PLANE_CHANNELS; ++channel)
+        {
+            uint32_t* plane = planes->words + channel * planes->planeWords;
+
+            plane[word] = (plane[word] & Di_LowMask(offset)) | (block[channel] << offset);
+            if (offset != 0 && offset + count > 32)
+            {
+                plane[word + 1] = block[channel] >> (32 - offset);
+            }
+        }
+
+        planes->samples += count;
+        appended += count;
+    }
+
+    return appended;
+}
+
+/**
+ * Get the value of one sample of one channel.
+ *
+ * @param[in]  planes    The bit-planes.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  index     The sample to get.
+ *
+ * @return the value of the sample, or NiFpga_False if the sample is not stored.
+ */
+NiFpga_Bool Di_GetBitPlaneSample(const Di_BitPlanes* planes, Dio_Channel channel, size_t index)
+{
+    const uint32_t* plane = planes->words + channel * planes->planeWords;
+
+    if (index >= planes->samples)
+    {
+        return NiFpga_False;
+    }
+
+    return (NiFpga_Bool)((plane[index / 32] >> (index % 32)) & 1);
+}
+
+/**
+ * Count the samples that are high in a window of one channel.
+ *
+ * @param[in]  planes    The bit-planes.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  first     The first sample of the window.
+ * @param[in]  count     The number of samples in the window.
+ *
+ * @return the number of high samples.
+ */
+size_t Di_CountHigh(const Di_BitPlanes* planes, Dio_Channel channel, size_t first, size_t count)
+{
+    const uint32_t* plane = planes->words + channel * planes->planeWords;
+    size_t          highs = 0;
+    size_t          chunk;
+    size_t          i;
+
+    count = Di_ClampWindow(planes, first, count);
+
+    for (i = 0; i < count; i += chunk)
+    {
+        chunk = (count - i > 32) ? 32 : count - i;
+        highs += __builtin_popcount(Di_PlaneBits(plane, first + i, chunk));
+    }
+
+    return highs;
+}
+
+/**
+ * Find the edges in a window of one channel.
+ * An edge is reported at the first sample that has the new value. The first
+ * sample of the window is compared with the sample before it, if any.
+ *
+ * @param[in]  planes     The bit-planes.
+ * @param[in]  channel    Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  type       The edges to search for.
+ * @param[in]  first      The first sample of the window.
+ * @param[in]  count      The number of samples in the window.
+ * @param[out] edges      The sample index of each edge found.
+ * @param[in]  maxEdges   The number of entries in edges.
+ *
+ * @return the number of edges written to edges.
+ */
+size_t Di_FindEdges(const Di_BitPlanes* planes,
+                    Dio_Channel         channel,
+                    Di_EdgeType         type,
+                    size_t              first,
+                    size_t              count,
+                    size_t*             edges,
+                    size_t              maxEdges)
+{
+    const uint32_t* plane = planes->words + channel * planes->planeWords;
+    size_t          found = 0;
+    size_t          chunk;
+    size_t          i;
+    uint32_t        bits;
+    uint32_t        previous;
+    uint32_t        changes;
+
+    count = Di_ClampWindow(planes, first, count);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // The first sample has no edge unless there is a sample before it.
+    if (first > 0)
+    {
+        previous = Di_PlaneBits(plane, first - 1, 1);
+    }
+    else
+    {
+        previous = Di_PlaneBits(plane, first, 1);
+    }
+
+    for (i = 0; i < count && found < maxEdges; i += chunk)
+    {
+        chunk = (count - i > 32) ? 32 : count - i;
+        bits  = Di_PlaneBits(plane, first + i, chunk);
+
+        // Compare every sample with the one before it.
+        changes = (bits ^ ((bits << 1) | previous)) & Di_LowMask(chunk);
+        previous = (bits >> (chunk - 1)) & 1;
+
+        if (!(type & Di_RisingEdge))
+        {
+            changes &= ~bits;
+        }
+        if (!(type & Di_FallingEdge))
+        {
+            changes &= bits;
+        }
+
+        while (changes != 0 && found < maxEdges)
+        {
+            edges[found++] = first + i + __builtin_ctz(changes);
+            changes &= changes - 1;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Copy a window of one channel into a packed buffer.
+ * The first sample of the window is stored in bit 0 of slice[0].
+ *
+ * @param[in]  planes    The bit-planes.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  first     The first sample of the window.
+ * @param[in]  count     The number of samples in the window.
+ * @param[out] slice     The packed samples. It must hold Di_BitPlaneWords(count) words.
+ *
+ * @return the number of samples copied.
+ */
+size_t Di_SliceBitPlane(const Di_BitPlanes* planes,
+                        Dio_Channel         channel,
+                        size_t              first,
+                        size_t              count,
+                        uint32_t*           slice)
+{
+    const uint32_t* plane = planes->words + channel * planes->planeWords;
+    size_t          chunk;
+    size_t          i;
+
+    count = Di_ClampWindow(planes, first, count);
+
+    for (i = 0; i < count; i += chunk)
+    {
+        chunk = (count - i > 32) ? 32 : count - i;
+        slice[i / 32] = Di_PlaneBits(plane, first + i, chunk);
+    }
+
+    return count;
+}
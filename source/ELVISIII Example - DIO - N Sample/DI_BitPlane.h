@@ -0,0 +1,81 @@
+/**
+ * DI_BitPlane.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef DI_BitPlane_h_
+#define DI_BitPlane_h_
+
+#include "DIO_N_Sample.h"
+
+// The number of DIO channels stored for each sample.
+#define DI_PLANE_CHANNELS 20
+
+// The number of samples transposed at a time.
+#define DI_PLANE_BLOCK 32
+
+// The number of 32-bit words each channel needs to store a number of samples.
+#define Di_BitPlaneWords(samples) (((samples) + 31) / 32)
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Flags that indicate which edges to search for.
+typedef enum
+{
+    Di_RisingEdge  = 0x1,     // Low to high
+    Di_FallingEdge = 0x2,     // High to low
+    Di_AnyEdge     = 0x3,     // Both edges
+} Di_EdgeType;
+
+/**
+ * Packed DI samples, one bit per sample and one plane per channel.
+ * Sample n of a channel is stored in bit (n % 32) of word (n / 32) of its plane.
+ */
+typedef struct
+{
+    uint32_t* words;          // Storage for DI_PLANE_CHANNELS planes of planeWords words each
+    size_t    planeWords;     // Number of words reserved for each plane
+    size_t    samples;        // Number of samples stored in each plane
+} Di_BitPlanes;
+
+// Transpose a 32x32 bit matrix between FIFO values and bit-planes.
+void Di_TransposeBlock(uint32_t block[DI_PLANE_BLOCK]);
+
+// Attach the storage to a set of bit-planes and clear it.
+void Di_InitBitPlanes(Di_BitPlanes* planes, uint32_t* words, size_t planeWords);
+
+// Transpose a block of DI FIFO values into the bit-planes of all channels.
+size_t Di_AppendBitPlanes(Di_BitPlanes* planes, const uint64_t* fxp_buffer_receive, size_t fifo_size);
+
+// Get the value of one sample of one channel.
+NiFpga_Bool Di_GetBitPlaneSample(const Di_BitPlanes* planes, Dio_Channel channel, size_t index);
+
+// Count the samples that are high in a window of one channel.
+size_t Di_CountHigh(const Di_BitPlanes* planes, Dio_Channel channel, size_t first, size_t count);
+
+// Find the edges in a window of one channel.
+size_t Di_FindEdges(const Di_BitPlanes* planes,
+                    Dio_Channel         channel,
+                    Di_EdgeType         type,
+                    size_t              first,
+                    size_t              count,
+                    size_t*             edges,
+                    size_t              maxEdges);
+
+// Copy a window of one channel into a packed buffer starting at bit 0.
+size_t Di_SliceBitPlane(const Di_BitPlanes* planes,
+                        Dio_Channel         channel,
+                        size_t              first,
+                        size_t              count,
+                        uint32_t*           slice);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // DI_BitPlane_h_
@@ -0,0 +1,309 @@
+/**
+ * DI_EdgeList.c
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <string.h>
+#include "DI_EdgeList.h"
+
+/**
+ * Find the first edge of a channel at or after a sample.
+ *
+ * @param[in]  edge    The edges of one channel.
+ * @param[in]  index   The sample to search from.
+ *
+ * @return the position of the edge in edge->edges, or edge->edgeCount if there is none.
+ */
+static size_t Di_LowerEdge(const Di_EdgeChannel* edge, uint32_t index)
+{
+    size_t low  = 0;
+    size_t high = edge->edgeCount;
+    size_t middle;
+
+    // Binary search, so looking up a window does not depend on the length of the capture.
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (edge->edges[middle] < index)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * Find the next FIFO value that differs from the current level of the channels.
+ * Each FIFO value is compared with the level of all 20 channels at once, so a
+ * block without edges costs one comparison per sample.
+ *
+ * @param[in]     fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]     fifo_size            The number of values in fxp_buffer_receive.
+ * @param[in]     index                The first value to check.
+ * @param[in,out] level                The level of the channels. It is updated to the value found.
+ * @param[out]    changes              The channels that changed (DIO0 = bit0, DIO1 = bit1, etc.).
+ *
+ * @return the index of the value that changed, or fifo_size if there is none.
+ */
+size_t Di_NextChange(const uint64_t* fxp_buffer_receive,
+                     size_t          fifo_size,
+                     size_t          index,
+                     uint32_t*       level,
+                     uint32_t*       changes)
+{
+    uint32_t current = *level;
+    uint32_t value;
+
+    for (; index < fifo_size; ++index)
+    {
+        value = (uint32_t)fxp_buffer_receive[index] & DI_EDGE_MASK;
+        if (value != current)
+        {
+            *changes = value ^ current;
+            *level   = value;
+            return index;
+        }
+    }
+
+    *changes = 0;
+    return fifo_size;
+}
+
+/**
+ * Attach the storage to an edge list and clear it.
+ * The storage must hold DI_EDGE_CHANNELS * maxEdges words.
+ *
+ * @param[in]  list       The edge list to initialize.
+ * @param[in]  storage    The storage for the edges of all channels.
+ * @param[in]  maxEdges   The number of edges each channel can hold.
+ */
+void Di_InitEdgeList(Di_EdgeList* list, uint32_t* storage, size_t maxEdges)
+{
+    int channel;
+
+    memset(list, 0, sizeof(Di_EdgeList));
+    list->maxEdges = maxEdges;
+
+    for (channel = 0; channel < DI_EDGE_CHANNELS; ++channel)
+    {
+        list->channel[channel].edges = storage + channel * maxEdges;
+    }
+
+    return;
+}
+
+/**
+ * Encode a block of DI FIFO values and add it to the edge list.
+ * Call it with every block read by Di_ReadFifo, in order. The first value of
+ * the first block sets the initial level of every channel.
+ *
+ * If a channel runs out of storage, the capture stops at the sample of that
+ * edge and list->full is set. The samples before it can still be decoded.
+ * The capture also stops, with list->full set, when it reaches UINT32_MAX
+ * samples, so the 32-bit sample indices never wrap around.
+ *
+ * @param[in]  list                 The edge list.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ *
+ * @return the number of values encoded.
+ */
+size_t Di_EncodeEdgeList(Di_EdgeList* list, const uint64_t* fxp_buffer_receive, size_t fifo_size)
+{
+    size_t   index = 0;
+    size_t   next;
+    uint32_t level;
+    uint32_t changes;
+    uint32_t overflow;
+    uint32_t room;
+    int      channel;
+
+    if (list->full || fifo_size == 0)
+    {
+        return 0;
+    }
+
+    // Only encode the values whose sample index still fits in 32 bits.
+    room = UINT32_MAX - list->samples;
+    if (fifo_size > room)
+    {
+        list->full = NiFpga_True;
+        fifo_size  = room;
+        if (fifo_size == 0)
+        {
+            return 0;
+        }
+    }
+
+    // The first sample of the capture sets the initial levels.
+    if (list->samples == 0)
+    {
+        list->level = (uint32_t)fxp_buffer_receive[0] & DI_EDGE_MASK;
+        for (channel = 0; channel < DI_EDGE_CHANNELS; ++channel)
+        {
+            list->channel[channel].initial = (NiFpga_Bool)((list->level >> channel) & 1);
+        }
+        index = 1;
+    }
+
+    level = list->level;
+    while ((next = Di_NextChange(fxp_buffer_receive, fifo_size, index, &level, &changes)) < fifo_size)
+    {
+        // Make sure that every channel that changed has room before recording any of them,
+        // so all channels stay consistent with list->samples.
+        overflow = 0;
+        for (channel = 0; channel < DI_EDGE_CHANNELS; ++channel)
+        {
+            if (list->channel[channel].edgeCount >= list->maxEdges)
+            {
+                overflow |= (uint32_t)1 << channel;
+            }
+        }
+        if (changes & overflow)
+        {
+            list->full = NiFpga_True;
+            list->samples += (uint32_t)next;
+            return next;
+        }
+
+        while (changes != 0)
+        {
+            Di_EdgeChannel* edge = &list->channel[__builtin_ctz(changes)];
+
+            edge->edges[edge->edgeCount++] = list->samples + (uint32_t)next;
+            changes &= changes - 1;
+        }
+
+        list->level = level;
+        index = next + 1;
+    }
+
+    list->samples += (uint32_t)fifo_size;
+
+    return fifo_size;
+}
+
+/**
+ * Get the level of one channel at one sample.
+ *
+ * @param[in]  list      The edge list.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  index     The sample.
+ *
+ * @return the level, or NiFpga_False if the sample is not recorded.
+ */
+NiFpga_Bool Di_GetEdgeListLevel(const Di_EdgeList* list, Dio_Channel channel, uint32_t index)
+{
+    const Di_EdgeChannel* edge = &list->channel[channel];
+    size_t                toggles;
+
+    if (index >= list->samples)
+    {
+        return NiFpga_False;
+    }
+
+    // Count the edges up to and including the sample.
+    toggles = Di_LowerEdge(edge, index + 1);
+
+    return (NiFpga_Bool)(edge->initial ^ (toggles & 1));
+}
+
+/**
+ * Get the edges of one channel in a window.
+ * The edges are not copied. The returned pointer points into the edge list.
+ *
+ * @param[in]  list      The edge list.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  first     The first sample of the window.
+ * @param[in]  count     The number of samples in the window.
+ * @param[out] edges     The first edge in the window.
+ *
+ * @return the number of edges in the window.
+ */
+size_t Di_GetEdgeListEdges(const Di_EdgeList* list,
+                           Dio_Channel        channel,
+                           uint32_t           first,
+                           uint32_t           count,
+                           const uint32_t**   edges)
+{
+    const Di_EdgeChannel* edge = &list->channel[channel];
+    size_t                begin;
+    size_t                end;
+    uint32_t              last;
+
+    last  = (count > UINT32_MAX - first) ? UINT32_MAX : first + count;
+    begin = Di_LowerEdge(edge, first);
+    end   = Di_LowerEdge(edge, last);
+
+    *edges = edge->edges + begin;
+
+    return end - begin;
+}
+
+/**
+ * Rebuild the samples of one channel in a window.
+ * The cost depends on the size of the window and the number of edges in it,
+ * not on the length of the capture.
+ *
+ * @param[in]  list      The edge list.
+ * @param[in]  channel   Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[in]  first     The first sample of the window.
+ * @param[in]  count     The number of samples in the window.
+ * @param[out] value     groups of boolean value. It must hold count values.
+ *
+ * @return the number of values written. It is less than count if the window
+ *         ends after the last recorded sample.
+ */
+uint32_t Di_DecodeEdgeList(const Di_EdgeList* list,
+                           Dio_Channel        channel,
+                           uint32_t           first,
+                           uint32_t           count,
+                           NiFpga_Bool        value[])
+{
+    const Di_EdgeChannel* edge = &list->channel[channel];
+    NiFpga_Bool           level;
+    size_t                next;
+    uint32_t              i;
+    uint32_t              runEnd;
+
+    if (first >= list->samples)
+    {
+        return 0;
+    }
+
+    if (count > list->samples - first)
+    {
+        count = list->samples - first;
+    }
+
+    level = Di_GetEdgeListLevel(list, channel, first);
+    next  = Di_LowerEdge(edge, first + 1);
+
+    // Fill one run of equal samples at a time.
+    for (i = 0; i < count; i = runEnd)
+    {
+        runEnd = count;
+        if (next < edge->edgeCount && edge->edges[next] - first < count)
+        {
+            runEnd = edge->edges[next] - first;
+        }
+
+        memset(&value[i], level, runEnd - i);
+
+        if (runEnd < count)
+        {
+            level = !level;
+            ++next;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,84 @@
+/**
+ * DI_EdgeList.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef DI_EdgeList_h_
+#define DI_EdgeList_h_
+
+#include "DIO_N_Sample.h"
+
+// The number of DIO channels recorded in an edge list.
+#define DI_EDGE_CHANNELS 20
+
+// The bits of a DI FIFO value that hold the DIO channels.
+#define DI_EDGE_MASK 0xFFFFF
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/**
+ * The edges of one channel.
+ * The channel starts at the initial level and toggles at every sample listed in edges.
+ */
+typedef struct
+{
+    uint32_t*   edges;        // Sample index of each edge, in increasing order
+    size_t      edgeCount;    // Number of edges recorded
+    NiFpga_Bool initial;      // Level of the first sample
+} Di_EdgeChannel;
+
+/**
+ * A DI capture stored as edge timestamps.
+ * Each edge takes 4 bytes, so a capture that changes rarely takes a small
+ * fraction of the memory of the FIFO values. Sample indices are 32-bit, so a
+ * capture can hold up to 4294967295 samples (about 536 s at MAX_SAMPLE_RATE).
+ */
+typedef struct
+{
+    Di_EdgeChannel channel[DI_EDGE_CHANNELS];
+    size_t         maxEdges;  // Number of edges each channel can hold
+    uint32_t       samples;   // Number of samples recorded
+    uint32_t       level;     // Level of all channels at the last sample
+    NiFpga_Bool    full;      // An edge could not be recorded, and the capture stopped
+} Di_EdgeList;
+
+// Find the next FIFO value that differs from the current level of the channels.
+size_t Di_NextChange(const uint64_t* fxp_buffer_receive,
+                     size_t          fifo_size,
+                     size_t          index,
+                     uint32_t*       level,
+                     uint32_t*       changes);
+
+// Attach the storage to an edge list and clear it.
+void Di_InitEdgeList(Di_EdgeList* list, uint32_t* storage, size_t maxEdges);
+
+// Encode a block of DI FIFO values and add it to the edge list.
+size_t Di_EncodeEdgeList(Di_EdgeList* list, const uint64_t* fxp_buffer_receive, size_t fifo_size);
+
+// Get the level of one channel at one sample.
+NiFpga_Bool Di_GetEdgeListLevel(const Di_EdgeList* list, Dio_Channel channel, uint32_t index);
+
+// Get the edges of one channel in a window.
+size_t Di_GetEdgeListEdges(const Di_EdgeList* list,
+                           Dio_Channel        channel,
+                           uint32_t           first,
+                           uint32_t           count,
+                           const uint32_t**   edges);
+
+// Rebuild the samples of one channel in a window.
+uint32_t Di_DecodeEdgeList(const Di_EdgeList* list,
+                           Dio_Channel        channel,
+                           uint32_t           first,
+                           uint32_t           count,
+                           NiFpga_Bool        value[]);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // DI_EdgeList_h_
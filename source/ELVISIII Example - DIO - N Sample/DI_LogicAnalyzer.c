@@ -0,0 +1,328 @@
+/**
+ * DI_LogicAnalyzer.c
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <string.h>
+#include "DI_LogicAnalyzer.h"
+
+/**
+ * Report an edge that passed the glitch filter and update the pulse measurements.
+ *
+ * @param[in]  analyzer    The logic analyzer.
+ * @param[in]  channel     The DIO channel of the edge.
+ * @param[in]  sample      The sample of the edge.
+ * @param[in]  sequence    The block in which the edge was read.
+ * @param[in]  rising      1 for a rising edge, 0 for a falling edge.
+ * @param[out] events      The event buffer.
+ * @param[in]  maxEvents   The number of entries in events.
+ * @param[in]  count       The number of events already in events.
+ *
+ * @return the number of events in events.
+ */
+static size_t Di_ReportLogicEdge(Di_LogicAnalyzer* analyzer,
+                                 int               channel,
+                                 uint64_t          sample,
+                                 uint32_t          sequence,
+                                 uint8_t           rising,
+                                 Di_LogicEvent*    events,
+                                 size_t            maxEvents,
+                                 size_t            count)
+{
+    Di_LogicChannel* state = &analyzer->channel[channel];
+
+    if (rising)
+    {
+        if (state->lastFalling != DI_LOGIC_NO_EDGE)
+        {
+            state->lowSamples = sample - state->lastFalling;
+        }
+        if (state->lastRising != DI_LOGIC_NO_EDGE)
+        {
+            state->periodSamples = sample - state->lastRising;
+        }
+        state->lastRising = sample;
+    }
+    else
+    {
+        if (state->lastRising != DI_LOGIC_NO_EDGE)
+        {
+            state->highSamples = sample - state->lastRising;
+        }
+        state->lastFalling = sample;
+    }
+
+    ++state->edges;
+
+    if (count >= maxEvents)
+    {
+        ++analyzer->dropped;
+        return count;
+    }
+
+    events[count].timestamp = Di_LogicSamplesToNs(analyzer, sample);
+    events[count].sample    = sample;
+    events[count].sequence  = sequence;
+    events[count].channel   = (uint8_t)channel;
+    events[count].rising    = rising;
+
+    return count + 1;
+}
+
+/**
+ * Pass an edge through the glitch filter.
+ * An edge is held until the channel has kept its new level for glitchSamples
+ * samples. If the channel changes back before that, both edges are removed.
+ *
+ * @param[in]  analyzer    The logic analyzer.
+ * @param[in]  channel     The DIO channel of the edge.
+ * @param[in]  sample      The sample of the edge.
+ * @param[in]  rising      1 for a rising edge, 0 for a falling edge.
+ * @param[out] events      The event buffer.
+ * @param[in]  maxEvents   The number of entries in events.
+ * @param[in]  count       The number of events already in events.
+ *
+ * @return the number of events in events.
+ */
+static size_t Di_FilterLogicEdge(Di_LogicAnalyzer* analyzer,
+                                 int               channel,
+                                 uint64_t          sample,
+                                 uint8_t           rising,
+                                 Di_LogicEvent*    events,
+                                 size_t            maxEvents,
+                                 size_t            count)
+{
+    Di_LogicChannel* state = &analyzer->channel[channel];
+
+    if (analyzer->glitchSamples == 0)
+    {
+        return Di_ReportLogicEdge(analyzer, channel, sample, analyzer->sequence, rising, events, maxEvents, count);
+    }
+
+    if (state->pendingSample != DI_LOGIC_NO_EDGE)
+    {
+        if (sample - state->pendingSample < analyzer->glitchSamples)
+        {
+            // The pulse is too short. Drop it and keep the level from before it.
+            state->pendingSample = DI_LOGIC_NO_EDGE;
+            ++state->glitches;
+            return count;
+        }
+
+        count = Di_ReportLogicEdge(analyzer,
+                                   channel,
+                                   state->pendingSample,
+                                   state->pendingSequence,
+                                   state->pendingRising,
+                                   events,
+                                   maxEvents,
+                                   count);
+    }
+
+    state->pendingSample   = sample;
+    state->pendingSequence = analyzer->sequence;
+    state->pendingRising   = rising;
+
+    return count;
+}
+
+/**
+ * Get the DI sample period in picoseconds.
+ * The period is computed from the same divisor as Di_Divisor, so timestamps
+ * built from it follow the DI sample clock exactly.
+ *
+ * @param[in]  ClockRate     The onboard clock rate of FPGA.
+ * @param[in]  SampleRate    The Sample Rate passed to Di_Divisor.
+ *
+ * @return the sample period in picoseconds.
+ */
+uint64_t Di_SamplePeriodPs(uint32_t ClockRate, uint32_t SampleRate)
+{
+    uint16_t divisor;
+
+    // Control the range of the sample rate from MIN_SAMPLE_RATE to MAX_SAMPLE_RATE.
+    if (SampleRate > MAX_SAMPLE_RATE)
+    {
+        SampleRate = MAX_SAMPLE_RATE;
+    }
+
+    if (SampleRate < MIN_SAMPLE_RATE)
+    {
+        SampleRate = MIN_SAMPLE_RATE;
+    }
+
+    divisor = (uint16_t)(ClockRate / SampleRate);
+
+    return (uint64_t)divisor * 1000000000000ULL / ClockRate;
+}
+
+/**
+ * Initialize a logic analyzer for the sample rate set with Di_Divisor.
+ *
+ * @param[in]  analyzer        The logic analyzer to initialize.
+ * @param[in]  ClockRate       The onboard clock rate of FPGA.
+ * @param[in]  SampleRate      The Sample Rate passed to Di_Divisor.
+ * @param[in]  glitchSamples   Pulses shorter than this number of samples are removed.
+ *                             Use 0 to report every edge.
+ */
+void Di_InitLogicAnalyzer(Di_LogicAnalyzer* analyzer,
+                          uint32_t          ClockRate,
+                          uint32_t          SampleRate,
+                          uint32_t          glitchSamples)
+{
+    int channel;
+
+    memset(analyzer, 0, sizeof(Di_LogicAnalyzer));
+    analyzer->periodPs      = Di_SamplePeriodPs(ClockRate, SampleRate);
+    analyzer->glitchSamples = glitchSamples;
+
+    for (channel = 0; channel < DI_EDGE_CHANNELS; ++channel)
+    {
+        analyzer->channel[channel].lastRising    = DI_LOGIC_NO_EDGE;
+        analyzer->channel[channel].lastFalling   = DI_LOGIC_NO_EDGE;
+        analyzer->channel[channel].pendingSample = DI_LOGIC_NO_EDGE;
+    }
+
+    return;
+}
+
+/**
+ * Process a block of DI FIFO values and report the edges found.
+ * Call it with every block read by Di_ReadFifo, in order. The FIFO values are
+ * scanned with Di_NextChange, so a block costs one comparison per sample plus
+ * the work for each edge.
+ *
+ * Events of one channel are reported in order. With a glitch filter, an edge
+ * is reported once the following glitchSamples samples have been processed,
+ * so it can be reported in a later call than the block it was read in.
+ *
+ * @param[in]  analyzer             The logic analyzer.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ * @param[out] events               The edges found.
+ * @param[in]  maxEvents            The number of entries in events. Edges that do not fit are
+ *                                  counted in analyzer->dropped but still measured.
+ *
+ * @return the number of events written to events.
+ */
+size_t Di_ProcessLogicBlock(Di_LogicAnalyzer* analyzer,
+                            const uint64_t*   fxp_buffer_receive,
+                            size_t            fifo_size,
+                            Di_LogicEvent*    events,
+                            size_t            maxEvents)
+{
+    size_t   count = 0;
+    size_t   index = 0;
+    size_t   next;
+    uint32_t level;
+    uint32_t changes;
+    int      channel;
+
+    if (fifo_size == 0)
+    {
+        return 0;
+    }
+
+    // The first sample sets the initial levels.
+    if (analyzer->samples == 0)
+    {
+        analyzer->level = (uint32_t)fxp_buffer_receive[0] & DI_EDGE_MASK;
+        index = 1;
+    }
+
+    level = analyzer->level;
+    while ((next = Di_NextChange(fxp_buffer_receive, fifo_size, index, &level, &changes)) < fifo_size)
+    {
+        while (changes != 0)
+        {
+            channel = __builtin_ctz(changes);
+            count = Di_FilterLogicEdge(analyzer,
+                                       channel,
+                                       analyzer->samples + next,
+                                       (uint8_t)((level >> channel) & 1),
+                                       events,
+                                       maxEvents,
+                                       count);
+            changes &= changes - 1;
+        }
+
+        index = next + 1;
+    }
+
+    analyzer->level    = level;
+    analyzer->samples += fifo_size;
+
+    // Report the pending edges that have now lasted long enough.
+    for (channel = 0; channel < DI_EDGE_CHANNELS && analyzer->glitchSamples != 0; ++channel)
+    {
+        Di_LogicChannel* state = &analyzer->channel[channel];
+
+        if (state->pendingSample != DI_LOGIC_NO_EDGE
+            && analyzer->samples - state->pendingSample >= analyzer->glitchSamples)
+        {
+            count = Di_ReportLogicEdge(analyzer,
+                                       channel,
+                                       state->pendingSample,
+                                       state->pendingSequence,
+                                       state->pendingRising,
+                                       events,
+                                       maxEvents,
+                                       count);
+            state->pendingSample = DI_LOGIC_NO_EDGE;
+        }
+    }
+
+    ++analyzer->sequence;
+
+    return count;
+}
+
+/**
+ * Convert a number of samples to nanoseconds.
+ *
+ * @param[in]  analyzer   The logic analyzer.
+ * @param[in]  samples    The number of samples.
+ *
+ * @return the time in nanoseconds.
+ */
+uint64_t Di_LogicSamplesToNs(const Di_LogicAnalyzer* analyzer, uint64_t samples)
+{
+    return samples * analyzer->periodPs / 1000;
+}
+
+/**
+ * Get the last pulse measurements of one channel in nanoseconds.
+ * A value is 0 until the edges needed to measure it have been reported.
+ *
+ * @param[in]  analyzer   The logic analyzer.
+ * @param[in]  channel    Enum containing 20 kinds of channels (DIO0 - DIO19).
+ * @param[out] highNs     If non-NULL, the width of the last high pulse.
+ * @param[out] lowNs      If non-NULL, the width of the last low pulse.
+ * @param[out] periodNs   If non-NULL, the time between the last two rising edges.
+ */
+void Di_GetPulseTiming(const Di_LogicAnalyzer* analyzer,
+                       Dio_Channel             channel,
+                       uint64_t*               highNs,
+                       uint64_t*               lowNs,
+                       uint64_t*               periodNs)
+{
+    const Di_LogicChannel* state = &analyzer->channel[channel];
+
+    if (highNs)
+    {
+        *highNs = Di_LogicSamplesToNs(analyzer, state->highSamples);
+    }
+    if (lowNs)
+    {
+        *lowNs = Di_LogicSamplesToNs(analyzer, state->lowSamples);
+    }
+    if (periodNs)
+    {
+        *periodNs = Di_LogicSamplesToNs(analyzer, state->periodSamples);
+    }
+
+    return;
+}
@@ -0,0 +1,97 @@
+/**
+ * DI_LogicAnalyzer.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef DI_LogicAnalyzer_h_
+#define DI_LogicAnalyzer_h_
+
+#include "DIO_N_Sample.h"
+#include "DI_EdgeList.h"
+
+// Sample index that marks an edge that has not happened yet.
+#define DI_LOGIC_NO_EDGE UINT64_MAX
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/**
+ * An edge of one channel.
+ */
+typedef struct
+{
+    uint64_t timestamp;   // Time of the edge in nanoseconds since the first sample
+    uint64_t sample;      // Sample index of the edge since the first sample
+    uint32_t sequence;    // Block in which the edge was read
+    uint8_t  channel;     // DIO channel (0 - 19)
+    uint8_t  rising;      // 1 for a rising edge, 0 for a falling edge
+} Di_LogicEvent;
+
+/**
+ * The state and the pulse measurements of one channel.
+ * Widths and periods are in samples and are 0 until they are measured.
+ */
+typedef struct
+{
+    uint64_t lastRising;      // Sample of the last rising edge, or DI_LOGIC_NO_EDGE
+    uint64_t lastFalling;     // Sample of the last falling edge, or DI_LOGIC_NO_EDGE
+    uint64_t highSamples;     // Width of the last high pulse
+    uint64_t lowSamples;      // Width of the last low pulse
+    uint64_t periodSamples;   // Time between the last two rising edges
+    uint64_t edges;           // Number of edges reported
+    uint64_t glitches;        // Number of pulses removed by the glitch filter
+
+    uint64_t pendingSample;   // Edge waiting for the glitch filter, or DI_LOGIC_NO_EDGE
+    uint32_t pendingSequence; // Block of the pending edge
+    uint8_t  pendingRising;   // Direction of the pending edge
+} Di_LogicChannel;
+
+/**
+ * A logic analyzer that turns DI FIFO blocks into edge events.
+ */
+typedef struct
+{
+    Di_LogicChannel channel[DI_EDGE_CHANNELS];
+    uint64_t        periodPs;       // Sample period in picoseconds
+    uint64_t        samples;        // Number of samples processed
+    uint32_t        sequence;       // Number of blocks processed
+    uint32_t        level;          // Level of all channels at the last sample
+    uint32_t        glitchSamples;  // Pulses shorter than this are removed, 0 to report every edge
+    uint32_t        dropped;        // Number of events that did not fit in the event buffer
+} Di_LogicAnalyzer;
+
+// Get the DI sample period in picoseconds.
+uint64_t Di_SamplePeriodPs(uint32_t ClockRate, uint32_t SampleRate);
+
+// Initialize a logic analyzer for the sample rate set with Di_Divisor.
+void Di_InitLogicAnalyzer(Di_LogicAnalyzer* analyzer,
+                          uint32_t          ClockRate,
+                          uint32_t          SampleRate,
+                          uint32_t          glitchSamples);
+
+// Process a block of DI FIFO values and report the edges found.
+size_t Di_ProcessLogicBlock(Di_LogicAnalyzer* analyzer,
+                            const uint64_t*   fxp_buffer_receive,
+                            size_t            fifo_size,
+                            Di_LogicEvent*    events,
+                            size_t            maxEvents);
+
+// Convert a number of samples to nanoseconds.
+uint64_t Di_LogicSamplesToNs(const Di_LogicAnalyzer* analyzer, uint64_t samples);
+
+// Get the last pulse measurements of one channel in nanoseconds.
+void Di_GetPulseTiming(const Di_LogicAnalyzer* analyzer,
+                       Dio_Channel             channel,
+                       uint64_t*               highNs,
+                       uint64_t*               lowNs,
+                       uint64_t*               periodNs);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // DI_LogicAnalyzer_h_
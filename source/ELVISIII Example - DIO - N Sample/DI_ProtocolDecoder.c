@@ -0,0 +1,561 @@
+/**
+ * DI_ProtocolDecoder.c
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <string.h>
+#include "DI_ProtocolDecoder.h"
+
+/*
+ * Called for every sample at which one of the channels of a decoder changes.
+ * before and after are the levels of all channels before and at the sample.
+ */
+typedef size_t (*Di_ChangeHandler)(void*             decoder,
+                                   uint64_t          sample,
+                                   uint32_t          before,
+                                   uint32_t          after,
+                                   Di_ProtocolFrame* frames,
+                                   size_t            maxFrames,
+                                   size_t            count);
+
+/**
+ * Initialize the state shared by all decoders.
+ *
+ * @param[in]  state        The decoder state.
+ * @param[in]  ClockRate    The onboard clock rate of FPGA.
+ * @param[in]  SampleRate   The Sample Rate passed to Di_Divisor.
+ */
+static void Di_InitDecoderState(Di_DecoderState* state, uint32_t ClockRate, uint32_t SampleRate)
+{
+    memset(state, 0, sizeof(Di_DecoderState));
+    state->periodPs = Di_SamplePeriodPs(ClockRate, SampleRate);
+}
+
+/**
+ * Add a frame to the frame buffer.
+ *
+ * @return the number of frames in frames.
+ */
+static size_t Di_AddFrame(Di_DecoderState*  state,
+                          Di_ProtocolFrame* frames,
+                          size_t            maxFrames,
+                          size_t            count,
+                          Di_FrameType      type,
+                          uint64_t          sample,
+                          uint16_t          data,
+                          uint16_t          data2,
+                          uint8_t           flags)
+{
+    if (count >= maxFrames)
+    {
+        ++state->dropped;
+        return count;
+    }
+
+    frames[count].timestamp = sample * state->periodPs / 1000;
+    frames[count].sample    = sample;
+    frames[count].data      = data;
+    frames[count].data2     = data2;
+    frames[count].type      = (uint8_t)type;
+    frames[count].flags     = flags;
+
+    return count + 1;
+}
+
+/**
+ * Scan a block of DI FIFO values and call the handler of a decoder for every
+ * sample at which one of its channels changes. Runs of samples without a change
+ * cost one comparison per sample, so the decoders keep up with MAX_SAMPLE_RATE.
+ *
+ * @return the number of frames in frames.
+ */
+static size_t Di_RunDecoder(Di_DecoderState*  state,
+                            void*             decoder,
+                            uint32_t          mask,
+                            Di_ChangeHandler  handler,
+                            const uint64_t*   fxp_buffer_receive,
+                            size_t            fifo_size,
+                            Di_ProtocolFrame* frames,
+                            size_t            maxFrames)
+{
+    size_t   count = 0;
+    size_t   index = 0;
+    size_t   next;
+    uint32_t level;
+    uint32_t changes;
+
+    if (fifo_size == 0)
+    {
+        return 0;
+    }
+
+    // The first sample sets the initial levels.
+    if (state->samples == 0)
+    {
+        state->level = (uint32_t)fxp_buffer_receive[0] & DI_EDGE_MASK;
+        index = 1;
+    }
+
+    level = state->level;
+    while ((next = Di_NextChange(fxp_buffer_receive, fifo_size, index, &level, &changes)) < fifo_size)
+    {
+        if (changes & mask)
+        {
+            count = handler(decoder, state->samples + next, level ^ changes, level, frames, maxFrames, count);
+        }
+
+        index = next + 1;
+    }
+
+    state->level    = level;
+    state->samples += fifo_size;
+
+    return count;
+}
+
+/**
+ * Sample the bits of the current UART frame whose centers are before a sample.
+ * The RX level is constant from the last change up to that sample.
+ *
+ * @return the number of frames in frames.
+ */
+static size_t Di_UartAdvance(Di_UartDecoder*   decoder,
+                             uint64_t          until,
+                             uint8_t           level,
+                             Di_ProtocolFrame* frames,
+                             size_t            maxFrames,
+                             size_t            count)
+{
+    uint8_t dataEnd = decoder->dataBits;
+    uint8_t parityEnd = dataEnd + (decoder->parity != Di_ParityNone);
+    uint8_t flags;
+    uint8_t ones;
+
+    while (decoder->busy && (decoder->nextCenter >> 8) < until)
+    {
+        if (decoder->bit == 0)
+        {
+            // The start bit must still be low at its center, otherwise it was a glitch.
+            if (level)
+            {
+                decoder->busy = NiFpga_False;
+                break;
+            }
+        }
+        else if (decoder->bit <= dataEnd)
+        {
+            decoder->data |= (uint16_t)level << (decoder->bit - 1);
+        }
+        else if (decoder->bit <= parityEnd)
+        {
+            decoder->parityBit = level;
+        }
+        else
+        {
+            // Stop bit. The frame is complete.
+            flags = level ? 0 : Di_FramingError;
+
+            if (decoder->parity != Di_ParityNone)
+            {
+                ones = (uint8_t)((__builtin_popcount(decoder->data) + decoder->parityBit) & 1);
+                if ((decoder->parity == Di_ParityOdd) != (ones == 1))
+                {
+                    flags |= Di_ParityError;
+                }
+            }
+
+            count = Di_AddFrame(&decoder->state, frames, maxFrames, count,
+                                Di_UartFrame, decoder->frameStart, decoder->data, 0, flags);
+            decoder->busy = NiFpga_False;
+            break;
+        }
+
+        ++decoder->bit;
+        decoder->nextCenter += decoder->bitTime;
+    }
+
+    return count;
+}
+
+/**
+ * Handle a change of the UART RX channel.
+ */
+static size_t Di_UartChange(void*             decoder,
+                            uint64_t          sample,
+                            uint32_t          before,
+                            uint32_t          after,
+                            Di_ProtocolFrame* frames,
+                            size_t            maxFrames,
+                            size_t            count)
+{
+    Di_UartDecoder* uart     = (Di_UartDecoder*)decoder;
+    uint8_t         previous = (uint8_t)((before >> uart->channel) & 1);
+    uint8_t         level    = (uint8_t)((after >> uart->channel) & 1);
+
+    // The bits up to this sample had the previous level.
+    count = Di_UartAdvance(uart, sample, previous, frames, maxFrames, count);
+
+    // A falling edge while idle is a start bit.
+    if (!uart->busy && previous && !level)
+    {
+        uart->busy       = NiFpga_True;
+        uart->bit        = 0;
+        uart->data       = 0;
+        uart->parityBit  = 0;
+        uart->frameStart = sample;
+        uart->nextCenter = (sample << 8) + uart->bitTime / 2;
+    }
+
+    return count;
+}
+
+/**
+ * Initialize an asynchronous serial decoder.
+ * The sample rate should be at least 4 times the baud rate. The bits are
+ * sampled at their centers, measured from the falling edge of the start bit.
+ *
+ * @param[in]  decoder      The decoder to initialize.
+ * @param[in]  ClockRate    The onboard clock rate of FPGA.
+ * @param[in]  SampleRate   The Sample Rate passed to Di_Divisor.
+ * @param[in]  channel      The DIO channel of the RX signal.
+ * @param[in]  baudRate     The baud rate.
+ * @param[in]  dataBits     The number of data bits (5 - 9).
+ * @param[in]  parity       The parity.
+ */
+void Di_InitUartDecoder(Di_UartDecoder* decoder,
+                        uint32_t        ClockRate,
+                        uint32_t        SampleRate,
+                        Dio_Channel     channel,
+                        uint32_t        baudRate,
+                        uint8_t         dataBits,
+                        Di_Parity       parity)
+{
+    memset(decoder, 0, sizeof(Di_UartDecoder));
+    Di_InitDecoderState(&decoder->state, ClockRate, SampleRate);
+
+    decoder->channel  = (uint8_t)channel;
+    decoder->dataBits = dataBits;
+    decoder->parity   = (uint8_t)parity;
+
+    // Samples per bit from the actual sample period, in 1/256 samples.
+    decoder->bitTime = (uint32_t)(1000000000000ULL * 256 / baudRate / decoder->state.periodPs);
+
+    return;
+}
+
+/**
+ * Decode a block of DI FIFO values as asynchronous serial frames.
+ * Call it with every block read by Di_ReadFifo, in order. A frame that spans
+ * two blocks is reported with the block in which its stop bit is sampled.
+ *
+ * @param[in]  decoder              The decoder.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ * @param[out] frames               The frames decoded.
+ * @param[in]  maxFrames            The number of entries in frames.
+ *
+ * @return the number of frames written to frames.
+ */
+size_t Di_DecodeUart(Di_UartDecoder*   decoder,
+                     const uint64_t*   fxp_buffer_receive,
+                     size_t            fifo_size,
+                     Di_ProtocolFrame* frames,
+                     size_t            maxFrames)
+{
+    size_t count;
+
+    count = Di_RunDecoder(&decoder->state,
+                          decoder,
+                          (uint32_t)1 << decoder->channel,
+                          Di_UartChange,
+                          fxp_buffer_receive,
+                          fifo_size,
+                          frames,
+                          maxFrames);
+
+    // The level is known up to the end of the block.
+    return Di_UartAdvance(decoder,
+                          decoder->state.samples,
+                          (uint8_t)((decoder->state.level >> decoder->channel) & 1),
+                          frames,
+                          maxFrames,
+                          count);
+}
+
+/**
+ * Handle a change of the SPI channels.
+ */
+static size_t Di_SpiChange(void*             decoder,
+                           uint64_t          sample,
+                           uint32_t          before,
+                           uint32_t          after,
+                           Di_ProtocolFrame* frames,
+                           size_t            maxFrames,
+                           size_t            count)
+{
+    Di_SpiDecoder* spi     = (Di_SpiDecoder*)decoder;
+    uint32_t       changes = before ^ after;
+    uint8_t        clock;
+    uint8_t        mosi;
+    uint8_t        miso;
+
+    // CS edges start and end the transfers.
+    if (spi->cs != DI_DECODER_NO_CHANNEL && (changes & ((uint32_t)1 << spi->cs)))
+    {
+        if ((after >> spi->cs) & 1)
+        {
+            if (spi->bits != 0)
+            {
+                count = Di_AddFrame(&spi->state, frames, maxFrames, count,
+                                    Di_SpiFrame, spi->frameStart, spi->mosiWord, spi->misoWord, Di_Incomplete);
+            }
+            spi->selected = NiFpga_False;
+        }
+        else
+        {
+            spi->selected = NiFpga_True;
+        }
+
+        spi->bits     = 0;
+        spi->mosiWord = 0;
+        spi->misoWord = 0;
+    }
+
+    if (!spi->selected || !(changes & ((uint32_t)1 << spi->sclk)))
+    {
+        return count;
+    }
+
+    // CPHA 0 samples on the edge that leaves the idle level, CPHA 1 on the edge that returns to it.
+    clock = (uint8_t)((after >> spi->sclk) & 1);
+    if ((spi->cpha == 0) != (clock != spi->cpol))
+    {
+        return count;
+    }
+
+    mosi = (uint8_t)((after >> spi->mosi) & 1);
+    miso = (uint8_t)((after >> spi->miso) & 1);
+
+    if (spi->bits == 0)
+    {
+        spi->frameStart = sample;
+    }
+
+    if (spi->lsbFirst)
+    {
+        spi->mosiWord |= (uint16_t)mosi << spi->bits;
+        spi->misoWord |= (uint16_t)miso << spi->bits;
+    }
+    else
+    {
+        spi->mosiWord = (uint16_t)((spi->mosiWord << 1) | mosi);
+        spi->misoWord = (uint16_t)((spi->misoWord << 1) | miso);
+    }
+
+    if (++spi->bits == spi->wordBits)
+    {
+        count = Di_AddFrame(&spi->state, frames, maxFrames, count,
+                            Di_SpiFrame, spi->frameStart, spi->mosiWord, spi->misoWord, 0);
+        spi->bits     = 0;
+        spi->mosiWord = 0;
+        spi->misoWord = 0;
+    }
+
+    return count;
+}
+
+/**
+ * Initialize an SPI decoder.
+ *
+ * @param[in]  decoder      The decoder to initialize.
+ * @param[in]  ClockRate    The onboard clock rate of FPGA.
+ * @param[in]  SampleRate   The Sample Rate passed to Di_Divisor.
+ * @param[in]  sclk         The DIO channel of SCLK.
+ * @param[in]  mosi         The DIO channel of MOSI.
+ * @param[in]  miso         The DIO channel of MISO.
+ * @param[in]  cs           The DIO channel of the active-low chip select, or DI_DECODER_NO_CHANNEL
+ *                          to split the words by bit count only.
+ * @param[in]  cpol         The clock level when idle.
+ * @param[in]  cpha         0 to sample on the leading clock edge, 1 on the trailing clock edge.
+ * @param[in]  wordBits     The number of bits of a word (1 - 16).
+ * @param[in]  lsbFirst     NiFpga_True if the least significant bit is sent first.
+ */
+void Di_InitSpiDecoder(Di_SpiDecoder* decoder,
+                       uint32_t       ClockRate,
+                       uint32_t       SampleRate,
+                       Dio_Channel    sclk,
+                       Dio_Channel    mosi,
+                       Dio_Channel    miso,
+                       int            cs,
+                       uint8_t        cpol,
+                       uint8_t        cpha,
+                       uint8_t        wordBits,
+                       NiFpga_Bool    lsbFirst)
+{
+    memset(decoder, 0, sizeof(Di_SpiDecoder));
+    Di_InitDecoderState(&decoder->state, ClockRate, SampleRate);
+
+    decoder->sclk     = (uint8_t)sclk;
+    decoder->mosi     = (uint8_t)mosi;
+    decoder->miso     = (uint8_t)miso;
+    decoder->cs       = (int8_t)cs;
+    decoder->cpol     = cpol;
+    decoder->cpha     = cpha;
+    decoder->wordBits = wordBits;
+    decoder->lsbFirst = lsbFirst;
+    decoder->selected = (NiFpga_Bool)(cs == DI_DECODER_NO_CHANNEL);
+
+    return;
+}
+
+/**
+ * Decode a block of DI FIFO values as SPI words.
+ * Call it with every block read by Di_ReadFifo, in order. If the capture starts
+ * while CS is already asserted, decoding starts at the next CS falling edge.
+ *
+ * @param[in]  decoder              The decoder.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ * @param[out] frames               The words decoded.
+ * @param[in]  maxFrames            The number of entries in frames.
+ *
+ * @return the number of frames written to frames.
+ */
+size_t Di_DecodeSpi(Di_SpiDecoder*    decoder,
+                    const uint64_t*   fxp_buffer_receive,
+                    size_t            fifo_size,
+                    Di_ProtocolFrame* frames,
+                    size_t            maxFrames)
+{
+    uint32_t mask = ((uint32_t)1 << decoder->sclk) | ((uint32_t)1 << decoder->mosi) | ((uint32_t)1 << decoder->miso);
+
+    if (decoder->cs != DI_DECODER_NO_CHANNEL)
+    {
+        mask |= (uint32_t)1 << decoder->cs;
+    }
+
+    return Di_RunDecoder(&decoder->state,
+                         decoder,
+                         mask,
+                         Di_SpiChange,
+                         fxp_buffer_receive,
+                         fifo_size,
+                         frames,
+                         maxFrames);
+}
+
+/**
+ * Handle a change of the I2C channels.
+ */
+static size_t Di_I2cChange(void*             decoder,
+                           uint64_t          sample,
+                           uint32_t          before,
+                           uint32_t          after,
+                           Di_ProtocolFrame* frames,
+                           size_t            maxFrames,
+                           size_t            count)
+{
+    Di_I2cDecoder* i2c      = (Di_I2cDecoder*)decoder;
+    uint8_t        sclBefore = (uint8_t)((before >> i2c->scl) & 1);
+    uint8_t        sclAfter  = (uint8_t)((after >> i2c->scl) & 1);
+    uint8_t        sdaBefore = (uint8_t)((before >> i2c->sda) & 1);
+    uint8_t        sdaAfter  = (uint8_t)((after >> i2c->sda) & 1);
+
+    // SDA changing while SCL stays high is a start or stop condition.
+    if (sclBefore && sclAfter && sdaBefore != sdaAfter)
+    {
+        i2c->bits = 0;
+        i2c->byte = 0;
+
+        if (!sdaAfter)
+        {
+            i2c->active  = NiFpga_True;
+            i2c->address = NiFpga_True;
+            return Di_AddFrame(&i2c->state, frames, maxFrames, count, Di_I2cStart, sample, 0, 0, 0);
+        }
+
+        i2c->active = NiFpga_False;
+        return Di_AddFrame(&i2c->state, frames, maxFrames, count, Di_I2cStop, sample, 0, 0, 0);
+    }
+
+    // The data bits and the acknowledge bit are sampled on the rising edge of SCL.
+    if (!i2c->active || sclBefore || !sclAfter)
+    {
+        return count;
+    }
+
+    if (i2c->bits < 8)
+    {
+        if (i2c->bits == 0)
+        {
+            i2c->frameStart = sample;
+        }
+        i2c->byte = (uint16_t)((i2c->byte << 1) | sdaAfter);
+        ++i2c->bits;
+        return count;
+    }
+
+    count = Di_AddFrame(&i2c->state, frames, maxFrames, count, Di_I2cByte, i2c->frameStart, i2c->byte, 0,
+                        (uint8_t)((sdaAfter ? Di_I2cNack : 0) | (i2c->address ? Di_I2cAddress : 0)));
+    i2c->bits    = 0;
+    i2c->byte    = 0;
+    i2c->address = NiFpga_False;
+
+    return count;
+}
+
+/**
+ * Initialize an I2C decoder.
+ *
+ * @param[in]  decoder      The decoder to initialize.
+ * @param[in]  ClockRate    The onboard clock rate of FPGA.
+ * @param[in]  SampleRate   The Sample Rate passed to Di_Divisor.
+ * @param[in]  scl          The DIO channel of SCL.
+ * @param[in]  sda          The DIO channel of SDA.
+ */
+void Di_InitI2cDecoder(Di_I2cDecoder* decoder,
+                       uint32_t       ClockRate,
+                       uint32_t       SampleRate,
+                       Dio_Channel    scl,
+                       Dio_Channel    sda)
+{
+    memset(decoder, 0, sizeof(Di_I2cDecoder));
+    Di_InitDecoderState(&decoder->state, ClockRate, SampleRate);
+
+    decoder->scl = (uint8_t)scl;
+    decoder->sda = (uint8_t)sda;
+
+    return;
+}
+
+/**
+ * Decode a block of DI FIFO values as I2C conditions and bytes.
+ * Call it with every block read by Di_ReadFifo, in order. Bytes are only
+ * decoded after a start condition has been seen.
+ *
+ * @param[in]  decoder              The decoder.
+ * @param[in]  fxp_buffer_receive   groups of values read from a DI FIFO.
+ * @param[in]  fifo_size            The number of values in fxp_buffer_receive.
+ * @param[out] frames               The conditions and bytes decoded.
+ * @param[in]  maxFrames            The number of entries in frames.
+ *
+ * @return the number of frames written to frames.
+ */
+size_t Di_DecodeI2c(Di_I2cDecoder*    decoder,
+                    const uint64_t*   fxp_buffer_receive,
+                    size_t            fifo_size,
+                    Di_ProtocolFrame* frames,
+                    size_t            maxFrames)
+{
+    return Di_RunDecoder(&decoder->state,
+                         decoder,
+                         ((uint32_t)1 << decoder->scl) | ((uint32_t)1 << decoder->sda),
+                         Di_I2cChange,
+                         fxp_buffer_receive,
+                         fifo_size,
+                         frames,
+                         maxFrames);
+}
@@ -0,0 +1,183 @@
+/**
+ * DI_ProtocolDecoder.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef DI_ProtocolDecoder_h_
+#define DI_ProtocolDecoder_h_
+
+#include "DIO_N_Sample.h"
+#include "DI_EdgeList.h"
+#include "DI_LogicAnalyzer.h"
+
+// Channel number that disables an optional signal, such as the SPI chip select.
+#define DI_DECODER_NO_CHANNEL -1
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Kinds of decoded frames.
+typedef enum
+{
+    Di_UartFrame = 0,   // One UART character
+    Di_SpiFrame  = 1,   // One SPI word
+    Di_I2cStart  = 2,   // I2C start or repeated start condition
+    Di_I2cStop   = 3,   // I2C stop condition
+    Di_I2cByte   = 4,   // One I2C byte and its acknowledge bit
+} Di_FrameType;
+
+// Flags of decoded frames.
+typedef enum
+{
+    Di_FramingError = 0x01,   // UART stop bit is low
+    Di_ParityError  = 0x02,   // UART parity bit does not match
+    Di_I2cNack      = 0x04,   // I2C byte was not acknowledged
+    Di_I2cAddress   = 0x08,   // I2C byte is the address byte after a start condition
+    Di_Incomplete   = 0x10,   // SPI chip select was deasserted in the middle of a word
+} Di_FrameFlags;
+
+// UART parity.
+typedef enum
+{
+    Di_ParityNone = 0,
+    Di_ParityOdd  = 1,
+    Di_ParityEven = 2,
+} Di_Parity;
+
+/**
+ * A decoded frame.
+ */
+typedef struct
+{
+    uint64_t timestamp;   // Time of the first sample of the frame in nanoseconds
+    uint64_t sample;      // Sample index of the first sample of the frame
+    uint16_t data;        // UART character, SPI MOSI word or I2C byte
+    uint16_t data2;       // SPI MISO word
+    uint8_t  type;        // Di_FrameType
+    uint8_t  flags;       // Di_FrameFlags
+} Di_ProtocolFrame;
+
+/**
+ * The state shared by all decoders.
+ */
+typedef struct
+{
+    uint64_t periodPs;    // Sample period in picoseconds
+    uint64_t samples;     // Number of samples processed
+    uint32_t level;       // Level of all channels at the last sample
+    uint32_t dropped;     // Number of frames that did not fit in the frame buffer
+} Di_DecoderState;
+
+/**
+ * Asynchronous serial decoder (idle high, start bit, LSB first, one stop bit).
+ */
+typedef struct
+{
+    Di_DecoderState state;
+    uint8_t         channel;        // DIO channel of the RX signal
+    uint8_t         dataBits;       // Number of data bits (5 - 9)
+    uint8_t         parity;         // Di_Parity
+    uint8_t         bit;            // Bit of the current frame, 0 is the start bit
+    NiFpga_Bool     busy;           // A frame is being received
+    uint32_t        bitTime;        // Samples per bit in 1/256 samples
+    uint64_t        nextCenter;     // Center of the next bit in 1/256 samples
+    uint64_t        frameStart;     // Sample of the start bit
+    uint16_t        data;           // Data bits received
+    uint8_t         parityBit;      // Parity bit received
+} Di_UartDecoder;
+
+/**
+ * SPI decoder. The bits are sampled on the edge selected by CPOL and CPHA.
+ */
+typedef struct
+{
+    Di_DecoderState state;
+    uint8_t         sclk;           // DIO channel of SCLK
+    uint8_t         mosi;           // DIO channel of MOSI
+    uint8_t         miso;           // DIO channel of MISO
+    int8_t          cs;             // DIO channel of the active-low CS, or DI_DECODER_NO_CHANNEL
+    uint8_t         cpol;           // Clock level when idle
+    uint8_t         cpha;           // 0 to sample on the leading edge, 1 on the trailing edge
+    uint8_t         wordBits;       // Number of bits of a word (1 - 16)
+    NiFpga_Bool     lsbFirst;       // The least significant bit is sent first
+    uint8_t         bits;           // Bits of the current word received
+    NiFpga_Bool     selected;       // CS is asserted, or there is no CS
+    uint64_t        frameStart;     // Sample of the first bit of the word
+    uint16_t        mosiWord;
+    uint16_t        misoWord;
+} Di_SpiDecoder;
+
+/**
+ * I2C decoder.
+ */
+typedef struct
+{
+    Di_DecoderState state;
+    uint8_t         scl;            // DIO channel of SCL
+    uint8_t         sda;            // DIO channel of SDA
+    uint8_t         bits;           // Bits of the current byte received
+    NiFpga_Bool     active;         // Between a start and a stop condition
+    NiFpga_Bool     address;        // The next byte is the address byte
+    uint64_t        frameStart;     // Sample of the first bit of the byte
+    uint16_t        byte;
+} Di_I2cDecoder;
+
+// Initialize an asynchronous serial decoder.
+void Di_InitUartDecoder(Di_UartDecoder* decoder,
+                        uint32_t        ClockRate,
+                        uint32_t        SampleRate,
+                        Dio_Channel     channel,
+                        uint32_t        baudRate,
+                        uint8_t         dataBits,
+                        Di_Parity       parity);
+
+// Decode a block of DI FIFO values as asynchronous serial frames.
+size_t Di_DecodeUart(Di_UartDecoder*   decoder,
+                     const uint64_t*   fxp_buffer_receive,
+                     size_t            fifo_size,
+                     Di_ProtocolFrame* frames,
+                     size_t            maxFrames);
+
+// Initialize an SPI decoder.
+void Di_InitSpiDecoder(Di_SpiDecoder* decoder,
+                       uint32_t       ClockRate,
+                       uint32_t       SampleRate,
+                       Dio_Channel    sclk,
+                       Dio_Channel    mosi,
+                       Dio_Channel    miso,
+                       int            cs,
+                       uint8_t        cpol,
+                       uint8_t        cpha,
+                       uint8_t        wordBits,
+                       NiFpga_Bool    lsbFirst);
+
+// Decode a block of DI FIFO values as SPI words.
+size_t Di_DecodeSpi(Di_SpiDecoder*    decoder,
+                    const uint64_t*   fxp_buffer_receive,
+                    size_t            fifo_size,
+                    Di_ProtocolFrame* frames,
+                    size_t            maxFrames);
+
+// Initialize an I2C decoder.
+void Di_InitI2cDecoder(Di_I2cDecoder* decoder,
+                       uint32_t       ClockRate,
+                       uint32_t       SampleRate,
+                       Dio_Channel    scl,
+                       Dio_Channel    sda);
+
+// Decode a block of DI FIFO values as I2C conditions and bytes.
+size_t Di_DecodeI2c(Di_I2cDecoder*    decoder,
+                    const uint64_t*   fxp_buffer_receive,
+                    size_t            fifo_size,
+                    Di_ProtocolFrame* frames,
+                    size_t            maxFrames);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // DI_ProtocolDecoder_h_
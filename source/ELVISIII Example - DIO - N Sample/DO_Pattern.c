@@ -0,0 +1,365 @@
+/**
+ * DO_Pattern.c
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include "DO_Pattern.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+/**
+ * Move a cursor to the next repetition, segment or loop once a repetition is complete.
+ *
+ * @param[in]  cursor   The cursor.
+ */
+static void Do_AdvancePattern(Do_PatternCursor* cursor)
+{
+    const Do_Pattern* pattern = cursor->pattern;
+
+    cursor->sample = 0;
+    if (++cursor->repetition < pattern->segments[cursor->segment].repeat)
+    {
+        return;
+    }
+
+    cursor->repetition = 0;
+    if (++cursor->segment < pattern->segmentCount)
+    {
+        return;
+    }
+
+    // The end of the pattern. Go back to the start of the loop if there is one.
+    if (pattern->loopStart < pattern->segmentCount
+        && (pattern->loopCount == DO_PATTERN_FOREVER || cursor->loop < pattern->loopCount))
+    {
+        ++cursor->loop;
+        cursor->segment = pattern->loopStart;
+        return;
+    }
+
+    cursor->done = NiFpga_True;
+}
+
+/**
+ * Skip the segments that have no samples so the cursor always points at a sample.
+ *
+ * @param[in]  cursor   The cursor.
+ */
+static void Do_SkipEmptySegments(Do_PatternCursor* cursor)
+{
+    const Do_Pattern* pattern = cursor->pattern;
+    size_t            skipped = 0;
+
+    while (!cursor->done)
+    {
+        const Do_PatternSegment* segment = &pattern->segments[cursor->segment];
+
+        if (segment->samples != 0 && segment->repeat != 0)
+        {
+            return;
+        }
+
+        // A loop made only of empty segments would never end.
+        if (++skipped > pattern->segmentCount)
+        {
+            cursor->done = NiFpga_True;
+            return;
+        }
+
+        cursor->repetition = segment->repeat;
+        Do_AdvancePattern(cursor);
+    }
+}
+
+/**
+ * Set a cursor to the first sample of a pattern.
+ *
+ * @param[in]  cursor    The cursor.
+ * @param[in]  pattern   The pattern. It must stay valid while the cursor is used.
+ */
+void Do_ResetPattern(Do_PatternCursor* cursor, const Do_Pattern* pattern)
+{
+    cursor->pattern    = pattern;
+    cursor->segment    = 0;
+    cursor->sample     = 0;
+    cursor->repetition = 0;
+    cursor->loop       = 0;
+    cursor->done       = (NiFpga_Bool)(pattern->segmentCount == 0);
+
+    Do_SkipEmptySegments(cursor);
+
+    return;
+}
+
+/**
+ * Compile the next values of a pattern into DO FIFO values.
+ * Only the values requested are generated, so a long or repeating pattern
+ * never has to be stored as FIFO values.
+ *
+ * The bit-planes are read 32 samples at a time and turned into FIFO values
+ * with Di_TransposeBlock. Channels that are not in channelMask are merged in
+ * with one OR per value.
+ *
+ * @param[in]  cursor            The position in the pattern. It is moved past the values compiled.
+ * @param[out] fxp_buffer_send   groups of values to be written to a DO FIFO.
+ * @param[in]  fifo_size         The number of values to compile.
+ *
+ * @return the number of values compiled. It is less than fifo_size at the end of the pattern.
+ */
+size_t Do_CompilePattern(Do_PatternCursor* cursor, uint64_t* fxp_buffer_send, size_t fifo_size)
+{
+    uint32_t block[DI_PLANE_BLOCK];
+    size_t   compiled = 0;
+    size_t   count;
+    size_t   word;
+    size_t   offset;
+    size_t   i;
+    uint32_t level;
+    int      channel;
+
+    while (compiled < fifo_size && !cursor->done)
+    {
+        const Do_PatternSegment* segment = &cursor->pattern->segments[cursor->segment];
+
+        // Compile up to the end of the repetition or the end of the buffer.
+        count = segment->samples - cursor->sample;
+        if (count > fifo_size - compiled)
+        {
+            count = fifo_size - compiled;
+        }
+
+        level = segment->level & ~segment->channelMask & DO_PATTERN_MASK;
+
+        if (segment->channelMask == 0)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                fxp_buffer_send[compiled + i] = level;
+            }
+        }
+        else
+        {
+            // Transpose the word of each plane that holds the current sample.
+            word   = cursor->sample / 32;
+            offset = cursor->sample % 32;
+            if (count > DI_PLANE_BLOCK - offset)
+            {
+                count = DI_PLANE_BLOCK - offset;
+            }
+
+            for (channel = 0; channel < DI_PLANE_BLOCK; ++channel)
+            {
+                block[channel] = 0;
+                if (channel < DI_PLANE_CHANNELS && (segment->channelMask & (1 << channel)))
+                {
+                    block[channel] = segment->planes[channel * segment->planeWords + word];
+                }
+            }
+
+            Di_TransposeBlock(block);
+
+            for (i = 0; i < count; ++i)
+            {
+                fxp_buffer_send[compiled + i] = (block[offset + i] & segment->channelMask) | level;
+            }
+        }
+
+        compiled += count;
+        cursor->sample += (uint32_t)count;
+
+        if (cursor->sample == segment->samples)
+        {
+            Do_AdvancePattern(cursor);
+            Do_SkipEmptySegments(cursor);
+        }
+    }
+
+    return compiled;
+}
+
+/**
+ * Configure the DO FIFO, fill it with the start of the pattern and start it.
+ * The DO sample rate is set by Do_Divisor and the channels must be enabled with
+ * Do_Direction and Do_Enable before the stream is started.
+ *
+ * @param[in]  stream    The stream to start.
+ * @param[in]  fifo      DO host-to-target FIFO to which to write.
+ * @param[in]  idle      The DO DMA Idle Register of the bank (DOADMA_IDL or DOBDMA_IDL).
+ * @param[in]  depth     The requested number of values of the host memory part of the DMA FIFO.
+ *                       It should hold at least the values output between two calls of
+ *                       Do_ServicePatternStream.
+ * @param[in]  cursor    The position in the pattern.
+ *
+ * @return the status of the NiFpga calls.
+ */
+int32_t Do_StartPatternStream(Do_PatternStream*     stream,
+                              HostToTarget_FIFO_FXP fifo,
+                              uint32_t              idle,
+                              size_t                depth,
+                              Do_PatternCursor*     cursor)
+{
+    NiFpga_Status status;
+
+    stream->fifo       = fifo;
+    stream->idle       = idle;
+    stream->depth      = depth;
+    stream->chunk      = DO_PATTERN_CHUNK;
+    stream->written    = 0;
+    stream->underflows = 0;
+
+    // Set the size of the host memory part of the DMA FIFO.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_ConfigureFifo2(NiELVISIIIv10_session, fifo, depth, &stream->depth);
+
+    // Check if there was an error configuring the FIFO.
+    // If there was an error then print an error message to stdout and return.
+    if (NiFpga_IsError(status))
+    {
+        printf("Could not configure the DO FIFO!\n");
+        return status;
+    }
+
+    if (stream->chunk > stream->depth)
+    {
+        stream->chunk = stream->depth;
+    }
+
+    // Fill the host buffer before the FPGA starts reading it.
+    status = Do_ServicePatternStream(stream, cursor, 0);
+    if (NiFpga_IsError(status))
+    {
+        return status;
+    }
+
+    // Start the FIFO.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_StartFifo(NiELVISIIIv10_session, fifo);
+
+    // Check if there was an error starting the FIFO.
+    // If there was an error then print an error message to stdout and return.
+    if (NiFpga_IsError(status))
+    {
+        printf("Could not start the DO FIFO!\n");
+    }
+
+    return status;
+}
+
+/**
+ * Refill the DO FIFO with the next values of the pattern.
+ * The values are compiled straight into the host memory part of the DMA FIFO,
+ * so the DMA buffer itself is the prefetch ring and no copy is made.
+ *
+ * Call it often enough that the FIFO does not run empty: at a DO rate of R
+ * samples per second, at least every depth / R seconds. If the DO DMA is found
+ * idle before the pattern has ended, underflows is incremented. The idle register
+ * is read once per call, before the FIFO is refilled, so underflows is a lower
+ * bound: an underflow that starts and ends while the FIFO is refilled is not seen.
+ *
+ * @param[in]  stream    The stream.
+ * @param[in]  cursor    The position in the pattern.
+ * @param[in]  timeout   timeout in milliseconds to wait for free space, or NiFpga_InfiniteTimeout.
+ *                       A timeout is not an error, it means that the FIFO is full.
+ *
+ * @return the status of the NiFpga calls.
+ */
+int32_t Do_ServicePatternStream(Do_PatternStream* stream, Do_PatternCursor* cursor, uint32_t timeout)
+{
+    NiFpga_Status status = NiFpga_Status_Success;
+    NiFpga_Bool   idle   = NiFpga_False;
+    uint64_t*     elements;
+    size_t        acquired;
+    size_t        remaining = 1;
+    size_t        compiled;
+
+    if (cursor->done)
+    {
+        return status;
+    }
+
+    // The FPGA has nothing left to output although the pattern has not ended.
+    if (stream->written >= stream->depth)
+    {
+        NiFpga_MergeStatus(&status, NiFpga_ReadBool(NiELVISIIIv10_session, stream->idle, &idle));
+        if (idle)
+        {
+            ++stream->underflows;
+        }
+    }
+
+    // Fill the free part of the host buffer, one chunk at a time.
+    while (remaining > 0 && !cursor->done && NiFpga_IsNotError(status))
+    {
+        status = NiFpga_AcquireFifoWriteElementsU64(NiELVISIIIv10_session,
+                                                    stream->fifo,
+                                                    &elements,
+                                                    stream->chunk,
+                                                    timeout,
+                                                    &acquired,
+                                                    &remaining);
+
+        // Not enough free space for a chunk. Try again at the next call.
+        if (status == NiFpga_Status_FifoTimeout)
+        {
+            return NiFpga_Status_Success;
+        }
+
+        if (NiFpga_IsError(status))
+        {
+            printf("Could not acquire the DO FIFO elements!\n");
+            return status;
+        }
+
+        compiled = Do_CompilePattern(cursor, elements, acquired);
+
+        // The end of the pattern. Hold the last value in the rest of the elements.
+        if (compiled < acquired)
+        {
+            uint64_t last = (compiled > 0) ? elements[compiled - 1] : 0;
+
+            for (; compiled < acquired; ++compiled)
+            {
+                elements[compiled] = last;
+            }
+        }
+
+        NiFpga_MergeStatus(&status, NiFpga_ReleaseFifoElements(NiELVISIIIv10_session, stream->fifo, acquired));
+        stream->written += acquired;
+
+        // Only wait for the first chunk.
+        timeout = 0;
+    }
+
+    return status;
+}
+
+/**
+ * Stop the DO FIFO.
+ *
+ * @param[in]  stream    The stream.
+ */
+void Do_StopPatternStream(Do_PatternStream* stream)
+{
+    NiFpga_Status status;
+
+    // Stop the FIFO.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_StopFifo(NiELVISIIIv10_session, stream->fifo);
+
+    // Check if there was an error stopping the FIFO.
+    // If there was an error then print an error message to stdout and return.
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not stop the DO FIFO!");
+
+    return;
+}
@@ -0,0 +1,109 @@
+/**
+ * DO_Pattern.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef DO_Pattern_h_
+#define DO_Pattern_h_
+
+#include "DIO_N_Sample.h"
+#include "DI_BitPlane.h"
+
+// Loop count that repeats the loop of a pattern until the stream is stopped.
+// A loop count of 0 outputs the pattern once, without repeating the loop.
+#define DO_PATTERN_FOREVER UINT32_MAX
+
+// The bits of a DO FIFO value that hold the DIO channels.
+#define DO_PATTERN_MASK 0xFFFFF
+
+// Default number of FIFO values compiled at a time.
+#define DO_PATTERN_CHUNK 256
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+/**
+ * A run of samples of a digital pattern.
+ * The channels in channelMask are read from bit-planes in the DI_BitPlane
+ * layout (plane c at planes + c * planeWords, sample n in bit n % 32 of word n / 32).
+ * The other channels hold the value of level for the whole segment.
+ */
+typedef struct
+{
+    const uint32_t* planes;       // Bit-planes of the channels, or NULL if channelMask is 0
+    size_t          planeWords;   // Number of words of each plane
+    uint32_t        channelMask;  // Channels read from planes (DIO0 = bit0, DIO1 = bit1, etc.)
+    uint32_t        level;        // Value of the channels that are not in channelMask
+    uint32_t        samples;      // Number of samples of one repetition
+    uint32_t        repeat;       // Number of repetitions of the segment
+} Do_PatternSegment;
+
+/**
+ * A digital pattern.
+ * The segments are output in order once, then the segments from loopStart to
+ * the end are output loopCount more times.
+ */
+typedef struct
+{
+    const Do_PatternSegment* segments;
+    size_t                   segmentCount;
+    size_t                   loopStart;   // First segment of the loop
+    uint32_t                 loopCount;   // Number of loops, or DO_PATTERN_FOREVER
+} Do_Pattern;
+
+/**
+ * The position of the generator in a pattern.
+ */
+typedef struct
+{
+    const Do_Pattern* pattern;
+    size_t            segment;      // Current segment
+    uint32_t          sample;       // Sample in the current repetition
+    uint32_t          repetition;   // Repetition of the current segment
+    uint32_t          loop;         // Loops completed
+    NiFpga_Bool       done;         // All the samples of the pattern are compiled
+} Do_PatternCursor;
+
+/**
+ * Streams a pattern to a DO FIFO.
+ */
+typedef struct
+{
+    HostToTarget_FIFO_FXP fifo;       // DO FIFO
+    uint32_t              idle;       // DO DMA Idle Register (DOADMA_IDL or DOBDMA_IDL)
+    size_t                depth;      // Number of values of the host memory part of the DMA FIFO
+    size_t                chunk;      // Number of values compiled at a time
+    uint64_t              written;    // Number of values written
+    uint32_t              underflows; // Lower bound of the number of underflows. The DO DMA is checked for
+                                      // idle once per Do_ServicePatternStream call, so an underflow that
+                                      // starts and ends within a call is not counted
+} Do_PatternStream;
+
+// Set a cursor to the first sample of a pattern.
+void Do_ResetPattern(Do_PatternCursor* cursor, const Do_Pattern* pattern);
+
+// Compile the next values of a pattern into DO FIFO values.
+size_t Do_CompilePattern(Do_PatternCursor* cursor, uint64_t* fxp_buffer_send, size_t fifo_size);
+
+// Configure the DO FIFO, fill it with the start of the pattern and start it.
+int32_t Do_StartPatternStream(Do_PatternStream*     stream,
+                              HostToTarget_FIFO_FXP fifo,
+                              uint32_t              idle,
+                              size_t                depth,
+                              Do_PatternCursor*     cursor);
+
+// Refill the DO FIFO with the next values of the pattern.
+int32_t Do_ServicePatternStream(Do_PatternStream* stream, Do_PatternCursor* cursor, uint32_t timeout);
+
+// Stop the DO FIFO.
+void Do_StopPatternStream(Do_PatternStream* stream);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // DO_Pattern_h_
@@ -67,7 +67,13 @@ int main()
     }
 
     // Change the channelA0 mode to DIO by setting SYS.SELECTx register.
-    Dio_Select(&bank_A, Dio_Channel0);
+    // Stop if the channel is owned by another function.
+    status = Dio_Select(&bank_A, Dio_Channel0);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Set the Direction of the DIO0 on bank A.
     Di_Direction(&bank_A, Dio_Channel0);
@@ -102,7 +108,13 @@ int main()
     printf("\n");
 
     // Change the channelA0 mode to DIO by setting SYS.SELECTx register.
-    Dio_Select(&bank_B, Dio_Channel0);
+    // Stop if the channel is owned by another function.
+    status = Dio_Select(&bank_B, Dio_Channel0);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Set the Direction of the DIO0 on bank B.
     Do_Direction(&bank_B, Dio_Channel0);
@@ -16,6 +16,7 @@
  */
 #include "NiELVISIIIv10.h"
 #include "DIO.h"
+#include "PinMux.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -27,43 +28,27 @@
 extern NiFpga_Session NiELVISIIIv10_session;
 
 // Initialize the register addresses of DI in bank A.
-ELVISIII_Dio bank_A = {98304, 98312, 98320, SYSSELECTA};
+ELVISIII_Dio bank_A = {98304, 98312, 98320, SYSSELECTA, 0};
 
 // Initialize the register addresses of DI in bank B.
-ELVISIII_Dio bank_B = {99532, 99524, 99516, SYSSELECTB};
+ELVISIII_Dio bank_B = {99532, 99524, 99516, SYSSELECTB, 0};
 
 /**
  * Select DIO channel by setting the System Select Register.
  *
  * @param[in]  bank        A struct containing the registers for one connecter.
  * @param[in]  channel     Enum containing 20 kinds of DIO channels.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the channel is owned by a committed plan.
  */
-void Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel)
+int32_t Dio_Select(ELVISIII_Dio* bank, Dio_Channel channel)
 {
-    NiFpga_Status status;
-    uint64_t selectReg;
-
     // DIO outputs are on pins shared with other buses like PWM, Encoder, UART, SPI and I2C.
     // To output on a physical pin, select the DIO channel by setting the appropriate SELECT Register.
-    // Read the value of the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
-
-    // Clear bits of the SYSSELECTA/SYSSELECTB register.
-    // For DIO, the value for DIO select is 0, so we just need to clear the 2 bits and don't need to set.
-    selectReg = selectReg & (~((uint64_t)0b11 << (channel * 2)));
-
-    // Write the new value to the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not Write to the System Select Register!");
-
-    return;
+    // For DIO, the value for DIO select is 0 (2 bits per channel).
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the channel is not already selected as DIO.
+    return PinMux_Select(bank->sel, channel, 1, PinMux_Dio);
 }
 
 /**
@@ -98,7 +83,12 @@ NiFpga_Bool Dio_ReadBit(ELVISIII_Dio* bank, Dio_Channel channel)
     uint32_t inValue  = 0;
 
     // Change the channel mode to DIO by setting SYS.SELECTx register.
-    Dio_Select(bank, channel);
+    // Stop if the channel is owned by another function.
+    status = Dio_Select(bank, channel);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        return NiFpga_False;
+    }
 
     // Get the value of the DI Direction Register.
     // The returned NiFpga_Status value is stored for error checking.
@@ -169,7 +159,12 @@ void Dio_WriteBit(ELVISIII_Dio* bank, NiFpga_Bool value, Dio_Channel channel)
     uint8_t bit = channel;
 
     // Change the channel mode to DIO by setting SYS.SELECTx register.
-    Dio_Select(bank, channel);
+    // Stop if the channel is owned by another function.
+    status = Dio_Select(bank, channel);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        return;
+    }
 
     // Get the value from the DO Value Register.
     // The returned NiFpga_Status value is stored for error checking.
@@ -199,6 +194,10 @@ void Dio_WriteBit(ELVISIII_Dio* bank, NiFpga_Bool value, Dio_Channel channel)
     // Write the new value of the output register to the device.
     NiFpga_MergeStatus(&status, NiFpga_WriteU32(NiELVISIIIv10_session, bank->out, outValue));
 
+    // Keep the cached output value in step with the register so that the port functions
+    // do not overwrite this channel with a stale value.
+    bank->outCache = outValue;
+
     // Write the new value of the direction register to the device to ensure that the DIO channel is set as an output channel.
     NiFpga_MergeStatus(&status, NiFpga_WriteU32(NiELVISIIIv10_session, bank->dir, dirValue));
 
@@ -208,3 +207,144 @@ void Dio_WriteBit(ELVISIII_Dio* bank, NiFpga_Bool value, Dio_Channel channel)
 
     return;
 }
+
+/**
+ * Select DIO on a set of channels of a bank and set the direction of those channels at once.
+ *
+ * Dio_ReadBit and Dio_WriteBit set the System Select Register and the DIR register
+ * every time they are called. If the same channels are accessed repeatedly, call this
+ * function once instead and then use Dio_ReadPort, Dio_WritePort and Dio_WriteMasked,
+ * which only touch the DI/DO Value Registers.
+ *
+ * Each bit in channelMask and outputMask corresponds to one of the DIO channels:
+ *    DIO0  = bit0
+ *    DIO1  = bit1
+ *       ...
+ *    DIO19 = bit19
+ *
+ * Only the channels in channelMask are selected as DIO and change direction, so
+ * the pins used by other functions such as PWM, SPI or I2C keep their function.
+ * In outputMask, a value of 1 makes the channel an output, a value of 0 makes the
+ * channel an input.
+ *
+ * @param[in]  bank          A struct containing the registers for one connecter.
+ * @param[in]  channelMask   Bit mask of the channels to configure.
+ * @param[in]  outputMask    Bit mask of the channels to set as outputs.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if a channel is owned by a committed plan.
+ */
+int32_t Dio_ConfigurePort(ELVISIII_Dio* bank, uint32_t channelMask, uint32_t outputMask)
+{
+    NiFpga_Status status = NiFpga_Status_Success;
+    uint32_t remaining;
+    uint32_t dirValue = 0;
+    uint8_t  first;
+    uint8_t  count;
+
+    channelMask = channelMask & DIO_PORT_MASK;
+
+    // Select DIO on each run of consecutive channels in the mask, with at most one
+    // write of the SYSSELECTA/SYSSELECTB Register per run.
+    remaining = channelMask;
+    while (remaining != 0)
+    {
+        first = __builtin_ctz(remaining);
+        count = __builtin_ctz(~(remaining >> first));
+        status = PinMux_Select(bank->sel, first, count, PinMux_Dio);
+        if (NiELVISIIIv10_IsNotSuccess(status))
+        {
+            return status;
+        }
+        remaining = remaining & ~(((1u << count) - 1) << first);
+    }
+
+    // Get the value of the DIO Direction Register.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, bank->dir, &dirValue);
+
+    // Write the direction of the channels in the mask, leaving the other channels unchanged.
+    dirValue = (dirValue & ~channelMask) | (outputMask & channelMask);
+    NiFpga_MergeStatus(&status, NiFpga_WriteU32(NiELVISIIIv10_session, bank->dir, dirValue));
+
+    // Get the current value of the DO Value Register so that Dio_WriteMasked can
+    // update single channels without reading the register back every time.
+    NiFpga_MergeStatus(&status, NiFpga_ReadU32(NiELVISIIIv10_session, bank->out, &bank->outCache));
+
+    // Check if there was an error accessing the DIO registers.
+    // If there was an error then print an error message to stdout.
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not configure the DIO port!");
+
+    return status;
+}
+
+/**
+ * Read the values of all 20 channels of a bank.
+ *
+ * The port must be configured with Dio_ConfigurePort first. The value of the
+ * channels configured as outputs is undefined.
+ *
+ * @param[in]  bank      A struct containing the registers for one connecter.
+ *
+ * @return the logical values of the channels, DIO0 = bit0 ... DIO19 = bit19.
+ */
+uint32_t Dio_ReadPort(ELVISIII_Dio* bank)
+{
+    NiFpga_Status status;
+    uint32_t inValue = 0;
+
+    // Get the value of the DI Value Register.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, bank->in, &inValue);
+
+    // Check if there was an error reading from the DI Value Register.
+    // If there was an error then print an error message to stdout and return.
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not read from the DI Value Register!");
+
+    return inValue & DIO_PORT_MASK;
+}
+
+/**
+ * Write the values of all 20 channels of a bank.
+ *
+ * The port must be configured with Dio_ConfigurePort first. The value of the
+ * channels configured as inputs is ignored by the device.
+ *
+ * @param[in]  bank      A struct containing the registers for one connecter.
+ * @param[in]  value     The values of the channels, DIO0 = bit0 ... DIO19 = bit19.
+ */
+void Dio_WritePort(ELVISIII_Dio* bank, uint32_t value)
+{
+    NiFpga_Status status;
+
+    value = value & DIO_PORT_MASK;
+
+    // Write the new value of the output register to the device.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_WriteU32(NiELVISIIIv10_session, bank->out, value);
+
+    // Check if there was an error writing to the DO Value Register.
+    // If there was an error then print an error message to stdout and return.
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not write to the DO Value Register!");
+
+    bank->outCache = value;
+
+    return;
+}
+
+/**
+ * Write the values of the channels selected by mask, leaving the other channels unchanged.
+ *
+ * The new value is merged with the cached output value of the bank, so only one
+ * write to the DO Value Register is needed. The port must be configured with
+ * Dio_ConfigurePort first.
+ *
+ * @param[in]  bank      A struct containing the registers for one connecter.
+ * @param[in]  mask      Bit mask of the channels to update.
+ * @param[in]  value     The values of the channels, DIO0 = bit0 ... DIO19 = bit19.
+ */
+void Dio_WriteMasked(ELVISIII_Dio* bank, uint32_t mask, uint32_t value)
+{
+    Dio_WritePort(bank, (bank->outCache & ~mask) | (value & mask));
+
+    return;
+}
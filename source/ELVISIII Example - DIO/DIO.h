@@ -48,6 +48,9 @@ typedef enum
     Dio_Channel19 = 19,
 } Dio_Channel;
 
+// Bit mask covering all 20 DIO channels of one bank (DIO0 = bit0 ... DIO19 = bit19).
+#define DIO_PORT_MASK 0xFFFFF
+
 /**
  * Registers and settings for a particular DIO.
  * DI and DO share the same structure.
@@ -59,6 +62,8 @@ typedef struct
     uint32_t in;          // DI Value Register 
     uint32_t out;         // DO Value Register
     uint32_t sel;         // System Select Register
+
+    uint32_t outCache;    // Last value written to the DO Value Register
 } ELVISIII_Dio;
 
 // Read the value from one channel.
@@ -67,6 +72,18 @@ NiFpga_Bool Dio_ReadBit(ELVISIII_Dio* bank, Dio_Channel channel);
 // Write the value into one channel.
 void Dio_WriteBit(ELVISIII_Dio* bank, NiFpga_Bool value, Dio_Channel channel);
 
+// Select DIO on a set of channels of a bank and set the direction of those channels at once.
+int32_t Dio_ConfigurePort(ELVISIII_Dio* bank, uint32_t channelMask, uint32_t outputMask);
+
+// Read the values of all 20 channels of a bank.
+uint32_t Dio_ReadPort(ELVISIII_Dio* bank);
+
+// Write the values of all 20 channels of a bank.
+void Dio_WritePort(ELVISIII_Dio* bank, uint32_t value);
+
+// Write the values of the channels selected by mask, leaving the other channels unchanged.
+void Dio_WriteMasked(ELVISIII_Dio* bank, uint32_t mask, uint32_t value);
+
 #if NiFpga_Cpp
 }
 #endif
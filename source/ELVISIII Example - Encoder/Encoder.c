@@ -15,6 +15,7 @@
  */
 #include "NiELVISIIIv10.h"
 #include "Encoder.h"
+#include "PinMux.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -146,36 +147,16 @@ uint32_t Encoder_Counter(ELVISIII_Encoder* bank, Encoder_Channel channel)
  *
  * @param[in]  bank        A struct containing the registers for one connecter.
  * @param[in]  channel     Enum containing 10 kinds of Encoder channels.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the channel is owned by a committed plan.
  */
-void Encoder_Select(ELVISIII_Encoder* bank, Encoder_Channel channel)
+int32_t Encoder_Select(ELVISIII_Encoder* bank, Encoder_Channel channel)
 {
-    NiFpga_Status status;
-    uint64_t selectReg;
-
     // Encoder outputs are on pins shared with other onboard devices.
     // To output on a physical pin, select the Encoder on the appropriate SELECT Register.
-    // See the MUX example for simplified code to enable-disable onboard devices.
-    // Read the value of the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
-
-    // Clear bits of the SYSSELECTA/SYSSELECTB register. This is
-    // done so that the correct value can be set later on.
-    selectReg = selectReg & ~((uint64_t)0b1111 << (channel * 4));
-
-    // Set 0b1010 to the related 4 bits of the SYSSELECTA/SYSSELECTB register to enable Encoder functionality.
-    // The functionality of the bits is specified in the documentation.
-    selectReg = selectReg | ((uint64_t)0b1010) << (channel * 4);
-
-    // Write the new value to the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not Write to the System Select Register!");
-
-    return;
+    // Encoder channel n uses DIO(2n) and DIO(2n+1), so 0b1010 is set to the related 4 bits
+    // of the SYSSELECTA/SYSSELECTB register to enable Encoder functionality.
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the channel is not already selected as Encoder.
+    return PinMux_Select(bank->sel, channel * 2, 2, PinMux_Encoder);
 }
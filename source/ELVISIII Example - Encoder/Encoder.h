@@ -103,7 +103,7 @@ uint8_t Encoder_Status(ELVISIII_Encoder* bank, Encoder_Channel channel);
 uint32_t Encoder_Counter(ELVISIII_Encoder* bank, Encoder_Channel channel);
 
 // Write the value to the System Select Register.
-void Encoder_Select(ELVISIII_Encoder* bank, Encoder_Channel channel);
+int32_t Encoder_Select(ELVISIII_Encoder* bank, Encoder_Channel channel);
 
 #if NiFpga_Cpp
 }
@@ -59,7 +59,13 @@ int main(int argc, char **argv)
     }
 
     // Write the value to the Encoder Channel 0 on bank A.
-    Encoder_Select(&bank_A, Encoder_Channel0);
+    // Stop if the channel is owned by another function.
+    status = Encoder_Select(&bank_A, Encoder_Channel0);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Enable the encoder and configure to read step and direction signals.
     Encoder_Configure(&bank_A, Encoder_Channel0,
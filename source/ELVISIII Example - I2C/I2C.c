@@ -7,6 +7,7 @@
  */
 
 #include <stdio.h>
+#include <sched.h>
 #include <time.h>
 
 /**
@@ -16,6 +17,7 @@
  */
 #include "NiELVISIIIv10.h"
 #include "I2C.h"
+#include "PinMux.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -80,6 +82,85 @@ void I2c_Counter(ELVISIII_I2c* bank, uint8_t speed)
     return;
 }
 
+/**
+ * Wait for the I2C block to complete an operation.
+ *
+ * The personality has no IRQ for I2C, so the I2C Status Register is polled.
+ * A byte takes less than 100 us at 100 kbps, so the first reads spin on the
+ * register, the next ones yield the processor, and then the wait sleeps with
+ * a delay that doubles up to I2C_MAX_BACKOFF. The deadline is kept on
+ * CLOCK_MONOTONIC, so it is not affected by changes of the system time.
+ *
+ * @param[in]  bank     A struct containing the registers for one connecter.
+ * @param[out] stat     The value of the I2C Status Register when the operation completed.
+ *
+ * @return NiFpga_Status_Success when the operation completed,
+ *         NiELVISIIIv10_Status_I2cTimeout if it did not complete within I2C_TIMEOUT,
+ *         or the status of the failed register read.
+ */
+int32_t I2c_WaitComplete(ELVISIII_I2c* bank, uint8_t* stat)
+{
+    NiFpga_Status status;
+    struct timespec now;
+    struct timespec deadline;
+    struct timespec delay;
+    uint32_t backoff = I2C_MIN_BACKOFF;
+    uint32_t polls;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec  += I2C_TIMEOUT / 1000000;
+    deadline.tv_nsec += (I2C_TIMEOUT % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec  += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    for (polls = 0; ; ++polls)
+    {
+        // Read the I2C Status Register.
+        status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->stat, stat);
+        if (NiELVISIIIv10_IsNotSuccess(status))
+        {
+            return status;
+        }
+
+        // The operation is complete when the Busy bit is cleared.
+        if (!(*stat & I2c_Busy))
+        {
+            return NiFpga_Status_Success;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline.tv_sec
+            || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+        {
+            return NiELVISIIIv10_Status_I2cTimeout;
+        }
+
+        if (polls < I2C_SPIN_POLLS)
+        {
+            continue;
+        }
+        else if (polls < I2C_SPIN_POLLS + I2C_YIELD_POLLS)
+        {
+            sched_yield();
+        }
+        else
+        {
+            delay.tv_sec  = 0;
+            delay.tv_nsec = backoff * 1000;
+            nanosleep(&delay, NULL);
+
+            backoff *= 2;
+            if (backoff > I2C_MAX_BACKOFF)
+            {
+                backoff = I2C_MAX_BACKOFF;
+            }
+        }
+    }
+}
+
 /**
  * Write a series of bytes to the I2C channel.
  *
@@ -94,22 +175,16 @@ void I2c_Write(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numB
 {
     NiFpga_Status status;
 
-    NiFpga_Bool busy;
     NiFpga_Bool timeout = NiFpga_False;
     NiFpga_Bool error = NiFpga_False;
     NiFpga_Bool addrNak;
     NiFpga_Bool dataNak;
 
-    const uint8_t timeoutDelay = 1;  // 1 Second 
-
     uint32_t index;
     uint32_t lastIndex;
     uint8_t  control;
     uint8_t  stat;
 
-    time_t startTime;
-    time_t currentTime;
-
     // Fix the I2C address based on the write operation.
     // Shift the address one bit to the left and clear bit0.
     address = (address << 1) & 0xFE;
@@ -199,52 +274,46 @@ void I2c_Write(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numB
             break;
         }
 
-        // Wait for the I2C operation to complete
-        startTime = time(NULL); // Get the start time 
-        do
+        // Wait for the I2C operation to complete.
+        status = I2c_WaitComplete(bank, &stat);
+        if (status == NiELVISIIIv10_Status_I2cTimeout)
         {
-            // Get the status of the I2C block.
-            status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->stat, &stat);
-            if (NiELVISIIIv10_IsNotSuccess(status))
-            {
-                error = NiFpga_True;
-                NiELVISIIIv10_PrintStatus(status);
-                printf("Could not read from the I2C Status Register!");
-                break;
-            }
-
-            // Check the busy bit of the status register
-            busy = stat & I2c_Busy;
-
-            if (!busy)
-            {
-                break;
-            }
-
-            // Check if one second has passed since the operation was started.
-            // If it has then the operation has timed out
-            currentTime = time(NULL);
-            timeout = (currentTime - startTime) >= timeoutDelay;
+            timeout = NiFpga_True;
+            printf("The I2C operation timed out!\n");
+            break;
+        }
+        else if (NiELVISIIIv10_IsNotSuccess(status))
+        {
+            error = NiFpga_True;
+            NiELVISIIIv10_PrintStatus(status);
+            printf("Could not read from the I2C Status Register!");
+            break;
         }
-        while (!timeout || !error);
 
-        // If there was no error with the operation of the I2C block then check
-        // if there was an error with the actual I2C transmission.
-        if (!timeout || !error)
+        // The I2C block completed the operation, so check if there was an
+        // error with the actual I2C transmission.
+        error = stat & I2c_Error;
+        if (error)
         {
-            error = stat & I2c_Error;
-            if (error)
-            {
-                // Pull out the values of the Address NAK and Data NAK bits.
-                addrNak = (stat & I2c_Address_Nak) > 0;
-                dataNak = (stat & I2c_Data_Nak) > 0;
+            // Pull out the values of the Address NAK and Data NAK bits.
+            addrNak = (stat & I2c_Address_Nak) > 0;
+            dataNak = (stat & I2c_Data_Nak) > 0;
 
-                printf("Error during I2C Transmission!\n");
-                printf("ADRNAK: %d, DATNAK: %d\n", addrNak, dataNak);
-            }
+            printf("Error during I2C Transmission!\n");
+            printf("ADRNAK: %d, DATNAK: %d\n", addrNak, dataNak);
         }
     }
 
+    // If there was a timeout or an error then try to generate the stop bit to
+    // release the I2C bus and leave it in a good state. If there was no error
+    // then the stop bit would have already been generated so this step can be
+    // skipped.
+    if (timeout || error)
+    {
+        status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->cntl, I2c_Stop);
+        NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not write to the I2C Control Register!");
+    }
+
     return;
 }
 
@@ -262,21 +331,15 @@ void I2c_Read(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numBy
 {
     NiFpga_Status status;
 
-    NiFpga_Bool busy;
     NiFpga_Bool timeout = NiFpga_False;
     NiFpga_Bool error = NiFpga_False;
     NiFpga_Bool addrNak;
 
-    const uint8_t timeoutDelay = 1;  // 1 Second 
-
     uint32_t index;
     uint32_t lastIndex;
     uint8_t  control;
     uint8_t  stat;
 
-    time_t startTime;
-    time_t currentTime;
-
     // Fix the I2C address based on the read operation.
     // Shift the address one bit to the left and set bit0.
     address = (address << 1) | 0x01;
@@ -355,121 +418,270 @@ void I2c_Read(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numBy
             break;
         }
 
-        // Wait for the I2C Operation to complete
-        startTime = time(NULL); // Get the start time 
-        do
+        // Wait for the I2C operation to complete.
+        status = I2c_WaitComplete(bank, &stat);
+        if (status == NiELVISIIIv10_Status_I2cTimeout)
+        {
+            timeout = NiFpga_True;
+            printf("The I2C operation timed out!\n");
+            break;
+        }
+        else if (NiELVISIIIv10_IsNotSuccess(status))
         {
-            // Get the status of the I2C block.
-            status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->stat, &stat);
+            error = NiFpga_True;
+            NiELVISIIIv10_PrintStatus(status);
+            printf("Could not read from the I2C Status Register!");
+            break;
+        }
+
+        // The I2C block completed the operation, so check if there was an
+        // error with the actual I2C transmission.
+        error = stat & I2c_Error;
+        if (error)
+        {
+            // Pull out the value of the Address NAK. Data NAK is not
+            // important since this is a read operation.
+            addrNak = (stat & I2c_Address_Nak) > 0;
+
+            printf("Error during I2C Transmission!\n");
+            printf("ADRNAK: %d\n", addrNak);
+        }
+        else
+        {
+            // Read the data byte received.
+            status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->dati, &data[index]);
+
+            // Check if reading from the data in register was successful.
+            // If there was an error then the rest of the bytes cannot be
+            // received so print an error message to stdout and set error
+            // to break out of the loop. The function cannot return early
+            // otherwise the I2C bus will not be released and will be left in a bad state.
             if (NiELVISIIIv10_IsNotSuccess(status))
             {
                 error = NiFpga_True;
                 NiELVISIIIv10_PrintStatus(status);
-                printf("Could not read from the I2C Status Register!");
-                break;
+                printf("Could not read from the I2C Data In register!");
             }
+        }
 
-            // Check the busy bit of the status register
-            busy = stat & I2c_Busy;
+        // If there was a timeout or an error then don't continue to send the
+        // rest of the data bytes so break out of the loop.
+        if (timeout || error)
+        {
+            break;
+        }
+    }
 
-            if (!busy)
+    // If there was a timeout or an error then try to generate the stop bit to
+    // release the I2C bus and leave it in a good state. If there was no error
+    // then the stop bit would have already been generated so this step can be
+    // skipped.
+    if (timeout || error)
+    {
+        status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->cntl, I2c_Stop);
+        NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not write to the I2C Control Register!");
+    }
+
+    return;
+}
+
+/**
+ * Run a list of write and read segments as one I2C transaction.
+ *
+ * The first segment starts with a start bit, every other segment with a
+ * repeated start, and only the last byte of the last segment generates a stop
+ * bit, so the bus is not released between the segments. Every read byte is
+ * acknowledged except the last byte of its segment.
+ *
+ * The control byte of every byte of the transaction is computed before the
+ * first byte is sent. The I2C Address Register is only written when the
+ * address or the direction changes, and the I2C Control Register only when
+ * the control byte differs from the previous byte.
+ *
+ * @param[in]      bank           A struct containing the registers for one connecter.
+ * @param[in,out]  segments       The segments to run, in order. Their status fields are set on return.
+ * @param[in]      segmentCount   The number of segments.
+ *
+ * @return NiFpga_Status_Success when every byte was transferred,
+ *         NiELVISIIIv10_Status_I2cNak if the slave did not acknowledge,
+ *         NiELVISIIIv10_Status_I2cTimeout if an operation did not complete,
+ *         or the status of the failed register access.
+ */
+int32_t I2c_Transfer(ELVISIII_I2c* bank, I2c_Segment* segments, uint32_t segmentCount)
+{
+    NiFpga_Status status = NiFpga_Status_Success;
+
+    uint8_t  control[I2C_TRANSFER_BYTES];
+    uint32_t total = 0;
+    uint32_t seg;
+    uint32_t index;
+    uint32_t byte;
+    int32_t  address = -1;
+    int32_t  lastControl = -1;
+    uint8_t  stat;
+
+    // Compute the control byte of every byte of the transaction.
+    for (seg = 0; seg < segmentCount; seg++)
+    {
+        I2c_Segment* segment = &segments[seg];
+
+        segment->transferred = 0;
+        segment->addrNak = NiFpga_False;
+        segment->dataNak = NiFpga_False;
+
+        if (segment->count == 0 || total + segment->count > I2C_TRANSFER_BYTES)
+        {
+            printf("An I2C transaction must have 1 to %d bytes and no empty segment.\n", I2C_TRANSFER_BYTES);
+            return NiFpga_Status_InvalidParameter;
+        }
+
+        for (index = 0; index < segment->count; index++)
+        {
+            uint8_t value = I2c_Rx_Tx;
+
+            if (index == 0)
             {
-                break;
+                // Start bit, or repeated start bit after the first segment.
+                value |= I2c_Start;
             }
+            if (segment->read && index < segment->count - 1)
+            {
+                // The slave will have to send more data.
+                value |= I2c_Ack;
+            }
+            control[total++] = value;
+        }
+    }
+
+    if (total == 0)
+    {
+        return NiFpga_Status_Success;
+    }
+
+    // Release the bus after the last byte.
+    control[total - 1] |= I2c_Stop;
+
+    byte = 0;
+    for (seg = 0; seg < segmentCount && !NiELVISIIIv10_IsNotSuccess(status); seg++)
+    {
+        I2c_Segment* segment = &segments[seg];
+        int32_t segmentAddress = (segment->address << 1) | (segment->read ? 0x01 : 0x00);
 
-            // Check if one second has passed since the operation was started.
-            // If it has then the operation has timed out
-            currentTime = time(NULL);
-            timeout = (currentTime - startTime) >= timeoutDelay;
+        // Set the address of the slave device and the direction.
+        if (segmentAddress != address)
+        {
+            status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->addr, (uint8_t)segmentAddress);
+            if (NiELVISIIIv10_IsNotSuccess(status))
+            {
+                NiELVISIIIv10_PrintStatus(status);
+                printf("Could not write to the I2C Address Register!\n");
+                break;
+            }
+            address = segmentAddress;
         }
-        while (!timeout || !error);
 
-        // If there was no error with the operation of the I2C block then check
-        // if there was an error with the actual I2C transmission.
-        if (!timeout || !error)
+        for (index = 0; index < segment->count; index++, byte++)
         {
-            error = stat & I2c_Error;
-            if (error)
+            // Write the data byte to be transmitted.
+            if (!segment->read)
+            {
+                status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->dato, segment->data[index]);
+                if (NiELVISIIIv10_IsNotSuccess(status))
+                {
+                    NiELVISIIIv10_PrintStatus(status);
+                    printf("Could not write to the I2C Data Out Register!\n");
+                    break;
+                }
+            }
+
+            // Write the control byte if it changed.
+            if (control[byte] != lastControl)
+            {
+                status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->cntl, control[byte]);
+                if (NiELVISIIIv10_IsNotSuccess(status))
+                {
+                    NiELVISIIIv10_PrintStatus(status);
+                    printf("Could not write to the I2C Control Register!\n");
+                    break;
+                }
+                lastControl = control[byte];
+            }
+
+            // Start the I2C operation.
+            status = NiFpga_WriteBool(NiELVISIIIv10_session, bank->go, NiFpga_True);
+            if (NiELVISIIIv10_IsNotSuccess(status))
             {
-                // Pull out the value of the Address NAK. Data NAK is not
-                // important since this is a read operation.
-                addrNak = (stat & I2c_Address_Nak) > 0;
+                NiELVISIIIv10_PrintStatus(status);
+                printf("Could not start the I2C operation!\n");
+                break;
+            }
 
-                printf("Error during I2C Transmission!\n");
-                printf("ADRNAK: %d\n", addrNak);
+            // Wait for the I2C operation to complete.
+            status = I2c_WaitComplete(bank, &stat);
+            if (NiELVISIIIv10_IsNotSuccess(status))
+            {
+                if (status == NiELVISIIIv10_Status_I2cTimeout)
+                {
+                    printf("The I2C operation timed out!\n");
+                }
+                else
+                {
+                    NiELVISIIIv10_PrintStatus(status);
+                    printf("Could not read from the I2C Status Register!\n");
+                }
+                break;
             }
-            else
+
+            // Record which part of the segment the slave did not acknowledge.
+            if (stat & I2c_Error)
+            {
+                segment->addrNak = (stat & I2c_Address_Nak) > 0;
+                segment->dataNak = (stat & I2c_Data_Nak) > 0;
+                status = NiELVISIIIv10_Status_I2cNak;
+                break;
+            }
+
+            // Read the data byte received.
+            if (segment->read)
             {
-                // Read the data byte received.
-                status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->dati, &data[index]);
-
-                // Check if reading from the data in register was successful.
-                // If there was an error then the rest of the bytes cannot be
-                // received so print an error message to stdout and set error
-                // to break out of the loop. The function cannot return early
-                // otherwise the I2C bus will not be released and will be left in a bad state.
+                status = NiFpga_ReadU8(NiELVISIIIv10_session, bank->dati, &segment->data[index]);
                 if (NiELVISIIIv10_IsNotSuccess(status))
                 {
-                    error = NiFpga_True;
                     NiELVISIIIv10_PrintStatus(status);
-                    printf("Could not read from the I2C Data In register!");
+                    printf("Could not read from the I2C Data In Register!\n");
+                    break;
                 }
             }
-        }
 
-        // If there was a timeout or an error then don't continue to send the
-        // rest of the data bytes so break out of the loop.
-        if (timeout || error)
-        {
-            break;
+            segment->transferred++;
         }
     }
 
-    // If there was a timeout or an error then try to generate the stop bit to
-    // release the I2C bus and leave it in a good state. If there was no error
-    // then the stop bit would have already been generated so this step can be
-    // skipped.
-    if (timeout || error)
+    // If the transaction stopped early then generate the stop bit to release
+    // the I2C bus and leave it in a good state.
+    if (NiELVISIIIv10_IsNotSuccess(status))
     {
-        status = NiFpga_WriteU8(NiELVISIIIv10_session, bank->cntl, I2c_Stop);
-        NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not write to the I2C Control Register!");
+        NiFpga_Status stopStatus = NiFpga_WriteU8(NiELVISIIIv10_session, bank->cntl, I2c_Stop);
+        NiELVISIIIv10_ReturnIfNotSuccess(stopStatus, "Could not write to the I2C Control Register!");
     }
 
-    return;
+    return status;
 }
 
 /**
  * Write the value to the System Select Register.
  *
  * @param[in]  bank        A struct containing the registers for one connecter.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the pins are owned by a committed plan.
  */
-void I2c_Select(ELVISIII_I2c* bank)
+int32_t I2c_Select(ELVISIII_I2c* bank)
 {
-    NiFpga_Status status;
-    uint64_t selectReg;
-
     // I2C outputs are on pins shared with other onboard devices.
     // To output on a physical pin, select the I2C on the appropriate SELECT Register.
-    // See the MUX example for simplified code to enable-disable onboard devices.
-    // Read the value of the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
-
-    // No need to clear the value of the bits in the SYSSELECTA/SYSSELECTB register
-    // because I2C select is all 1.
-    // Set bit28:31 of the SYSSELECTA/SYSSELECTB register to enable SPI functionality.
+    // Set bit28:31 (DIO14:15) of the SYSSELECTA/SYSSELECTB register to enable I2C functionality.
     // The functionality of the bit is specified in the documentation.
-    selectReg = selectReg | ((uint64_t)0b1111) << 28;
-
-    // Write the new value to the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not Write to the System Select Register!");
-
-    return;
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the pins are not already selected as I2C.
+    return PinMux_Select(bank->sel, 14, 2, PinMux_SpiI2c);
 }
@@ -11,6 +11,40 @@
 
 #include "NiELVISIIIv10.h"
 
+// The I2C operation did not complete within I2C_TIMEOUT.
+static const int32_t NiELVISIIIv10_Status_I2cTimeout = -363029;
+
+// The slave did not acknowledge its address or a data byte.
+static const int32_t NiELVISIIIv10_Status_I2cNak = -363030;
+
+// The largest number of bytes of one I2C_Transfer, over all its segments.
+#if !defined(I2C_TRANSFER_BYTES)
+#define I2C_TRANSFER_BYTES 256
+#endif
+
+// Time allowed for one I2C operation to complete, in microseconds.
+#if !defined(I2C_TIMEOUT)
+#define I2C_TIMEOUT 1000000
+#endif
+
+// Reads of the I2C Status Register before the wait starts to yield the processor.
+#if !defined(I2C_SPIN_POLLS)
+#define I2C_SPIN_POLLS 64
+#endif
+
+// Reads of the I2C Status Register that yield the processor before the wait starts to sleep.
+#if !defined(I2C_YIELD_POLLS)
+#define I2C_YIELD_POLLS 16
+#endif
+
+// First and largest delay between two reads of the I2C Status Register while sleeping, in microseconds.
+#if !defined(I2C_MIN_BACKOFF)
+#define I2C_MIN_BACKOFF 10
+#endif
+#if !defined(I2C_MAX_BACKOFF)
+#define I2C_MAX_BACKOFF 1000
+#endif
+
 #if NiFpga_Cpp
 extern "C" {
 #endif
@@ -56,20 +90,39 @@ typedef struct
     uint32_t sel;      // System Select Register 
 } ELVISIII_I2c;
 
+// One write or read of a combined I2C transaction.
+typedef struct
+{
+    uint8_t     address;       // 7-bit address of the slave device
+    NiFpga_Bool read;          // NiFpga_True to read from the slave, NiFpga_False to write to it
+    uint8_t*    data;          // Bytes to write, or buffer for the bytes read
+    uint32_t    count;         // Number of bytes, at least 1
+
+    uint32_t    transferred;   // Bytes written or read, set by I2c_Transfer
+    NiFpga_Bool addrNak;       // The slave did not acknowledge its address, set by I2c_Transfer
+    NiFpga_Bool dataNak;       // The slave did not acknowledge a data byte, set by I2c_Transfer
+} I2c_Segment;
+
 // Configure the I2C block.
 void I2c_Configure(ELVISIII_I2c* bank, I2c_ConfigureSettings settings);
 
 // Set the speed of the I2C block.
 void I2c_Counter(ELVISIII_I2c* bank, uint8_t speed);
 
+// Wait for the I2C block to complete an operation.
+int32_t I2c_WaitComplete(ELVISIII_I2c* bank, uint8_t* stat);
+
 // Write a series of bytes to the I2C channel.
 void I2c_Write(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numBytes);
 
 // Read a series of bytes from the I2C channel.
 void I2c_Read(ELVISIII_I2c* bank, uint8_t address, uint8_t* data, uint32_t numBytes);
 
+// Run a list of write and read segments as one I2C transaction.
+int32_t I2c_Transfer(ELVISIII_I2c* bank, I2c_Segment* segments, uint32_t segmentCount);
+
 // Write the value to the System Select Register.
-void I2c_Select(ELVISIII_I2c* bank);
+int32_t I2c_Select(ELVISIII_I2c* bank);
 
 #if NiFpga_Cpp
 }
@@ -0,0 +1,347 @@
+/**
+ * I2C transactions from many threads, one worker per bank
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "I2cArbiter.h"
+
+/**
+ * Read CLOCK_MONOTONIC in microseconds.
+ *
+ * @return the current time, in microseconds.
+ */
+static uint64_t I2c_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Remove the transaction to start next from the list.
+ * The highest priority goes first, then the earliest deadline, then the
+ * oldest transaction. Called by the worker with the lock held.
+ *
+ * @param[in]  arbiter   The arbiter of the bank.
+ *
+ * @return the transaction, or NULL if the list is empty.
+ */
+static I2c_Transaction* I2c_TakeNext(I2c_Arbiter* arbiter)
+{
+    I2c_Transaction** best = NULL;
+    I2c_Transaction** link;
+    I2c_Transaction* transaction;
+
+    for (link = &arbiter->head; *link != NULL; link = &(*link)->next)
+    {
+        transaction = *link;
+        if (best == NULL
+            || transaction->priority > (*best)->priority
+            || (transaction->priority == (*best)->priority
+                && transaction->expires != 0
+                && ((*best)->expires == 0 || transaction->expires < (*best)->expires)))
+        {
+            best = link;
+        }
+    }
+
+    if (best == NULL)
+    {
+        return NULL;
+    }
+
+    transaction = *best;
+    *best = transaction->next;
+    if (arbiter->tail == transaction)
+    {
+        // The new tail is the transaction before the removed one.
+        arbiter->tail = NULL;
+        for (link = &arbiter->head; *link != NULL; link = &(*link)->next)
+        {
+            arbiter->tail = *link;
+        }
+    }
+
+    return transaction;
+}
+
+/**
+ * Transfer a transaction, update the statistics of its device and complete it.
+ * Called by the worker only.
+ *
+ * @param[in]  arbiter       The arbiter of the bank.
+ * @param[in]  transaction   The transaction, already removed from the list.
+ */
+static void I2c_RunTransaction(I2c_Arbiter* arbiter, I2c_Transaction* transaction)
+{
+    uint64_t start = I2c_Now();
+    uint64_t end;
+    uint64_t bytes = 0;
+    uint32_t latency;
+    uint32_t i;
+
+    // A transaction that starts after its deadline would return stale data,
+    // so the bus is left to the others.
+    if (transaction->expires != 0 && start > transaction->expires)
+    {
+        transaction->status = NiELVISIIIv10_Status_I2cDeadlineMissed;
+        end = start;
+    }
+    else
+    {
+        transaction->status = I2c_Transfer(arbiter->bank, transaction->segments, transaction->segmentCount);
+        end = I2c_Now();
+
+        for (i = 0; i < transaction->segmentCount; ++i)
+        {
+            bytes += transaction->segments[i].transferred;
+        }
+    }
+    latency = (uint32_t)(end - transaction->submitted);
+
+    // The callback runs before the transaction is marked done, so a thread in
+    // I2c_WaitTransaction can free the transaction as soon as it returns.
+    if (transaction->callback != NULL)
+    {
+        transaction->callback(transaction, transaction->data);
+    }
+
+    pthread_mutex_lock(&arbiter->lock);
+    ++arbiter->transactions;
+    if (transaction->device != NULL)
+    {
+        I2c_DeviceStats* stats = &transaction->device->stats;
+
+        if (transaction->status == NiELVISIIIv10_Status_I2cDeadlineMissed)
+        {
+            ++stats->missedDeadlines;
+        }
+        else
+        {
+            ++stats->transactions;
+            if (transaction->status != NiFpga_Status_Success)
+            {
+                ++stats->failures;
+            }
+            stats->bytes        += bytes;
+            stats->busTime      += end - start;
+            stats->totalLatency += latency;
+            if (latency > stats->maxLatency)
+            {
+                stats->maxLatency = latency;
+            }
+        }
+    }
+    transaction->done = NiFpga_True;
+    pthread_cond_broadcast(&arbiter->completed);
+    pthread_mutex_unlock(&arbiter->lock);
+}
+
+/**
+ * The worker thread of one bank.
+ *
+ * The worker takes one transaction at a time, so a transaction submitted with
+ * a higher priority while others wait starts as soon as the bus is free.
+ *
+ * @param[in]  resource   The arbiter.
+ */
+static void* I2c_ArbiterThread(void* resource)
+{
+    I2c_Arbiter* arbiter = (I2c_Arbiter*)resource;
+    I2c_Transaction* transaction;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&arbiter->lock);
+        while (arbiter->head == NULL && arbiter->running)
+        {
+            pthread_cond_wait(&arbiter->pending, &arbiter->lock);
+        }
+        transaction = I2c_TakeNext(arbiter);
+        pthread_mutex_unlock(&arbiter->lock);
+
+        // The arbiter is stopped and every transaction is complete.
+        if (transaction == NULL)
+        {
+            break;
+        }
+
+        I2c_RunTransaction(arbiter, transaction);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the worker of one I2C bank.
+ * Once it is started, every thread must use the bank through I2c_Submit only.
+ *
+ * @param[in]  arbiter  The arbiter to start.
+ * @param[in]  bank     bank_A or bank_B, already configured.
+ * @param[in]  config   How the worker is scheduled, or NULL for SCHED_FIFO at THREAD_STREAM_PRIORITY.
+ *
+ * @return the configuration status.
+ */
+int32_t I2c_StartArbiter(I2c_Arbiter* arbiter, ELVISIII_I2c* bank, const Thread_Config* config)
+{
+    Thread_Config threadConfig;
+    int32_t status;
+
+    memset(arbiter, 0, sizeof(I2c_Arbiter));
+    arbiter->bank = bank;
+    pthread_mutex_init(&arbiter->lock, NULL);
+    pthread_cond_init(&arbiter->pending, NULL);
+    pthread_cond_init(&arbiter->completed, NULL);
+
+    if (config != NULL)
+    {
+        threadConfig = *config;
+    }
+    else
+    {
+        Thread_InitConfig(&threadConfig, THREAD_STREAM_PRIORITY);
+    }
+
+    arbiter->running = NiFpga_True;
+    status = Thread_Create(&arbiter->thread, &threadConfig, I2c_ArbiterThread, arbiter);
+    if (status != 0)
+    {
+        printf("Failed to create the I2C worker thread!\n");
+        arbiter->running = NiFpga_False;
+        pthread_mutex_destroy(&arbiter->lock);
+        pthread_cond_destroy(&arbiter->pending);
+        pthread_cond_destroy(&arbiter->completed);
+        return status;
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Complete the queued transactions and stop the worker.
+ *
+ * @param[in]  arbiter  The arbiter to stop.
+ *
+ * @return the configuration status.
+ */
+int32_t I2c_StopArbiter(I2c_Arbiter* arbiter)
+{
+    pthread_mutex_lock(&arbiter->lock);
+    arbiter->running = NiFpga_False;
+    pthread_cond_signal(&arbiter->pending);
+    pthread_mutex_unlock(&arbiter->lock);
+
+    pthread_join(arbiter->thread, NULL);
+
+    pthread_mutex_destroy(&arbiter->lock);
+    pthread_cond_destroy(&arbiter->pending);
+    pthread_cond_destroy(&arbiter->completed);
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Queue a transaction on a bank.
+ * The transaction and its segments must stay valid until it is complete. Wait
+ * for it with I2c_WaitTransaction, or set its callback.
+ *
+ * @param[in]  arbiter       The arbiter of the bank.
+ * @param[in]  transaction   The transaction to queue.
+ *
+ * @return the configuration status.
+ */
+int32_t I2c_Submit(I2c_Arbiter* arbiter, I2c_Transaction* transaction)
+{
+    I2c_Transaction* pending;
+    uint32_t count = 0;
+
+    transaction->status    = NiFpga_Status_Success;
+    transaction->done      = NiFpga_False;
+    transaction->arbiter   = arbiter;
+    transaction->next      = NULL;
+    transaction->submitted = I2c_Now();
+    transaction->expires   = (transaction->deadline != 0) ? transaction->submitted + transaction->deadline : 0;
+
+    pthread_mutex_lock(&arbiter->lock);
+    if (!arbiter->running)
+    {
+        pthread_mutex_unlock(&arbiter->lock);
+        printf("The I2C arbiter is not running.\n");
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    if (arbiter->tail != NULL)
+    {
+        arbiter->tail->next = transaction;
+    }
+    else
+    {
+        arbiter->head = transaction;
+    }
+    arbiter->tail = transaction;
+
+    for (pending = arbiter->head; pending != NULL; pending = pending->next)
+    {
+        ++count;
+    }
+    if (count > arbiter->maxPending)
+    {
+        arbiter->maxPending = count;
+    }
+
+    pthread_cond_signal(&arbiter->pending);
+    pthread_mutex_unlock(&arbiter->lock);
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Wait until a transaction is complete and get its status.
+ *
+ * @param[in]  transaction   A transaction queued with I2c_Submit.
+ *
+ * @return the transfer status of the transaction, or NiELVISIIIv10_Status_I2cDeadlineMissed.
+ */
+int32_t I2c_WaitTransaction(I2c_Transaction* transaction)
+{
+    I2c_Arbiter* arbiter = transaction->arbiter;
+
+    pthread_mutex_lock(&arbiter->lock);
+    while (!transaction->done)
+    {
+        pthread_cond_wait(&arbiter->completed, &arbiter->lock);
+    }
+    pthread_mutex_unlock(&arbiter->lock);
+
+    return transaction->status;
+}
+
+/**
+ * Copy the statistics of a device while the worker may update them.
+ * The throughput is bytes / busTime, and the mean latency totalLatency / transactions.
+ *
+ * @param[in]  arbiter   The arbiter the device is used on.
+ * @param[in]  device    The device.
+ * @param[out] stats     The statistics of the device.
+ */
+void I2c_GetDeviceStats(I2c_Arbiter* arbiter, const I2c_Device* device, I2c_DeviceStats* stats)
+{
+    pthread_mutex_lock(&arbiter->lock);
+    *stats = device->stats;
+    pthread_mutex_unlock(&arbiter->lock);
+}
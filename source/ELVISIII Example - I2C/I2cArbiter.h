@@ -0,0 +1,111 @@
+/**
+ * I2cArbiter.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef I2cArbiter_h_
+#define I2cArbiter_h_
+
+#include <pthread.h>
+#include "I2C.h"
+#include "ThreadConfig.h"
+
+// The deadline of the transaction passed before the worker could start it.
+static const int32_t NiELVISIIIv10_Status_I2cDeadlineMissed = -363031;
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Priorities of a transaction. The worker always starts the highest priority first.
+typedef enum
+{
+    I2c_PriorityLow    = 0,
+    I2c_PriorityNormal = 1,
+    I2c_PriorityHigh   = 2
+} I2c_Priority;
+
+// Throughput and latency of the transactions of one device.
+typedef struct
+{
+    uint32_t transactions;      // Transactions completed, including the failed ones
+    uint32_t failures;          // Transactions that returned an error
+    uint32_t missedDeadlines;   // Transactions dropped because their deadline passed
+    uint64_t bytes;             // Bytes written and read
+    uint64_t busTime;           // Time the transactions used the bus, in microseconds
+    uint64_t totalLatency;      // Sum of the times from submit to completion, in microseconds
+    uint32_t maxLatency;        // Longest time from submit to completion, in microseconds
+} I2c_DeviceStats;
+
+// A device on the bus, used to collect the statistics of its transactions.
+typedef struct
+{
+    const char*     name;       // Name printed with the statistics
+    I2c_DeviceStats stats;      // Updated by the worker, read them with I2c_GetDeviceStats
+} I2c_Device;
+
+struct I2c_Transaction;
+
+// Function called by the worker when a transaction is complete.
+typedef void (*I2c_TransactionCallback)(struct I2c_Transaction* transaction, void* data);
+
+// One combined transaction queued on a bank.
+typedef struct I2c_Transaction
+{
+    I2c_Device*             device;        // Device that collects the statistics, or NULL
+    I2c_Segment*            segments;      // Segments passed to I2c_Transfer
+    uint32_t                segmentCount;  // Number of segments
+    I2c_Priority            priority;      // Transactions with a higher priority start first
+    uint32_t                deadline;      // Latest start after submit, in microseconds, or 0 for none
+
+    I2c_TransactionCallback callback;      // Function called when the transaction is complete, or NULL
+    void*                   data;          // Passed to callback
+
+    int32_t                 status;        // Transfer status, valid when done is set
+    volatile NiFpga_Bool    done;          // Set when the transaction is complete
+
+    uint64_t                submitted;     // Time of submit, on CLOCK_MONOTONIC in microseconds
+    uint64_t                expires;       // Time the deadline passes, or 0 for none
+    struct I2c_Arbiter*     arbiter;       // Arbiter the transaction was submitted to
+    struct I2c_Transaction* next;          // Next transaction in the queue
+} I2c_Transaction;
+
+// One worker thread that runs the transactions of one I2C bank back to back.
+typedef struct I2c_Arbiter
+{
+    ELVISIII_I2c*        bank;             // Bank driven by the worker
+    pthread_t            thread;           // Worker thread
+    pthread_mutex_t      lock;             // Protects the list, the done flags and the statistics
+    pthread_cond_t       pending;          // Signaled when a transaction is submitted or the arbiter stops
+    pthread_cond_t       completed;        // Signaled when a transaction is complete
+    I2c_Transaction*     head;             // Transactions not started yet, in submit order
+    I2c_Transaction*     tail;             // Newest transaction
+    NiFpga_Bool          running;          // Cleared to stop the worker
+
+    uint32_t             transactions;     // Transactions completed
+    uint32_t             maxPending;       // Most transactions waiting at the same time
+} I2c_Arbiter;
+
+// Start the worker of one I2C bank.
+int32_t I2c_StartArbiter(I2c_Arbiter* arbiter, ELVISIII_I2c* bank, const Thread_Config* config);
+
+// Complete the queued transactions and stop the worker.
+int32_t I2c_StopArbiter(I2c_Arbiter* arbiter);
+
+// Queue a transaction on a bank.
+int32_t I2c_Submit(I2c_Arbiter* arbiter, I2c_Transaction* transaction);
+
+// Wait until a transaction is complete and get its status.
+int32_t I2c_WaitTransaction(I2c_Transaction* transaction);
+
+// Copy the statistics of a device.
+void I2c_GetDeviceStats(I2c_Arbiter* arbiter, const I2c_Device* device, I2c_DeviceStats* stats);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // I2cArbiter_h_
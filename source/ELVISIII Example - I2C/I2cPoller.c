@@ -0,0 +1,575 @@
+/**
+ * Periodic I2C register polling with a double-buffered snapshot
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "I2cPoller.h"
+
+/**
+ * Read CLOCK_MONOTONIC in microseconds.
+ *
+ * @return the current time, in microseconds.
+ */
+static uint64_t I2c_PollNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Compute the greatest common divisor of two numbers.
+ *
+ * @param[in]  a   The first number.
+ * @param[in]  b   The second number.
+ *
+ * @return the greatest common divisor, or a if b is 0.
+ */
+static uint32_t I2c_Gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0)
+    {
+        uint32_t r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a;
+}
+
+/**
+ * Merge the items into reads.
+ *
+ * Items of the same device with the same period and contiguous or overlapping
+ * registers share one read of up to I2C_POLL_BLOCK_BYTES bytes. A read that
+ * is covered by a faster read of the same device, whose period divides its
+ * own, is dropped and its items take their bytes from the faster read.
+ *
+ * @param[in]  poller   The poller, with its items set.
+ *
+ * @return the configuration status.
+ */
+static int32_t I2c_MergeItems(I2c_Poller* poller)
+{
+    uint32_t order[I2C_POLL_ITEMS];
+    uint32_t period[I2C_POLL_ITEMS];
+    uint32_t remap[I2C_POLL_ITEMS];
+    uint32_t offset = 0;
+    uint32_t count = 0;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < poller->itemCount; ++i)
+    {
+        const I2c_PollItem* item = &poller->item[i];
+
+        if (item->length == 0 || item->length > I2C_POLL_BLOCK_BYTES || item->period == 0
+            || offset + item->length > I2C_POLL_TABLE_BYTES)
+        {
+            printf("I2C poll item %u must read 1 to %d bytes with a period, and all items at most %d bytes.\n",
+                   i, I2C_POLL_BLOCK_BYTES, I2C_POLL_TABLE_BYTES);
+            return NiFpga_Status_InvalidParameter;
+        }
+        poller->itemOffset[i] = offset;
+        offset += item->length;
+
+        // Sort the items by device, then period, then register.
+        for (j = i; j > 0; --j)
+        {
+            const I2c_PollItem* other = &poller->item[order[j - 1]];
+
+            if (other->address < item->address
+                || (other->address == item->address && other->period < item->period)
+                || (other->address == item->address && other->period == item->period && other->reg <= item->reg))
+            {
+                break;
+            }
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    // Extend the last read while the next item continues it.
+    poller->blockCount = 0;
+    for (i = 0; i < poller->itemCount; ++i)
+    {
+        const I2c_PollItem* item = &poller->item[order[i]];
+        I2c_PollBlock* block = (poller->blockCount > 0) ? &poller->block[poller->blockCount - 1] : NULL;
+        uint32_t end = item->reg + item->length;
+
+        if (block != NULL
+            && block->address == item->address
+            && period[poller->blockCount - 1] == item->period
+            && item->reg <= block->reg + block->length
+            && end - block->reg <= I2C_POLL_BLOCK_BYTES)
+        {
+            if (end > (uint32_t)(block->reg + block->length))
+            {
+                block->length = (uint8_t)(end - block->reg);
+            }
+        }
+        else
+        {
+            block = &poller->block[poller->blockCount];
+            memset(block, 0, sizeof(I2c_PollBlock));
+            block->address = item->address;
+            block->reg     = item->reg;
+            block->length  = item->length;
+            period[poller->blockCount] = item->period;
+            ++poller->blockCount;
+        }
+        poller->itemBlock[order[i]] = poller->blockCount - 1;
+    }
+
+    // Drop the reads covered by a faster read of the same device.
+    for (i = 0; i < poller->blockCount; ++i)
+    {
+        I2c_PollBlock* block = &poller->block[i];
+
+        remap[i] = i;
+        for (j = 0; j < poller->blockCount; ++j)
+        {
+            I2c_PollBlock* faster = &poller->block[j];
+
+            if (j != i
+                && faster->length != 0
+                && faster->address == block->address
+                && period[j] < period[i]
+                && period[i] % period[j] == 0
+                && faster->reg <= block->reg
+                && faster->reg + faster->length >= block->reg + block->length)
+            {
+                remap[i] = j;
+                block->length = 0;
+                break;
+            }
+        }
+    }
+
+    // Compact the reads that are left.
+    for (i = 0; i < poller->blockCount; ++i)
+    {
+        if (poller->block[i].length != 0)
+        {
+            poller->block[count] = poller->block[i];
+            period[count] = period[i];
+            for (j = 0; j < poller->blockCount; ++j)
+            {
+                if (remap[j] == i)
+                {
+                    remap[j] = count;
+                }
+            }
+            ++count;
+        }
+    }
+    for (i = 0; i < poller->itemCount; ++i)
+    {
+        poller->itemBlock[i] = remap[poller->itemBlock[i]];
+    }
+    poller->blockCount = count;
+
+    // The tick is the greatest common divisor of the periods, so every read is
+    // due on a tick. Periods that are not multiples of I2C_POLL_MIN_TICK are
+    // rounded to the nearest tick.
+    poller->tick = 0;
+    for (i = 0; i < count; ++i)
+    {
+        poller->tick = I2c_Gcd(period[i], poller->tick);
+    }
+    if (poller->tick < I2C_POLL_MIN_TICK)
+    {
+        poller->tick = I2C_POLL_MIN_TICK;
+    }
+    for (i = 0; i < count; ++i)
+    {
+        poller->block[i].period = (period[i] + poller->tick / 2) / poller->tick;
+        if (poller->block[i].period == 0)
+        {
+            poller->block[i].period = 1;
+        }
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Choose the tick at which each read is due in its period, so the reads are
+ * spread over the ticks instead of all being due on the same tick.
+ * The reads with the shortest period are placed first, each at the phase that
+ * keeps the most reads in one tick lowest.
+ *
+ * @param[in]  poller   The poller, with its reads merged.
+ */
+static void I2c_BalancePhases(I2c_Poller* poller)
+{
+    uint16_t load[I2C_POLL_SLOTS];
+    uint32_t order[I2C_POLL_ITEMS];
+    uint64_t slots = 1;
+    uint32_t i;
+    uint32_t j;
+
+    // Balance over one hyperperiod, the least common multiple of the periods.
+    for (i = 0; i < poller->blockCount && slots <= I2C_POLL_SLOTS; ++i)
+    {
+        slots = slots / I2c_Gcd((uint32_t)slots, poller->block[i].period) * poller->block[i].period;
+    }
+    if (slots > I2C_POLL_SLOTS)
+    {
+        slots = I2C_POLL_SLOTS;
+    }
+    memset(load, 0, sizeof(load));
+
+    for (i = 0; i < poller->blockCount; ++i)
+    {
+        for (j = i; j > 0 && poller->block[order[j - 1]].period > poller->block[i].period; --j)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    poller->maxLoad = 0;
+    for (i = 0; i < poller->blockCount; ++i)
+    {
+        I2c_PollBlock* block = &poller->block[order[i]];
+        uint32_t bestLoad = 0xFFFFFFFF;
+        uint32_t phase;
+        uint32_t slot;
+
+        for (phase = 0; phase < block->period && phase < slots; ++phase)
+        {
+            uint32_t peak = 0;
+
+            for (slot = phase; slot < slots; slot += block->period)
+            {
+                if (load[slot] > peak)
+                {
+                    peak = load[slot];
+                }
+            }
+            if (peak < bestLoad)
+            {
+                bestLoad = peak;
+                block->phase = phase;
+            }
+        }
+
+        for (slot = block->phase; slot < slots; slot += block->period)
+        {
+            ++load[slot];
+            if (load[slot] > poller->maxLoad)
+            {
+                poller->maxLoad = load[slot];
+            }
+        }
+    }
+}
+
+/**
+ * Write the reads of one tick to the snapshot that is not published, then
+ * publish it. Readers never wait for the poller: they retry their copy if
+ * the snapshot changed while they copied it.
+ *
+ * @param[in]  poller   The poller.
+ * @param[in]  now      The time the reads completed, in microseconds.
+ */
+static void I2c_Publish(I2c_Poller* poller, uint64_t now)
+{
+    I2c_PollSnapshot* front = &poller->snapshot[poller->front];
+    I2c_PollSnapshot* back = &poller->snapshot[poller->front ^ 1];
+    uint32_t i;
+
+    ++back->sequence;
+    __sync_synchronize();
+
+    memcpy(back->data, front->data, sizeof(back->data));
+    memcpy(back->timestamp, front->timestamp, sizeof(back->timestamp));
+    memcpy(back->status, front->status, sizeof(back->status));
+
+    for (i = 0; i < poller->itemCount; ++i)
+    {
+        const I2c_PollItem* item = &poller->item[i];
+        const I2c_PollBlock* block = &poller->block[poller->itemBlock[i]];
+
+        if (!block->queued)
+        {
+            continue;
+        }
+
+        back->status[i] = block->transaction.status;
+        if (block->transaction.status == NiFpga_Status_Success)
+        {
+            memcpy(&back->data[poller->itemOffset[i]], &block->data[item->reg - block->reg], item->length);
+            back->timestamp[i] = now;
+        }
+    }
+
+    __sync_synchronize();
+    ++back->sequence;
+    __sync_synchronize();
+    poller->front ^= 1;
+}
+
+/**
+ * The poller thread.
+ * At every tick it queues the reads that are due on the arbiter, waits for
+ * them and publishes their values together.
+ *
+ * @param[in]  resource   The poller.
+ */
+static void* I2c_PollerThread(void* resource)
+{
+    I2c_Poller* poller = (I2c_Poller*)resource;
+    struct timespec next;
+    uint64_t tick = 0;
+    uint32_t i;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (poller->running)
+    {
+        for (i = 0; i < poller->blockCount; ++i)
+        {
+            I2c_PollBlock* block = &poller->block[i];
+
+            block->queued = NiFpga_False;
+            if (tick % block->period == block->phase)
+            {
+                block->queued = (I2c_Submit(poller->arbiter, &block->transaction) == NiFpga_Status_Success);
+            }
+        }
+
+        for (i = 0; i < poller->blockCount; ++i)
+        {
+            if (poller->block[i].queued)
+            {
+                I2c_WaitTransaction(&poller->block[i].transaction);
+            }
+        }
+
+        I2c_Publish(poller, I2c_PollNow());
+        ++poller->cycles;
+
+        // Sleep until the next tick. Skip the ticks that already passed.
+        for (;;)
+        {
+            next.tv_nsec += poller->tick * 1000;
+            while (next.tv_nsec >= 1000000000)
+            {
+                next.tv_sec  += 1;
+                next.tv_nsec -= 1000000000;
+            }
+            ++tick;
+
+            if ((uint64_t)next.tv_sec * 1000000 + next.tv_nsec / 1000 > I2c_PollNow())
+            {
+                break;
+            }
+            ++poller->overruns;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+/**
+ * Merge the items into a schedule and start polling them.
+ *
+ * @param[in]  poller      The poller to start.
+ * @param[in]  arbiter     The running arbiter of the bank of the devices.
+ * @param[in]  items       The items to poll. They are copied.
+ * @param[in]  itemCount   The number of items, at most I2C_POLL_ITEMS.
+ * @param[in]  config      How the thread is scheduled, or NULL for SCHED_FIFO at THREAD_STREAM_PRIORITY.
+ *
+ * @return the configuration status.
+ */
+int32_t I2c_StartPoller(I2c_Poller* poller,
+                        I2c_Arbiter* arbiter,
+                        const I2c_PollItem* items,
+                        uint32_t itemCount,
+                        const Thread_Config* config)
+{
+    Thread_Config threadConfig;
+    int32_t status;
+    uint32_t i;
+
+    if (itemCount == 0 || itemCount > I2C_POLL_ITEMS)
+    {
+        printf("An I2C poller must have 1 to %d items.\n", I2C_POLL_ITEMS);
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    memset(poller, 0, sizeof(I2c_Poller));
+    poller->arbiter   = arbiter;
+    poller->itemCount = itemCount;
+    memcpy(poller->item, items, itemCount * sizeof(I2c_PollItem));
+
+    status = I2c_MergeItems(poller);
+    if (NiFpga_IsError(status))
+    {
+        return status;
+    }
+    I2c_BalancePhases(poller);
+
+    // Each read writes its first register, then reads after a repeated start.
+    // A read that cannot start within its tick is dropped.
+    for (i = 0; i < poller->blockCount; ++i)
+    {
+        I2c_PollBlock* block = &poller->block[i];
+
+        block->regByte = block->reg;
+        block->segments[0].address = block->address;
+        block->segments[0].read    = NiFpga_False;
+        block->segments[0].data    = &block->regByte;
+        block->segments[0].count   = 1;
+        block->segments[1].address = block->address;
+        block->segments[1].read    = NiFpga_True;
+        block->segments[1].data    = block->data;
+        block->segments[1].count   = block->length;
+
+        block->transaction.segments     = block->segments;
+        block->transaction.segmentCount = 2;
+        block->transaction.priority     = I2c_PriorityNormal;
+        block->transaction.deadline     = poller->tick;
+    }
+
+    if (config != NULL)
+    {
+        threadConfig = *config;
+    }
+    else
+    {
+        Thread_InitConfig(&threadConfig, THREAD_STREAM_PRIORITY);
+    }
+
+    poller->running = NiFpga_True;
+    status = Thread_Create(&poller->thread, &threadConfig, I2c_PollerThread, poller);
+    if (status != 0)
+    {
+        printf("Failed to create the I2C poller thread!\n");
+        poller->running = NiFpga_False;
+        return status;
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Stop polling. Returns after the reads of the current tick are complete.
+ *
+ * @param[in]  poller   The poller to stop.
+ *
+ * @return the configuration status.
+ */
+int32_t I2c_StopPoller(I2c_Poller* poller)
+{
+    poller->running = NiFpga_False;
+    pthread_join(poller->thread, NULL);
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Copy the last value of one item without blocking the poller.
+ *
+ * @param[in]  poller      The poller.
+ * @param[in]  item        The index of the item in the list passed to I2c_StartPoller.
+ * @param[out] data        The bytes of the item, length bytes.
+ * @param[out] timestamp   The end of the read on CLOCK_MONOTONIC in microseconds, 0 if the item was never read, or NULL.
+ *
+ * @return the status of the last read of the item.
+ */
+int32_t I2c_ReadPoll(I2c_Poller* poller, uint32_t item, uint8_t* data, uint64_t* timestamp)
+{
+    const I2c_PollSnapshot* snapshot;
+    uint32_t sequence;
+    uint64_t time;
+    int32_t status;
+
+    if (item >= poller->itemCount)
+    {
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    for (;;)
+    {
+        snapshot = &poller->snapshot[poller->front];
+        sequence = snapshot->sequence;
+        __sync_synchronize();
+        if (sequence & 1)
+        {
+            continue;
+        }
+
+        memcpy(data, &snapshot->data[poller->itemOffset[item]], poller->item[item].length);
+        time   = snapshot->timestamp[item];
+        status = snapshot->status[item];
+
+        __sync_synchronize();
+        if (snapshot->sequence == sequence)
+        {
+            break;
+        }
+    }
+
+    if (timestamp != NULL)
+    {
+        *timestamp = time;
+    }
+
+    return status;
+}
+
+/**
+ * Copy the last values of all the items at once, without blocking the poller.
+ * The copy holds the values of all the items as they were after one tick.
+ *
+ * @param[in]  poller     The poller.
+ * @param[out] snapshot   The values, timestamps and statuses of all the items.
+ */
+void I2c_ReadPollSnapshot(I2c_Poller* poller, I2c_PollSnapshot* snapshot)
+{
+    const I2c_PollSnapshot* published;
+    uint32_t sequence;
+
+    for (;;)
+    {
+        published = &poller->snapshot[poller->front];
+        sequence = published->sequence;
+        __sync_synchronize();
+        if (sequence & 1)
+        {
+            continue;
+        }
+
+        memcpy(snapshot->data, published->data, sizeof(snapshot->data));
+        memcpy(snapshot->timestamp, published->timestamp, sizeof(snapshot->timestamp));
+        memcpy(snapshot->status, published->status, sizeof(snapshot->status));
+
+        __sync_synchronize();
+        if (published->sequence == sequence)
+        {
+            break;
+        }
+    }
+
+    snapshot->sequence = sequence;
+}
@@ -0,0 +1,121 @@
+/**
+ * I2cPoller.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef I2cPoller_h_
+#define I2cPoller_h_
+
+#include <pthread.h>
+#include "I2cArbiter.h"
+
+// The largest number of items of one poller.
+#if !defined(I2C_POLL_ITEMS)
+#define I2C_POLL_ITEMS 64
+#endif
+
+// The largest number of bytes read by one transaction, and of one item.
+#if !defined(I2C_POLL_BLOCK_BYTES)
+#define I2C_POLL_BLOCK_BYTES 32
+#endif
+
+// The largest number of bytes of all the items together.
+#if !defined(I2C_POLL_TABLE_BYTES)
+#define I2C_POLL_TABLE_BYTES 512
+#endif
+
+// The shortest period of the schedule, in microseconds.
+#if !defined(I2C_POLL_MIN_TICK)
+#define I2C_POLL_MIN_TICK 1000
+#endif
+
+// The largest number of ticks over which the phases of the reads are balanced.
+#if !defined(I2C_POLL_SLOTS)
+#define I2C_POLL_SLOTS 1000
+#endif
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// One register range to poll.
+typedef struct
+{
+    uint8_t  address;    // 7-bit address of the slave device
+    uint8_t  reg;        // First register, written before the read
+    uint8_t  length;     // Number of bytes to read, 1 to I2C_POLL_BLOCK_BYTES
+    uint32_t period;     // Time between two reads, in microseconds
+} I2c_PollItem;
+
+// One read of the merged schedule, covering one or more items.
+typedef struct
+{
+    uint8_t         address;                      // 7-bit address of the slave device
+    uint8_t         reg;                          // First register of the read
+    uint8_t         length;                       // Number of bytes of the read
+    uint32_t        period;                       // Period in ticks
+    uint32_t        phase;                        // Tick of the period at which the read is due
+
+    uint8_t         regByte;                      // Written by the first segment
+    uint8_t         data[I2C_POLL_BLOCK_BYTES];   // Filled by the second segment
+    I2c_Segment     segments[2];                  // Register write, then read after a repeated start
+    I2c_Transaction transaction;                  // Queued on the arbiter
+    NiFpga_Bool     queued;                       // Submitted in the current tick
+} I2c_PollBlock;
+
+// The values of all the items, published as a whole.
+typedef struct
+{
+    volatile uint32_t sequence;                   // Odd while the poller writes the snapshot
+    uint8_t           data[I2C_POLL_TABLE_BYTES]; // Bytes of every item, at the offset of the item
+    uint64_t          timestamp[I2C_POLL_ITEMS];  // End of the last read of each item on CLOCK_MONOTONIC, in microseconds, or 0
+    int32_t           status[I2C_POLL_ITEMS];     // Status of the last read of each item
+} I2c_PollSnapshot;
+
+// A thread that reads a list of items at their periods through an arbiter.
+typedef struct
+{
+    I2c_Arbiter*         arbiter;                 // Arbiter of the bank of the devices
+    I2c_PollItem         item[I2C_POLL_ITEMS];    // The items to poll
+    uint32_t             itemCount;               // Number of items
+    uint32_t             itemBlock[I2C_POLL_ITEMS];  // Read that covers each item
+    uint32_t             itemOffset[I2C_POLL_ITEMS]; // Offset of each item in the snapshot data
+
+    I2c_PollBlock        block[I2C_POLL_ITEMS];   // Reads of the merged schedule
+    uint32_t             blockCount;              // Number of reads
+    uint32_t             tick;                    // Period of the schedule, in microseconds
+    uint32_t             maxLoad;                 // Most reads due in one tick
+
+    I2c_PollSnapshot     snapshot[2];             // Published snapshot and the one being written
+    volatile uint32_t    front;                   // Index of the published snapshot
+
+    pthread_t            thread;                  // Poller thread
+    volatile NiFpga_Bool running;                 // Cleared to stop the thread
+    uint32_t             cycles;                  // Ticks run
+    uint32_t             overruns;                // Ticks skipped because the reads took too long
+} I2c_Poller;
+
+// Merge the items into a schedule and start polling them.
+int32_t I2c_StartPoller(I2c_Poller* poller,
+                        I2c_Arbiter* arbiter,
+                        const I2c_PollItem* items,
+                        uint32_t itemCount,
+                        const Thread_Config* config);
+
+// Stop polling.
+int32_t I2c_StopPoller(I2c_Poller* poller);
+
+// Copy the last value of one item without blocking the poller.
+int32_t I2c_ReadPoll(I2c_Poller* poller, uint32_t item, uint8_t* data, uint64_t* timestamp);
+
+// Copy the last values of all the items at once.
+void I2c_ReadPollSnapshot(I2c_Poller* poller, I2c_PollSnapshot* snapshot);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // I2cPoller_h_
@@ -39,6 +39,8 @@ int main(int argc, char **argv)
     int index;
     uint8_t slaveWriteAddress = 0x53;
     uint8_t slaveReadAddress  = 0x53;
+    I2c_Segment segments[2];
+    uint8_t value;
 
     printf("I2C\n");
 
@@ -52,7 +54,13 @@ int main(int argc, char **argv)
     }
 
     // Write the value to the System Select Register on bank A.
-    I2c_Select(&bank_A);
+    // Stop if the pins are owned by another function.
+    status = I2c_Select(&bank_A);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Set the speed of the I2C block.
     I2c_Counter(&bank_A, 213);
@@ -75,6 +83,31 @@ int main(int argc, char **argv)
     }
     printf("\n");
 
+    // Read the register back in one transaction: write the register address,
+    // then read its value after a repeated start, without a stop bit between.
+    segments[0].address = slaveWriteAddress;
+    segments[0].read    = NiFpga_False;
+    segments[0].data    = &data[0];
+    segments[0].count   = 1;
+    segments[1].address = slaveReadAddress;
+    segments[1].read    = NiFpga_True;
+    segments[1].data    = &value;
+    segments[1].count   = 1;
+
+    data[0] = 0x2D;
+    status = I2c_Transfer(&bank_A, segments, 2);
+    if (status == NiELVISIIIv10_Status_I2cNak)
+    {
+        for (index = 0; index < 2; index++)
+        {
+            printf("Segment %d: ADRNAK: %d, DATNAK: %d\n", index, segments[index].addrNak, segments[index].dataNak);
+        }
+    }
+    else if (status == NiFpga_Status_Success)
+    {
+        printf("Register 0x%.2X: %.2X\n", data[0], value);
+    }
+
     // Close the ELVISIII NiFpga Session.
     // This function MUST be called after all other functions.
     status = NiELVISIIIv10_Close();
@@ -0,0 +1,343 @@
+/**
+ * Latency histograms and load generators for the IRQ latency benchmark
+ *
+ * Copyright (c) 2018,
+ * National Instruments.
+ * All rights reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "IrqLatency.h"
+
+// Size of one write of an IO load thread, in bytes.
+#define LATENCY_IO_BLOCK    65536
+
+// Number of blocks an IO load thread writes before it rewinds its file.
+#define LATENCY_IO_BLOCKS   64
+
+// Directory of the files written by the IO load threads.
+#if !defined(LATENCY_IO_DIR)
+#define LATENCY_IO_DIR      "."
+#endif
+
+// Arguments of one load thread.
+typedef struct
+{
+    Latency_Load* load;
+    uint32_t index;
+} Latency_LoadThread;
+
+static Latency_LoadThread loadThread[2 * LATENCY_MAX_LOAD];
+
+/**
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ *
+ * @return the time.
+ */
+uint64_t Latency_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Empty a histogram.
+ *
+ * @param[in]  histogram   The histogram to empty.
+ */
+void Latency_InitHistogram(Latency_Histogram* histogram)
+{
+    memset(histogram, 0, sizeof(Latency_Histogram));
+    histogram->min = UINT64_MAX;
+}
+
+/**
+ * Add a sample to a histogram.
+ *
+ * @param[in]  histogram   The histogram.
+ * @param[in]  latency     The sample, in nanoseconds.
+ */
+void Latency_AddSample(Latency_Histogram* histogram, uint64_t latency)
+{
+    uint64_t bin = latency / 1000;
+
+    if (bin >= LATENCY_BINS)
+    {
+        bin = LATENCY_BINS - 1;
+    }
+
+    ++histogram->bin[bin];
+    ++histogram->count;
+    histogram->sum += latency;
+    histogram->sumSquares += (double)latency * (double)latency;
+
+    if (latency < histogram->min)
+    {
+        histogram->min = latency;
+    }
+    if (latency > histogram->max)
+    {
+        histogram->max = latency;
+    }
+}
+
+/**
+ * Get the latency below which a percentage of the samples are.
+ * The result is the upper edge of the bin that contains the percentile, so it
+ * is rounded up to the next microsecond. It never exceeds the longest sample.
+ *
+ * @param[in]  histogram   The histogram.
+ * @param[in]  percent     The percentage, from 0 to 100.
+ *
+ * @return the latency in nanoseconds, 0 if the histogram is empty.
+ */
+uint64_t Latency_Percentile(const Latency_Histogram* histogram, double percent)
+{
+    uint64_t rank;
+    uint64_t seen = 0;
+    uint64_t edge;
+    uint32_t i;
+
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+
+    // The rank of the sample at the percentile, counted from 1.
+    rank = (uint64_t)ceil(percent / 100.0 * histogram->count);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (i = 0; i < LATENCY_BINS; ++i)
+    {
+        seen += histogram->bin[i];
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+
+    edge = (uint64_t)(i + 1) * 1000;
+
+    return (edge < histogram->max) ? edge : histogram->max;
+}
+
+/**
+ * Get the standard deviation of the samples.
+ *
+ * @param[in]  histogram   The histogram.
+ *
+ * @return the standard deviation in nanoseconds.
+ */
+double Latency_StandardDeviation(const Latency_Histogram* histogram)
+{
+    double mean;
+    double variance;
+
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+
+    mean = (double)histogram->sum / histogram->count;
+    variance = histogram->sumSquares / histogram->count - mean * mean;
+
+    return (variance > 0) ? sqrt(variance) : 0;
+}
+
+/**
+ * Print the percentiles of a histogram to the console, in microseconds.
+ *
+ * @param[in]  name        Name of the histogram.
+ * @param[in]  histogram   The histogram.
+ */
+void Latency_PrintHistogram(const char* name, const Latency_Histogram* histogram)
+{
+    if (histogram->count == 0)
+    {
+        printf("%-8s no samples\n", name);
+        return;
+    }
+
+    printf("%-8s min %8.1f  p50 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f  stddev %8.1f us\n",
+           name,
+           histogram->min / 1000.0,
+           Latency_Percentile(histogram, 50) / 1000.0,
+           Latency_Percentile(histogram, 99) / 1000.0,
+           Latency_Percentile(histogram, 99.9) / 1000.0,
+           histogram->max / 1000.0,
+           Latency_StandardDeviation(histogram) / 1000.0);
+}
+
+/**
+ * Write the percentiles and the non-empty bins of a histogram as a JSON
+ * member named name. All values are in nanoseconds. Each bin is written as
+ * [microsecond, count].
+ *
+ * @param[in]  file        The output file.
+ * @param[in]  name        Name of the member.
+ * @param[in]  histogram   The histogram.
+ */
+void Latency_WriteJson(FILE* file, const char* name, const Latency_Histogram* histogram)
+{
+    uint32_t i;
+    NiFpga_Bool first = NiFpga_True;
+
+    fprintf(file, "  \"%s\": {\n", name);
+    fprintf(file, "    \"count\": %u,\n", histogram->count);
+    fprintf(file, "    \"min_ns\": %llu,\n", (unsigned long long)(histogram->count ? histogram->min : 0));
+    fprintf(file, "    \"p50_ns\": %llu,\n", (unsigned long long)Latency_Percentile(histogram, 50));
+    fprintf(file, "    \"p99_ns\": %llu,\n", (unsigned long long)Latency_Percentile(histogram, 99));
+    fprintf(file, "    \"p999_ns\": %llu,\n", (unsigned long long)Latency_Percentile(histogram, 99.9));
+    fprintf(file, "    \"max_ns\": %llu,\n", (unsigned long long)histogram->max);
+    fprintf(file, "    \"mean_ns\": %.1f,\n", histogram->count ? (double)histogram->sum / histogram->count : 0.0);
+    fprintf(file, "    \"stddev_ns\": %.1f,\n", Latency_StandardDeviation(histogram));
+    fprintf(file, "    \"bins_us\": [");
+    for (i = 0; i < LATENCY_BINS; ++i)
+    {
+        if (histogram->bin[i] != 0)
+        {
+            fprintf(file, "%s[%u, %u]", first ? "" : ", ", i, histogram->bin[i]);
+            first = NiFpga_False;
+        }
+    }
+    fprintf(file, "]\n  }");
+}
+
+/**
+ * Spin on the CPU until the load is stopped.
+ *
+ * @param[in]  resource   The Latency_LoadThread of this thread.
+ */
+static void* Latency_CpuThread(void* resource)
+{
+    Latency_LoadThread* thread = (Latency_LoadThread*)resource;
+    volatile uint32_t value = thread->index;
+
+    while (thread->load->running)
+    {
+        value = value * 1664525 + 1013904223;
+    }
+
+    return NULL;
+}
+
+/**
+ * Write and sync a temporary file until the load is stopped.
+ *
+ * @param[in]  resource   The Latency_LoadThread of this thread.
+ */
+static void* Latency_IoThread(void* resource)
+{
+    Latency_LoadThread* thread = (Latency_LoadThread*)resource;
+    static char block[LATENCY_IO_BLOCK];
+    char path[128];
+    uint32_t written = 0;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/irq_latency_%d_%u.tmp", LATENCY_IO_DIR, (int)getpid(), thread->index);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        printf("Could not create the IO load file %s!\n", path);
+        return NULL;
+    }
+
+    // Remove the name now, so the file is deleted even if the program stops early.
+    unlink(path);
+
+    while (thread->load->running)
+    {
+        if (write(fd, block, sizeof(block)) != sizeof(block))
+        {
+            printf("Could not write the IO load file!\n");
+            break;
+        }
+        fsync(fd);
+
+        if (++written == LATENCY_IO_BLOCKS)
+        {
+            lseek(fd, 0, SEEK_SET);
+            written = 0;
+        }
+    }
+
+    close(fd);
+
+    return NULL;
+}
+
+/**
+ * Start the load threads.
+ *
+ * @param[in]  load         The load to start.
+ * @param[in]  cpuThreads   Number of threads that spin on the CPU.
+ * @param[in]  ioThreads    Number of threads that write and sync a temporary file.
+ *
+ * @return the configuration status.
+ */
+int32_t Latency_StartLoad(Latency_Load* load, uint32_t cpuThreads, uint32_t ioThreads)
+{
+    uint32_t i;
+    int status;
+
+    memset(load, 0, sizeof(Latency_Load));
+
+    if (cpuThreads > LATENCY_MAX_LOAD || ioThreads > LATENCY_MAX_LOAD)
+    {
+        printf("At most %d CPU and %d IO load threads are supported.\n", LATENCY_MAX_LOAD, LATENCY_MAX_LOAD);
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    load->cpuThreads = cpuThreads;
+    load->ioThreads  = ioThreads;
+    load->running    = NiFpga_True;
+
+    for (i = 0; i < cpuThreads + ioThreads; ++i)
+    {
+        loadThread[i].load  = load;
+        loadThread[i].index = i;
+
+        status = pthread_create(&load->thread[i],
+                                NULL,
+                                (i < cpuThreads) ? Latency_CpuThread : Latency_IoThread,
+                                &loadThread[i]);
+        if (status != 0)
+        {
+            printf("Failed to create a load thread!\n");
+            Latency_StopLoad(load);
+            return status;
+        }
+        ++load->threadCount;
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Stop the load threads and wait for them to end.
+ *
+ * @param[in]  load   The load to stop.
+ */
+void Latency_StopLoad(Latency_Load* load)
+{
+    uint32_t i;
+
+    load->running = NiFpga_False;
+
+    for (i = 0; i < load->threadCount; ++i)
+    {
+        pthread_join(load->thread[i], NULL);
+    }
+
+    load->threadCount = 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * IrqLatency.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments.
+ * All rights reserved.
+ */
+
+#ifndef IrqLatency_h_
+#define IrqLatency_h_
+
+#include <stdio.h>
+#include <pthread.h>
+#include "NiELVISIIIv10.h"
+
+// Number of 1 us histogram bins. The last bin also counts all longer latencies.
+#if !defined(LATENCY_BINS)
+#define LATENCY_BINS        10000
+#endif
+
+// Maximum number of CPU load threads and of IO load threads.
+#define LATENCY_MAX_LOAD    16
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Distribution of a latency, in 1 us bins.
+typedef struct
+{
+    uint32_t bin[LATENCY_BINS];   // Number of samples in each microsecond
+    uint32_t count;               // Number of samples
+    uint64_t sum;                 // Sum of the samples, in nanoseconds
+    double   sumSquares;          // Sum of the squared samples, in square nanoseconds
+    uint64_t min;                 // Shortest sample, in nanoseconds
+    uint64_t max;                 // Longest sample, in nanoseconds
+} Latency_Histogram;
+
+// Threads that load the CPU and the file system while the latency is measured.
+typedef struct
+{
+    pthread_t thread[2 * LATENCY_MAX_LOAD];
+    uint32_t threadCount;
+    uint32_t cpuThreads;          // Threads that spin on the CPU
+    uint32_t ioThreads;           // Threads that write and sync a temporary file
+    volatile NiFpga_Bool running; // Cleared to stop the threads
+} Latency_Load;
+
+// Get the CLOCK_MONOTONIC time in nanoseconds.
+uint64_t Latency_Now(void);
+
+// Empty a histogram.
+void Latency_InitHistogram(Latency_Histogram* histogram);
+
+// Add a sample to a histogram.
+void Latency_AddSample(Latency_Histogram* histogram, uint64_t latency);
+
+// Get the latency below which a percentage of the samples are.
+uint64_t Latency_Percentile(const Latency_Histogram* histogram, double percent);
+
+// Get the standard deviation of the samples.
+double Latency_StandardDeviation(const Latency_Histogram* histogram);
+
+// Print the percentiles of a histogram to the console.
+void Latency_PrintHistogram(const char* name, const Latency_Histogram* histogram);
+
+// Write the percentiles and the non-empty bins of a histogram as a JSON object.
+void Latency_WriteJson(FILE* file, const char* name, const Latency_Histogram* histogram);
+
+// Start the load threads.
+int32_t Latency_StartLoad(Latency_Load* load, uint32_t cpuThreads, uint32_t ioThreads);
+
+// Stop the load threads.
+void Latency_StopLoad(Latency_Load* load);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // IrqLatency_h_
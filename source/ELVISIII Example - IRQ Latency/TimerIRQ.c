@@ -0,0 +1,189 @@
+/**
+ * Configuration for Timer Interrupt Request (IRQ)
+ *
+ * Copyright (c) 2018,
+ * National Instruments.
+ * All rights reserved.
+ */
+#include <stdio.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "TimerIRQ.h"
+
+/*
+ * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
+ * this file. The variable is actually defined in NiELVISIIIv10.c.
+ *
+ * This removes the need to pass the NiELVISIIIv10_session around to every function and
+ * only has to be declared when it is being used.
+ */
+extern NiFpga_Session NiELVISIIIv10_session;
+
+// Initialize the register addresses of TimerIRQ.
+ELVISIII_IrqTimer IrqTimer = {IRQTIMERREAD, IRQTIMERWRITE, IRQTIMERSETTIME, Irq_Timer_0};
+
+/**
+ * Reserve the interrupt from FPGA and configure Timer IRQ.
+ *
+ * @param[in]  irqChannel   A structure containing the registers and settings for timer IRQ IO to modify.
+ * @param[in]  irqContext   IRQ context under which you reserve IRQ.
+ * @param[in]  timeout      The time, in microseconds, after which the IRQ occurs.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_RegisterTimerIrq(ELVISIII_IrqTimer* irqChannel,
+                             NiFpga_IrqContext* irqContext,
+                             uint32_t           timeout)
+{
+    int32_t status;
+
+    // Reserve the IRQ number and channel value in the resource list. The reservation is
+    // atomic, so it fails if another thread already reserved either of them.
+    // If it fails, return the configuration status and print an error message.
+    status = Irq_AddReserved(irqChannel->timerChannel, TIMERIRQNO);
+    if (status == NiELVISIIIv10_Status_IrqNumberNotUsable || status == NiELVISIIIv10_Status_IrqChannelNotUsable)
+    {
+        printf("You have already registered the only timer interrupt.\n");
+        return status;
+    }
+
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once the IRQ
+    // is reserved, so an IRQ that cannot be registered never holds a context. IRQ contexts
+    // are single-threaded; only one thread can wait with a particular context at
+    // any given time. The context must be returned to the pool later.
+    status = Irq_AcquireContext(irqContext);
+
+    // Check if there was an error when you took the IRQ context.
+    // If there was an error, release the IRQ, print an error message to stdout and return the configuration status.
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        Irq_RemoveReserved(TIMERIRQNO);
+        printf("A required NiFpga_IrqContext was not acquired.\n");
+        return status;
+    }
+
+    // Write the value to the TIMERWRITE register.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = NiFpga_WriteU32(NiELVISIIIv10_session, irqChannel->timerWrite, timeout);
+
+    // Check if there was an error when you reserved the IRQ.
+    // If there was an error, print an error message to stdout and return the configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to TIMERWRITE Register!");
+
+    // Write the value to the TIMERSETTIME Register.
+    status = NiFpga_WriteBool(NiELVISIIIv10_session, irqChannel->timerSet, NiFpga_True);
+
+    // Check if there was an error when you reserved the IRQ.
+    // If there was an error, print an error message to stdout and return the configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to TIMERSETTIME Register!");
+
+    return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Unreserve the interrupt from FPGA and disable timer IRQ IO.
+ *
+ * @param[in]  irqChannel  A structure containing the registers and settings for timer IRQ IO to modify.
+ * @param[in]  irqContext  IRQ context under which you unreserve the IRQ.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_UnregisterTimerIrq(ELVISIII_IrqTimer* irqChannel,
+                               NiFpga_IrqContext  irqContext)
+{
+    int32_t status;
+
+    // Check if the specified IRQ resource is registered.
+    status = Irq_CheckReserved(irqChannel->timerChannel, TIMERIRQNO);
+    if (status == NiELVISIIIv10_Status_Success)
+    {
+        // Did not find the resource in the list.
+        printf("You didn't register an interrupt with this IRQ number.\n");
+        return NiELVISIIIv10_Status_Success;
+    }
+
+    // Write the value to the IRQTIMERSETTIME Register.
+    status = NiFpga_WriteU32(NiELVISIIIv10_session, irqChannel->timerWrite, 0);
+    status = NiFpga_WriteBool(NiELVISIIIv10_session, irqChannel->timerSet, NiFpga_True);
+
+    // Check if there was an error writing to the IRQTIMERSETTIME Register.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to IRQTIMERSETTIME register!");
+
+    // Delete the reserved resource in the list.
+    status = Irq_RemoveReserved(TIMERIRQNO);
+
+    // Check if there was an error releasing the resource from list.
+    // If there was an error then print an error message to stdout.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not release the IRQ resource!");
+
+    // Return the IRQ context obtained from Irq_AcquireContext() to the pool.
+    // The returned NiFpga_Status value is stored for error checking.
+    status = Irq_ReleaseContext(irqContext);
+
+    // Check if there was an error when unreserve an IRQ.
+    // If there was an error then print an error message to stdout and return configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
+
+    return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Trigger the registered timer IRQ again.
+ * The timer IRQ occurs only once after it is set, so call this function after
+ * every IRQ to trigger it repeatedly without reserving the IRQ again.
+ *
+ * @param[in]  irqChannel   A structure containing the registers and settings for timer IRQ IO to modify.
+ * @param[in]  timeout      The time, in microseconds, after which the IRQ occurs.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_ArmTimerIrq(ELVISIII_IrqTimer* irqChannel,
+                        uint32_t           timeout)
+{
+    int32_t status;
+
+    // Write the value to the TIMERWRITE register.
+    status = NiFpga_WriteU32(NiELVISIIIv10_session, irqChannel->timerWrite, timeout);
+
+    // Check if there was an error writing to the TIMERWRITE register.
+    // If there was an error, print an error message to stdout and return the configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to TIMERWRITE Register!");
+
+    // Write the value to the TIMERSETTIME Register.
+    status = NiFpga_WriteBool(NiELVISIIIv10_session, irqChannel->timerSet, NiFpga_True);
+
+    // Check if there was an error writing to the TIMERSETTIME register.
+    // If there was an error, print an error message to stdout and return the configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to TIMERSETTIME Register!");
+
+    return NiELVISIIIv10_Status_Success;
+}
+
+/**
+ * Read the FPGA timer.
+ *
+ * @param[in]  irqChannel   A structure containing the registers and settings for timer IRQ IO to read.
+ * @param[out] time         The timer value, in microseconds.
+ *
+ * @return the configuration status.
+ */
+int32_t Irq_ReadTimer(ELVISIII_IrqTimer* irqChannel,
+                      uint32_t*          time)
+{
+    int32_t status;
+
+    // Read the value of the TIMERREAD register.
+    status = NiFpga_ReadU32(NiELVISIIIv10_session, irqChannel->timerRead, time);
+
+    // Check if there was an error reading from the TIMERREAD register.
+    // If there was an error, print an error message to stdout and return the configuration status.
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not read from TIMERREAD Register!");
+
+    return NiELVISIIIv10_Status_Success;
+}
@@ -0,0 +1,322 @@
+/**
+ * Copyright (c) 2018,
+ * National Instruments.
+ * All rights reserved.
+ *
+ * Overview:
+ * Measures how long a timer IRQ takes to reach user code. The timer IRQ is
+ * triggered repeatedly. For every IRQ, the time from the expected IRQ to the
+ * return of Irq_Wait is measured twice: with CLOCK_MONOTONIC and with the
+ * FPGA timer (IRQTIMERREAD). The latency and the jitter (the change of the
+ * latency from one IRQ to the next) are collected in 1 us histograms, while
+ * optional threads load the CPU and the file system.
+ *
+ * Instructions:
+ * Run this program and observe the console. The options are:
+ *   -n <samples>    Number of IRQs to measure.
+ *   -i <interval>   Time between triggering the timer and the IRQ, in us.
+ *   -c <threads>    Number of CPU load threads.
+ *   -o <threads>    Number of IO load threads.
+ *   -p <priority>   SCHED_FIFO priority of the measuring thread, 0 for SCHED_OTHER.
+ *   -a <cpu>        CPU to run the measuring thread on.
+ *   -s <file>       Write the latencies of every IRQ to a CSV file.
+ *   -j <file>       Write the histograms to a JSON file.
+ *
+ * Output:
+ * The min, p50, p99, p99.9, max and standard deviation of each histogram are
+ * shown in the console, with the page faults of the measuring thread and the
+ * IRQs that came later than one interval (overruns). The CSV file has one row per IRQ. The JSON file has the
+ * configuration, the percentiles and the non-empty bins of each histogram.
+ *
+ * Note:
+ * The Eclipse project defines the preprocessor symbol for the NI ELVIS III.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ThreadConfig.h"
+#include "TimerIRQ.h"
+#include "IrqLatency.h"
+
+#if !defined(LatencySamples)
+#define LatencySamples        10000   // Number of IRQs to measure
+#endif
+
+#if !defined(LatencyInterval)
+#define LatencyInterval       1000    // Time between triggering the timer and the IRQ, in microseconds
+#endif
+
+#if !defined(LatencyWarmup)
+#define LatencyWarmup         10      // Number of IRQs that are not measured
+#endif
+
+#if !defined(LatencyMissed)
+#define LatencyMissed         1000000 // How long to wait for an IRQ after it is expected, in microseconds
+#endif
+
+extern ELVISIII_IrqTimer IrqTimer;
+
+int main(int argc, char **argv)
+{
+    int32_t status;
+
+    NiFpga_IrqContext irqContext;
+    NiFpga_Bool waiting = NiFpga_True;
+
+    Latency_Histogram hostLatency;
+    Latency_Histogram fpgaLatency;
+    Latency_Histogram jitter;
+    Latency_Load load;
+    Thread_Config threadConfig;
+    Thread_Stats threadStats;
+
+    uint32_t samples = LatencySamples;
+    uint32_t interval = LatencyInterval;
+    uint32_t cpuThreads = 0;
+    uint32_t ioThreads = 0;
+    int priority = THREAD_IRQ_PRIORITY;
+    int cpu = THREAD_ANY_CPU;
+    const char* csvPath = NULL;
+    const char* jsonPath = NULL;
+    FILE* csv = NULL;
+    FILE* json = NULL;
+
+    uint32_t missed = 0;
+    NiFpga_Bool late = NiFpga_False;
+    uint64_t previous = 0;
+    uint32_t i;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:i:c:o:p:a:s:j:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n': samples = strtoul(optarg, NULL, 0); break;
+        case 'i': interval = strtoul(optarg, NULL, 0); break;
+        case 'c': cpuThreads = strtoul(optarg, NULL, 0); break;
+        case 'o': ioThreads = strtoul(optarg, NULL, 0); break;
+        case 'p': priority = strtol(optarg, NULL, 0); break;
+        case 'a': cpu = strtol(optarg, NULL, 0); break;
+        case 's': csvPath = optarg; break;
+        case 'j': jsonPath = optarg; break;
+        default:
+            printf("Usage: %s [-n samples] [-i interval_us] [-c cpu_threads] [-o io_threads] [-p priority] [-a cpu] [-s file.csv] [-j file.json]\n", argv[0]);
+            return NiFpga_Status_InvalidParameter;
+        }
+    }
+
+    printf("IRQ Latency:\n");
+    printf("%u IRQs, %u us interval, %u CPU load threads, %u IO load threads, priority %d\n",
+           samples, interval, cpuThreads, ioThreads, priority);
+
+    if (csvPath != NULL)
+    {
+        csv = fopen(csvPath, "w");
+        if (csv == NULL)
+        {
+            printf("Could not create %s.\n", csvPath);
+            return NiFpga_Status_InvalidParameter;
+        }
+        fprintf(csv, "irq,host_latency_ns,fpga_latency_ns,jitter_ns\n");
+    }
+
+    // Open the NiELVISIIIv10 NiFpga Session.
+    // You must use this function before using all the other functions.
+    // After you finish using this function, the NI NiELVISIIIv10 target is ready to be used.
+    status = NiELVISIIIv10_Open();
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        if (csv != NULL)
+        {
+            fclose(csv);
+        }
+        return status;
+    }
+
+    // Register the timer IRQ once. Every measurement triggers it again with Irq_ArmTimerIrq().
+    status = Irq_RegisterTimerIrq(&IrqTimer, &irqContext, interval);
+
+    // Terminate the process if it is unsuccessful.
+    if (status != NiELVISIIIv10_Status_Success)
+    {
+        printf("CONFIGURE ERROR: %d, Configuration of Timer IRQ failed.", status);
+        if (csv != NULL)
+        {
+            fclose(csv);
+        }
+        NiELVISIIIv10_Close();
+        return status;
+    }
+
+    // Wait for the IRQ triggered by the registration, so every measurement starts idle.
+    {
+        uint32_t irqAssert = 0;
+        Irq_Wait(irqContext, TIMERIRQNO, &irqAssert, &waiting);
+        Irq_Acknowledge(irqAssert);
+    }
+
+    Latency_InitHistogram(&hostLatency);
+    Latency_InitHistogram(&fpgaLatency);
+    Latency_InitHistogram(&jitter);
+
+    // Measure from a real-time thread whose memory is locked, so the result
+    // shows the latency of the system rather than of the page cache.
+    Thread_LockMemory();
+    Thread_InitConfig(&threadConfig, priority);
+    if (priority == 0)
+    {
+        threadConfig.policy = SCHED_OTHER;
+    }
+    threadConfig.cpu = cpu;
+    threadConfig.stats = &threadStats;
+    Thread_ConfigureCurrent(&threadConfig);
+
+    status = Latency_StartLoad(&load, cpuThreads, ioThreads);
+    if (status != NiELVISIIIv10_Status_Success)
+    {
+        Irq_UnregisterTimerIrq(&IrqTimer, irqContext);
+        if (csv != NULL)
+        {
+            fclose(csv);
+        }
+        NiELVISIIIv10_Close();
+        return status;
+    }
+
+    for (i = 0; i < LatencyWarmup + samples; ++i)
+    {
+        uint32_t irqAssert = 0;
+        uint32_t fpgaStart;
+        uint32_t fpgaWake;
+        uint64_t hostStart;
+        uint64_t hostWake;
+        uint64_t host;
+        uint64_t fpga;
+        uint64_t change = 0;
+
+        // Read both clocks right before the timer is triggered.
+        Irq_ReadTimer(&IrqTimer, &fpgaStart);
+        hostStart = Latency_Now();
+        Irq_ArmTimerIrq(&IrqTimer, interval);
+
+        // Irq_Wait() returns every 100 ms without an IRQ, so wait again until the IRQ
+        // is asserted, or give up if it is too late.
+        do
+        {
+            Irq_Wait(irqContext, TIMERIRQNO, &irqAssert, &waiting);
+            hostWake = Latency_Now();
+        } while (!(irqAssert & (1 << TIMERIRQNO))
+                 && hostWake - hostStart < ((uint64_t)interval + LatencyMissed) * 1000);
+
+        // The missed IRQ may still be asserted, or be asserted right after the
+        // timer is armed again. Acknowledge it and drop the next sample, which
+        // could measure the late IRQ instead of its own.
+        if (!(irqAssert & (1 << TIMERIRQNO)))
+        {
+            Irq_Acknowledge(1 << TIMERIRQNO);
+            ++missed;
+            late = NiFpga_True;
+            continue;
+        }
+
+        Irq_ReadTimer(&IrqTimer, &fpgaWake);
+
+        // Acknowledge the IRQ(s) when assertion is done.
+        Irq_Acknowledge(irqAssert);
+
+        if (i < LatencyWarmup || late)
+        {
+            late = NiFpga_False;
+            continue;
+        }
+
+        // The latency is the time after the expected IRQ. The FPGA timer counts
+        // microseconds and wraps around, so subtract it as an unsigned 32-bit value.
+        host = hostWake - hostStart;
+        host = (host > (uint64_t)interval * 1000) ? host - (uint64_t)interval * 1000 : 0;
+        fpga = (uint32_t)(fpgaWake - fpgaStart);
+        fpga = (fpga > interval) ? (fpga - interval) * 1000 : 0;
+
+        Latency_AddSample(&hostLatency, host);
+        Thread_CheckOverrun(&threadStats, host, (uint64_t)interval * 1000);
+        Latency_AddSample(&fpgaLatency, fpga);
+        if (hostLatency.count > 1)
+        {
+            change = (host > previous) ? host - previous : previous - host;
+            Latency_AddSample(&jitter, change);
+        }
+
+        if (csv != NULL)
+        {
+            fprintf(csv, "%u,%llu,%llu,%llu\n",
+                    i - LatencyWarmup,
+                    (unsigned long long)host,
+                    (unsigned long long)fpga,
+                    (unsigned long long)change);
+        }
+
+        previous = host;
+    }
+
+    Latency_StopLoad(&load);
+    Thread_UpdateStats(&threadStats);
+
+    printf("%u IRQs measured, %u missed\n", hostLatency.count, missed);
+    Latency_PrintHistogram("host", &hostLatency);
+    Latency_PrintHistogram("fpga", &fpgaLatency);
+    Latency_PrintHistogram("jitter", &jitter);
+    Thread_PrintStats("measuring thread", &threadStats);
+
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+
+    if (jsonPath != NULL)
+    {
+        json = fopen(jsonPath, "w");
+        if (json == NULL)
+        {
+            printf("Could not create %s.\n", jsonPath);
+        }
+        else
+        {
+            fprintf(json, "{\n");
+            fprintf(json, "  \"samples\": %u,\n", samples);
+            fprintf(json, "  \"interval_us\": %u,\n", interval);
+            fprintf(json, "  \"cpu_threads\": %u,\n", cpuThreads);
+            fprintf(json, "  \"io_threads\": %u,\n", ioThreads);
+            fprintf(json, "  \"priority\": %d,\n", priority);
+            fprintf(json, "  \"cpu\": %d,\n", cpu);
+            fprintf(json, "  \"minor_faults\": %ld,\n", threadStats.minorFaults);
+            fprintf(json, "  \"major_faults\": %ld,\n", threadStats.majorFaults);
+            fprintf(json, "  \"overruns\": %u,\n", threadStats.overruns);
+            fprintf(json, "  \"missed\": %u,\n", missed);
+            Latency_WriteJson(json, "host_latency", &hostLatency);
+            fprintf(json, ",\n");
+            Latency_WriteJson(json, "fpga_latency", &fpgaLatency);
+            fprintf(json, ",\n");
+            Latency_WriteJson(json, "jitter", &jitter);
+            fprintf(json, "\n}\n");
+            fclose(json);
+        }
+    }
+
+    // Disable timer interrupt, so you can configure this I/O next time.
+    // Every IrqConfigure() function should have its corresponding clear function,
+    // and their parameters should also match.
+    status = Irq_UnregisterTimerIrq(&IrqTimer, irqContext);
+    if (status != NiELVISIIIv10_Status_Success)
+    {
+        printf("CONFIGURE ERROR: %d\n", status);
+        printf("Clear configuration of Timer IRQ failed.");
+        return status;
+    }
+
+    // Close the NiELVISIIIv10 NiFpga Session.
+    // You must use this function after using all the other functions.
+    status = NiELVISIIIv10_Close();
+
+    // Returns 0 if successful.
+    return status;
+}
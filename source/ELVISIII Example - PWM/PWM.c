@@ -15,6 +15,7 @@
  */
 #include "NiELVISIIIv10.h"
 #include "PWM.h"
+#include "PinMux.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -228,36 +229,15 @@ uint16_t Pwm_Counter(ELVISIII_Pwm* bank, Pwm_Channel channel)
  *
  * @param[in]  bank        A struct containing the registers for one connecter.
  * @param[in]  channel     Enum containing 20 kinds of PWM channels.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the channel is owned by a committed plan.
  */
-void Pwm_Select(ELVISIII_Pwm* bank, Pwm_Channel channel)
+int32_t Pwm_Select(ELVISIII_Pwm* bank, Pwm_Channel channel)
 {
-    NiFpga_Status status;
-    uint64_t selectReg;
-
     // PWM outputs are on pins shared with other onboard devices.
     // To output on a physical pin, select the PWM on the appropriate SELECT Register.
-    // See the MUX example for simplified code to enable-disable onboard devices.
-    // Read the value of the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
-
-    // Clear bits of the SYSSELECTA/SYSSELECTB register. This is
-    // done so that the correct value can be set later on.
-    selectReg = selectReg & (~((uint64_t)0b11 << (channel * 2)));
-
-    // Set bit2 of the SYSSELECTA/SYSSELECTB register to enable Encoder functionality.
-    // The functionality of the bit is specified in the documentation.
-    selectReg = selectReg | ((uint64_t)0b01 << (channel * 2));
-
-    // Write the new value to the SYSSELECTA/SYSSELECTB Register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
-
-    // Check if there was an error reading from the System Select Register.
-    // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not Write to the System Select Register!");
-
-    return;
+    // Set 0b01 to the related 2 bits of the SYSSELECTA/SYSSELECTB register to enable PWM functionality.
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the channel is not already selected as PWM.
+    return PinMux_Select(bank->sel, channel, 1, PinMux_Pwm);
 }
@@ -107,7 +107,7 @@ void Pwm_CounterCompare(ELVISIII_Pwm* bank, Pwm_Channel channel, uint16_t counte
 uint16_t Pwm_Counter(ELVISIII_Pwm* bank, Pwm_Channel channel);
 
 // Write the value to the System Select Register.
-void Pwm_Select(ELVISIII_Pwm* bank, Pwm_Channel channel);
+int32_t Pwm_Select(ELVISIII_Pwm* bank, Pwm_Channel channel);
 
 #if NiFpga_Cpp
 }
@@ -66,7 +66,13 @@ int main(int argc, char **argv)
     Pwm_CounterCompare(&bank_A, Pwm_Channel0, 250);
 
     // Write the value to PWM channel 0 on bank A.
-    Pwm_Select(&bank_A, Pwm_Channel0);
+    // Stop if the channel is owned by another function.
+    status = Pwm_Select(&bank_A, Pwm_Channel0);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Print the counter value.
     printf("%d\n", Pwm_Counter(&bank_A, Pwm_Channel0));
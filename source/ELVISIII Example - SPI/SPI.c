@@ -7,6 +7,8 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 /**
@@ -16,6 +18,8 @@
  */
 #include "NiELVISIIIv10.h"
 #include "SPI.h"
+#include "PinMux.h"
+#include "IRQConfigure.h"
 
 /*
  * Declare the ELVIS III NiFpga_Session so that it can be used by any function in
@@ -27,15 +31,15 @@
 extern NiFpga_Session NiELVISIIIv10_session;
 
 // Initialize the register addresses of SPI in bank A.
-ELVISIII_Spi spi_bank_A = {SPIACNFG, SPIACNT, SPIAGO, SPIASTAT, SPIADATO, SPIADATI, SYSSELECTA};
+ELVISIII_Spi spi_bank_A = {SPIACNFG, SPIACNT, SPIAGO, SPIASTAT, SPIADATO, SPIADATI, SYSSELECTA, NULL};
 
 // Initialize the register addresses of SPI in bank B.
-ELVISIII_Spi spi_bank_B = {SPIBCNFG, SPIBCNT, SPIBGO, SPIBSTAT, SPIBDATO, SPIBDATI, SYSSELECTB};
+ELVISIII_Spi spi_bank_B = {SPIBCNFG, SPIBCNT, SPIBGO, SPIBSTAT, SPIBDATO, SPIBDATI, SYSSELECTB, NULL};
 
 // Resources for the new thread.
 typedef struct
 {
-    NiFpga_IrqContext irqContext;      // IRQ context reserved by Irq_ReserveContext()
+    NiFpga_IrqContext irqContext;      // IRQ context taken by Irq_AcquireContext()
     NiFpga_Bool       irqThreadRdy;    // IRQ thread ready flag
     uint8_t           irqNumber;       // IRQ number value
 } ThreadResource;
@@ -142,19 +146,28 @@ uint16_t Spi_Transmit(ELVISIII_Spi* bank, uint16_t dataOut)
         irqThread.irqNumber = 26;
     }
     irqThread.irqThreadRdy = NiFpga_True;
-    status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, &irqThread.irqContext);
-    NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
-    uint32_t irqAssert = 0;
-    status = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
-                               irqThread.irqContext,
-                               1 << irqThread.irqNumber,
-                               1000,  			/* break into infinite 100ms timeouts */
-                               &irqAssert,
-                               NULL);
-	// If an IRQ was asserted.
-    if (irqAssert & (1 << irqThread.irqNumber))
+
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open(), so that
+    // no context is reserved in the driver for every transfer.
+    status = Irq_AcquireContext(&irqThread.irqContext);
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not acquired.");
+    if (status == NiELVISIIIv10_Status_Success)
     {
-        Irq_Acknowledge(irqAssert);
+        uint32_t irqAssert = 0;
+        status = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
+                                   irqThread.irqContext,
+                                   1 << irqThread.irqNumber,
+                                   1000,  			/* break into infinite 100ms timeouts */
+                                   &irqAssert,
+                                   NULL);
+        // If an IRQ was asserted.
+        if (irqAssert & (1 << irqThread.irqNumber))
+        {
+            Irq_Acknowledge(irqAssert);
+        }
+
+        // Return the IRQ context to the pool.
+        Irq_ReleaseContext(irqThread.irqContext);
     }
 
     // Get the value of the data Input Register.
@@ -170,34 +183,192 @@ uint16_t Spi_Transmit(ELVISIII_Spi* bank, uint16_t dataOut)
 }
 
 /**
- * Write the value to the System Select Register.
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t Spi_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Transmits a buffer of words back to back.
  *
- * @param[in]  bank      A struct containing the registers on the SPI channel to modify.
+ * The IRQ context is taken from the pool on the first call and kept in the bank
+ * until Spi_Close, so the words are not slowed down by the pool. Each word is
+ * written to the Data Out Register only after the previous word is complete.
+ * If a word does not complete within SPI_TRANSFER_TIMEOUT, the transfer stops
+ * there and the words after it in dataIn are not written.
+ *
+ * @param[in]  bank        A struct containing the registers on the SPI channel to modify.
+ * @param[in]  dataOut     The words to output, or NULL to output zeros.
+ * @param[out] dataIn      The words received, or NULL to discard them.
+ * @param[in]  count       The number of words.
+ * @param[out] timing      The timing of the transfer, or NULL.
+ *
+ * @return the transfer status, or NiELVISIIIv10_Status_SpiTimeout if a word did not complete.
  */
-void Spi_Select(ELVISIII_Spi* bank)
+int32_t Spi_TransferBuffer(ELVISIII_Spi*   bank,
+                           const uint16_t* dataOut,
+                           uint16_t*       dataIn,
+                           size_t          count,
+                           Spi_Timing*     timing)
 {
     NiFpga_Status status;
-    uint64_t selectReg;
+    NiFpga_Status waitStatus;
+    Spi_Timing localTiming;
+    uint32_t irqMask;
+    uint32_t irqAssert;
+    NiFpga_Bool timedOut;
+    uint64_t start;
+    uint64_t wordStart;
+    uint64_t previousStart = 0;
+    size_t i;
+
+    if (timing == NULL)
+    {
+        timing = &localTiming;
+    }
+    memset(timing, 0, sizeof(Spi_Timing));
 
-    // SPI connections are on pins shared with other onboard devices. To use
-    // on a physical pin, select the SPI on the appropriate SELECT register.
-    // Read the value of the SYSSELECTA register.
-    status = NiFpga_ReadU64(NiELVISIIIv10_session, bank->sel, &selectReg);
+    if (count == 0)
+    {
+        return NiELVISIIIv10_Status_Success;
+    }
 
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not read from the System Select Register!");
+    // Bank A asserts IRQ 27 and bank B asserts IRQ 26 when a word is complete.
+    irqMask = 1 << ((bank->cnfg == spi_bank_A.cnfg) ? 27 : 26);
 
-    // No need to clear the value of the bits in the SYSSELECTA/SYSSELECTB register
-    // because SPI select is all 1.
-    // Set bit10:15 of the SYSSELECTA/SYSSELECTB register to enable SPI functionality.
-    // The functionality of the bit is specified in the documentation.
-    selectReg = selectReg | (uint64_t)0b111111 << 10;
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once,
+    // and keep it for the next transfers.
+    if (bank->irqContext == NULL)
+    {
+        status = Irq_AcquireContext(&bank->irqContext);
+        if (NiFpga_IsError(status))
+        {
+            NiELVISIIIv10_ReturnIfNotSuccess(status, "A required NiFpga_IrqContext was not acquired.");
+            bank->irqContext = NULL;
+            return status;
+        }
+    }
+
+    // Clear a completion left asserted by an earlier transfer, so the first wait
+    // does not return before the first word is complete.
+    status = NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, irqMask);
 
-    // Write the updated value of the SYSSELECTA register.
-    status = NiFpga_WriteU64(NiELVISIIIv10_session, bank->sel, selectReg);
+    start = Spi_Now();
+    for (i = 0; i < count && !NiFpga_IsError(status); ++i)
+    {
+        wordStart = Spi_Now();
+
+        // Load word i and start its transfer.
+        NiFpga_MergeStatus(&status, NiFpga_WriteU16(NiELVISIIIv10_session, bank->dato, (dataOut != NULL) ? dataOut[i] : 0));
+        NiFpga_MergeStatus(&status, NiFpga_WriteBool(NiELVISIIIv10_session, bank->go, NiFpga_True));
+        if (NiFpga_IsError(status))
+        {
+            break;
+        }
+
+        // Wait until word i is complete.
+        irqAssert = 0;
+        timedOut = NiFpga_False;
+        waitStatus = NiFpga_WaitOnIrqs(NiELVISIIIv10_session,
+                                       bank->irqContext,
+                                       irqMask,
+                                       SPI_TRANSFER_TIMEOUT,
+                                       &irqAssert,
+                                       &timedOut);
+        if (NiFpga_IsError(waitStatus))
+        {
+            NiFpga_MergeStatus(&status, waitStatus);
+            break;
+        }
+        if (!(irqAssert & irqMask))
+        {
+            // The Data In Register may hold a word that is only partly shifted in,
+            // so it is not read and the transfer stops here.
+            ++timing->timeouts;
+            status = NiELVISIIIv10_Status_SpiTimeout;
+            break;
+        }
+        NiFpga_MergeStatus(&status, NiFpga_AcknowledgeIrqs(NiELVISIIIv10_session, irqMask));
+
+        // The Data In Register is valid once the word is complete.
+        if (dataIn != NULL)
+        {
+            NiFpga_MergeStatus(&status, NiFpga_ReadU16(NiELVISIIIv10_session, bank->dati, &dataIn[i]));
+        }
+
+        // Record the time between the starts of two words.
+        if (i > 0)
+        {
+            uint64_t interval = wordStart - previousStart;
+
+            if (timing->minWord == 0 || interval < timing->minWord)
+            {
+                timing->minWord = interval;
+            }
+            if (interval > timing->maxWord)
+            {
+                timing->maxWord = interval;
+            }
+        }
+        previousStart = wordStart;
+        ++timing->words;
+    }
 
-    // Check if there was an error reading from the System Select Register.
+    timing->total = Spi_Now() - start;
+    if (timing->words > 0)
+    {
+        timing->meanWord = timing->total / timing->words;
+    }
+    if (timing->words == 1)
+    {
+        timing->minWord = timing->total;
+        timing->maxWord = timing->total;
+    }
+
+    // Check if there was an error transferring the buffer.
     // If there was an error then print an error message to stdout.
-    NiELVISIIIv10_ReturnValueIfNotSuccess(status, status, "Could not write to the System Select Register!");
+    NiELVISIIIv10_ReturnIfNotSuccess(status, "Could not transfer the SPI buffer!");
+
+    return status;
+}
+
+/**
+ * Return the IRQ context kept by Spi_TransferBuffer to the pool.
+ * Call it before NiELVISIIIv10_Close.
+ *
+ * @param[in]  bank      A struct containing the registers on the SPI channel.
+ */
+void Spi_Close(ELVISIII_Spi* bank)
+{
+    if (bank->irqContext != NULL)
+    {
+        Irq_ReleaseContext(bank->irqContext);
+        bank->irqContext = NULL;
+    }
 
     return;
 }
+
+/**
+ * Write the value to the System Select Register.
+ *
+ * @param[in]  bank      A struct containing the registers on the SPI channel to modify.
+ *
+ * @return the configure status, NiELVISIIIv10_Status_PinMuxConflict if the pins are owned by a committed plan.
+ */
+int32_t Spi_Select(ELVISIII_Spi* bank)
+{
+    // SPI connections are on pins shared with other onboard devices. To use
+    // on a physical pin, select the SPI on the appropriate SELECT register.
+    // Set bit10:15 (DIO5:7) of the SYSSELECTA/SYSSELECTB register to enable SPI functionality.
+    // The functionality of the bit is specified in the documentation.
+    // The pin multiplexer keeps a copy of the SYSSELECTA/SYSSELECTB Register, so the register
+    // is only written when the pins are not already selected as SPI.
+    return PinMux_Select(bank->sel, 5, 3, PinMux_SpiI2c);
+}
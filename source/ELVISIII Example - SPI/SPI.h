@@ -9,8 +9,16 @@
 #ifndef SPI_h_
 #define SPI_h_
 
+#include <stddef.h>
 #include "NiELVISIIIv10.h"
 
+// A word of Spi_TransferBuffer did not complete within SPI_TRANSFER_TIMEOUT.
+static const int32_t NiELVISIIIv10_Status_SpiTimeout = -363032;
+
+#if !defined(SPI_TRANSFER_TIMEOUT)
+#define SPI_TRANSFER_TIMEOUT 1000   // How long Spi_TransferBuffer waits for one word, in milliseconds 
+#endif
+
 #if NiFpga_Cpp
 extern "C" {
 #endif
@@ -77,8 +85,21 @@ typedef struct
     uint32_t dato;  // SPI Data Out Register 
     uint32_t dati;  // SPI Data In Register 
     uint32_t sel;   // System Select Register 
+
+    NiFpga_IrqContext irqContext;   // IRQ context kept by Spi_TransferBuffer until Spi_Close, or NULL 
 } ELVISIII_Spi;
 
+// Timing of one Spi_TransferBuffer call, in nanoseconds.
+typedef struct
+{
+    uint64_t total;      // Time of the whole transfer 
+    uint64_t minWord;    // Shortest time between the starts of two words 
+    uint64_t maxWord;    // Longest time between the starts of two words 
+    uint64_t meanWord;   // Mean time per word 
+    size_t   words;      // Words transferred 
+    uint32_t timeouts;   // Words whose completion IRQ did not arrive in time 
+} Spi_Timing;
+
 // Sets the SPI configuration options.
 void Spi_Configure(ELVISIII_Spi* bank, Spi_ConfigureMask mask, Spi_ConfigureSettings settings);
 
@@ -88,8 +109,18 @@ void Spi_CounterMaximum(ELVISIII_Spi* bank, uint16_t counterMax);
 // Transmits data.
 uint16_t Spi_Transmit(ELVISIII_Spi* bank, uint16_t dataOut);
 
+// Transmits a buffer of words back to back.
+int32_t Spi_TransferBuffer(ELVISIII_Spi*   bank,
+                           const uint16_t* dataOut,
+                           uint16_t*       dataIn,
+                           size_t          count,
+                           Spi_Timing*     timing);
+
+// Return the IRQ context kept by Spi_TransferBuffer to the pool.
+void Spi_Close(ELVISIII_Spi* bank);
+
 // Write the value to the System Select Register.
-void Spi_Select(ELVISIII_Spi* bank);
+int32_t Spi_Select(ELVISIII_Spi* bank);
 
 #if NiFpga_Cpp
 }
@@ -0,0 +1,363 @@
+/**
+ * SPI devices with a register cache
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "SpiDevice.h"
+
+/**
+ * Find a register of a device by its address.
+ *
+ * @param[in]  info      The description of the device.
+ * @param[in]  address   The address of the register.
+ *
+ * @return the index of the register, or -1 if the device has no register at this address.
+ */
+static int32_t Spi_FindRegister(const Spi_DeviceInfo* info, uint8_t address)
+{
+    uint32_t i;
+
+    for (i = 0; i < info->registerCount; ++i)
+    {
+        if (info->registers[i].address == address)
+        {
+            return (int32_t)i;
+        }
+    }
+
+    printf("The SPI device has no register at address 0x%02X.\n", address);
+
+    return -1;
+}
+
+/**
+ * Fill a transaction with the settings and chip select of a device.
+ *
+ * @param[in]  device        The device.
+ * @param[in]  transaction   The transaction to fill.
+ * @param[in]  dataOut       The words to output.
+ * @param[in]  dataIn        The words received, or NULL.
+ * @param[in]  count         The number of words.
+ */
+static void Spi_DeviceTransaction(Spi_Device* device,
+                                  Spi_Transaction* transaction,
+                                  const uint16_t* dataOut,
+                                  uint16_t* dataIn,
+                                  size_t count)
+{
+    const Spi_DeviceInfo* info = device->info;
+
+    memset(transaction, 0, sizeof(Spi_Transaction));
+    transaction->settings   = info->settings;
+    transaction->counterMax = info->counterMax;
+    transaction->csBank     = info->csBank;
+    transaction->csChannel  = info->csChannel;
+    transaction->dataOut    = dataOut;
+    transaction->dataIn     = dataIn;
+    transaction->count      = count;
+}
+
+/**
+ * Attach a device to the queue of its bank and empty its cache.
+ * A device must only be used by one thread at a time.
+ *
+ * @param[in]  device   The device to open.
+ * @param[in]  info     The description of the device. It must stay valid while the device is used.
+ * @param[in]  queue    The running queue of the bank the device is connected to.
+ *
+ * @return the configuration status.
+ */
+int32_t Spi_OpenDevice(Spi_Device* device, const Spi_DeviceInfo* info, Spi_Queue* queue)
+{
+    uint32_t i;
+
+    // Every word carries one byte of a command or of a value.
+    if ((info->settings & Spi_FrameLength) != Spi_FrameSize8 || info->registerCount > SPI_DEVICE_REGISTERS)
+    {
+        printf("The SPI device must use 8 bit frames and have at most %d registers.\n", SPI_DEVICE_REGISTERS);
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    memset(device, 0, sizeof(Spi_Device));
+    device->info  = info;
+    device->queue = queue;
+
+    // Write-only registers cannot be read back, so they read as their reset
+    // value until they are written.
+    for (i = 0; i < info->registerCount; ++i)
+    {
+        if (info->registers[i].width != 8 && info->registers[i].width != 16)
+        {
+            printf("The SPI register at address 0x%02X must be 8 or 16 bits wide.\n", info->registers[i].address);
+            return NiFpga_Status_InvalidParameter;
+        }
+        device->value[i] = info->registers[i].reset;
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Read a register, from the cache when possible.
+ * Volatile registers are always read from the device. Other registers are read
+ * from the device the first time only.
+ *
+ * @param[in]  device    The device.
+ * @param[in]  address   The address of the register.
+ * @param[out] value     The value of the register.
+ *
+ * @return the transfer status.
+ */
+int32_t Spi_ReadRegister(Spi_Device* device, uint8_t address, uint16_t* value)
+{
+    const Spi_DeviceInfo* info = device->info;
+    const Spi_RegisterInfo* reg;
+    Spi_Transaction transaction;
+    uint16_t dataOut[3] = {0, 0, 0};
+    uint16_t dataIn[3];
+    uint64_t bit;
+    int32_t index;
+    int32_t status;
+    size_t bytes;
+
+    index = Spi_FindRegister(info, address);
+    if (index < 0)
+    {
+        return NiFpga_Status_InvalidParameter;
+    }
+    reg = &info->registers[index];
+    bit = (uint64_t)1 << index;
+
+    // Serve the read from the cache if the value is known and the device does not change it.
+    if (((device->valid & bit) && !(reg->flags & Spi_RegisterVolatile)) || (reg->flags & Spi_RegisterWriteOnly))
+    {
+        *value = device->value[index];
+        ++device->cachedReads;
+        return NiFpga_Status_Success;
+    }
+
+    // Send the read command, then clock the value in.
+    bytes = reg->width / 8;
+    dataOut[0] = (uint16_t)((address << info->addressShift) | info->readFlag);
+    Spi_DeviceTransaction(device, &transaction, dataOut, dataIn, 1 + bytes);
+
+    status = Spi_Submit(device->queue, &transaction);
+    if (status == NiFpga_Status_Success)
+    {
+        status = Spi_WaitTransaction(&transaction);
+    }
+    if (NiFpga_IsError(status))
+    {
+        // The value on the device is unknown, so the next read goes to the device.
+        device->valid &= ~bit;
+        return status;
+    }
+    ++device->busReads;
+
+    *value = (bytes == 2) ? (uint16_t)(((dataIn[1] & 0xFF) << 8) | (dataIn[2] & 0xFF)) : (dataIn[1] & 0xFF);
+
+    if (!(reg->flags & Spi_RegisterVolatile))
+    {
+        device->value[index] = *value;
+        device->valid |= bit;
+    }
+
+    return status;
+}
+
+/**
+ * Write a register in the cache. Volatile registers are written at once.
+ * Writing the value the register already has does nothing. The other writes
+ * reach the device with the next Spi_FlushDevice.
+ *
+ * @param[in]  device    The device.
+ * @param[in]  address   The address of the register.
+ * @param[in]  value     The new value of the register.
+ *
+ * @return the transfer status.
+ */
+int32_t Spi_WriteRegister(Spi_Device* device, uint8_t address, uint16_t value)
+{
+    const Spi_DeviceInfo* info = device->info;
+    const Spi_RegisterInfo* reg;
+    Spi_Transaction transaction;
+    uint16_t dataOut[3];
+    uint64_t bit;
+    int32_t index;
+    int32_t status;
+
+    index = Spi_FindRegister(info, address);
+    if (index < 0)
+    {
+        return NiFpga_Status_InvalidParameter;
+    }
+    reg = &info->registers[index];
+    bit = (uint64_t)1 << index;
+
+    if (reg->flags & Spi_RegisterReadOnly)
+    {
+        printf("The SPI register at address 0x%02X is read-only.\n", address);
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    // Volatile registers are not cached, so they are written through.
+    if (reg->flags & Spi_RegisterVolatile)
+    {
+        dataOut[0] = (uint16_t)((address << info->addressShift) | info->writeFlag);
+        if (reg->width == 16)
+        {
+            dataOut[1] = value >> 8;
+            dataOut[2] = value & 0xFF;
+        }
+        else
+        {
+            dataOut[1] = value & 0xFF;
+        }
+        Spi_DeviceTransaction(device, &transaction, dataOut, NULL, 1 + reg->width / 8);
+
+        status = Spi_Submit(device->queue, &transaction);
+        if (status == NiFpga_Status_Success)
+        {
+            status = Spi_WaitTransaction(&transaction);
+        }
+        if (status == NiFpga_Status_Success)
+        {
+            ++device->busWrites;
+        }
+        return status;
+    }
+
+    if ((device->valid & bit) && device->value[index] == value && !(device->dirty & bit))
+    {
+        ++device->skippedWrites;
+        return NiFpga_Status_Success;
+    }
+
+    device->value[index] = value;
+    device->valid |= bit;
+    device->dirty |= bit;
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Write all the dirty registers to the device in one burst.
+ *
+ * Every frame of the flush is queued before the first one is waited for, so
+ * the worker of the bank runs them back to back with one configuration. With
+ * autoIncrement, dirty registers at consecutive addresses share one frame.
+ *
+ * @param[in]  device   The device.
+ *
+ * @return the transfer status.
+ */
+int32_t Spi_FlushDevice(Spi_Device* device)
+{
+    const Spi_DeviceInfo* info = device->info;
+    uint64_t frameMask[SPI_DEVICE_REGISTERS];
+    uint32_t frames = 0;
+    uint32_t words = 0;
+    uint32_t i;
+    int32_t status = NiFpga_Status_Success;
+
+    for (i = 0; i < info->registerCount; ++i)
+    {
+        const Spi_RegisterInfo* reg = &info->registers[i];
+        uint16_t value = device->value[i];
+        uint32_t start = words;
+
+        if (!(device->dirty & ((uint64_t)1 << i)))
+        {
+            continue;
+        }
+
+        // Start a frame with the write command of this register.
+        frameMask[frames] = 0;
+        device->frame[words++] = (uint16_t)((reg->address << info->addressShift) | info->writeFlag);
+
+        for (;;)
+        {
+            if (reg->width == 16)
+            {
+                device->frame[words++] = value >> 8;
+            }
+            device->frame[words++] = value & 0xFF;
+            frameMask[frames] |= (uint64_t)1 << i;
+
+            // Continue the frame with the next register if the device increments the address.
+            if (!info->autoIncrement
+                || i + 1 >= info->registerCount
+                || !(device->dirty & ((uint64_t)1 << (i + 1)))
+                || info->registers[i + 1].address != reg->address + 1)
+            {
+                break;
+            }
+            ++i;
+            reg = &info->registers[i];
+            value = device->value[i];
+        }
+
+        Spi_DeviceTransaction(device, &device->transaction[frames], &device->frame[start], NULL, words - start);
+        ++frames;
+    }
+
+    // Queue every frame first, so they run back to back.
+    for (i = 0; i < frames; ++i)
+    {
+        status = Spi_Submit(device->queue, &device->transaction[i]);
+        if (NiFpga_IsError(status))
+        {
+            break;
+        }
+    }
+
+    // Wait for the frames that were queued. Only the registers of the frames
+    // that were written are clean.
+    frames = i;
+    for (i = 0; i < frames; ++i)
+    {
+        int32_t frameStatus = Spi_WaitTransaction(&device->transaction[i]);
+
+        // A frame that failed, for example with NiELVISIIIv10_Status_SpiTimeout,
+        // may not have reached the device, so its registers stay dirty.
+        if (frameStatus == NiFpga_Status_Success)
+        {
+            device->dirty &= ~frameMask[i];
+            ++device->busWrites;
+        }
+        NiFpga_MergeStatus(&status, frameStatus);
+    }
+
+    return status;
+}
+
+/**
+ * Forget the cached values, for example after the device is reset.
+ * The registers written and not flushed are lost.
+ *
+ * @param[in]  device   The device.
+ */
+void Spi_InvalidateDevice(Spi_Device* device)
+{
+    uint32_t i;
+
+    device->valid = 0;
+    device->dirty = 0;
+
+    for (i = 0; i < device->info->registerCount; ++i)
+    {
+        device->value[i] = device->info->registers[i].reset;
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * SpiDevice.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef SpiDevice_h_
+#define SpiDevice_h_
+
+#include "SpiQueue.h"
+
+// The largest number of registers of one device.
+#define SPI_DEVICE_REGISTERS 64
+
+// The largest number of words of one flush: a command and two bytes per register.
+#define SPI_DEVICE_FRAME_WORDS (SPI_DEVICE_REGISTERS * 3)
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Flags that describe a register of a device.
+typedef enum
+{
+    Spi_RegisterVolatile  = 0x01,   // The device changes the register, so it is never cached
+    Spi_RegisterReadOnly  = 0x02,   // The register cannot be written
+    Spi_RegisterWriteOnly = 0x04,   // The register cannot be read, so reads return the cached value
+} Spi_RegisterFlags;
+
+// One register of a device.
+typedef struct
+{
+    uint8_t address;   // Register address
+    uint8_t width;     // Register width in bits, 8 or 16
+    uint8_t flags;     // Bitwise OR of Spi_RegisterFlags
+    uint16_t reset;    // Value after the device is reset, used by write-only registers
+} Spi_RegisterInfo;
+
+// How a device is connected and how its commands are encoded.
+// Every frame starts with a command byte, (address << addressShift) | readFlag or writeFlag,
+// followed by the value of the register, most significant byte first.
+typedef struct
+{
+    Spi_ConfigureSettings   settings;        // SPI settings of the device. The frame size must be Spi_FrameSize8
+    uint16_t                counterMax;      // Maximum value of the SPI counter
+    ELVISIII_Dio*           csBank;          // DIO bank of the chip select, or NULL
+    Dio_Channel             csChannel;       // DIO channel of the chip select
+
+    uint8_t                 addressShift;    // Position of the address in the command byte
+    uint8_t                 readFlag;        // Bits set in the command byte to read
+    uint8_t                 writeFlag;       // Bits set in the command byte to write
+    NiFpga_Bool             autoIncrement;   // One frame can write consecutive registers
+
+    const Spi_RegisterInfo* registers;       // The registers of the device
+    uint32_t                registerCount;   // The number of registers, at most SPI_DEVICE_REGISTERS
+} Spi_DeviceInfo;
+
+// A device on a SPI queue, with the write-back cache of its registers.
+typedef struct
+{
+    const Spi_DeviceInfo* info;                                // Description of the device
+    Spi_Queue*            queue;                               // Queue of the bank of the device
+
+    uint16_t              value[SPI_DEVICE_REGISTERS];         // Cached value of each register
+    uint64_t              valid;                               // Registers whose cached value is known
+    uint64_t              dirty;                               // Registers written in the cache and not on the device
+
+    Spi_Transaction       transaction[SPI_DEVICE_REGISTERS];   // Frames of one flush
+    uint16_t              frame[SPI_DEVICE_FRAME_WORDS];       // Words of the frames of one flush
+
+    uint32_t              busReads;                            // Register reads sent to the device
+    uint32_t              busWrites;                           // Frames written to the device
+    uint32_t              cachedReads;                         // Register reads served by the cache
+    uint32_t              skippedWrites;                       // Writes of the value already in the register
+} Spi_Device;
+
+// Attach a device to the queue of its bank and empty its cache.
+int32_t Spi_OpenDevice(Spi_Device* device, const Spi_DeviceInfo* info, Spi_Queue* queue);
+
+// Read a register, from the cache when possible.
+int32_t Spi_ReadRegister(Spi_Device* device, uint8_t address, uint16_t* value);
+
+// Write a register in the cache. Volatile registers are written at once.
+int32_t Spi_WriteRegister(Spi_Device* device, uint8_t address, uint16_t value);
+
+// Write all the dirty registers to the device in one burst.
+int32_t Spi_FlushDevice(Spi_Device* device);
+
+// Forget the cached values, for example after the device is reset.
+void Spi_InvalidateDevice(Spi_Device* device);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // SpiDevice_h_
@@ -0,0 +1,305 @@
+/**
+ * Asynchronous SPI transactions, one worker per bank
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Include the ELVIS III header file.
+ * The target type must be defined in your project, as a stand-alone #define,
+ * or when calling the compiler from the command-line.
+ */
+#include "NiELVISIIIv10.h"
+#include "SpiQueue.h"
+
+// The workers of bank A and bank B can drive chip selects on the same DIO bank,
+// and Dio_WriteBit reads, modifies and writes the whole DO Value Register.
+static pthread_mutex_t spi_chip_select_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Drive the chip select of a transaction.
+ *
+ * @param[in]  transaction   The transaction.
+ * @param[in]  value         NiFpga_False to select the device, NiFpga_True to release it.
+ */
+static void Spi_ChipSelect(Spi_Transaction* transaction, NiFpga_Bool value)
+{
+    if (transaction->csBank == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spi_chip_select_lock);
+    Dio_WriteBit(transaction->csBank, value, transaction->csChannel);
+    pthread_mutex_unlock(&spi_chip_select_lock);
+}
+
+/**
+ * Configure the bank for a transaction if needed, transfer its words and complete it.
+ * Called by the worker only.
+ *
+ * @param[in]  queue         The queue of the bank.
+ * @param[in]  transaction   The transaction, already removed from the list.
+ */
+static void Spi_RunTransaction(Spi_Queue* queue, Spi_Transaction* transaction)
+{
+    // Only write the configuration when it differs from the previous transaction.
+    if (!queue->configured
+        || queue->settings != transaction->settings
+        || queue->counterMax != transaction->counterMax)
+    {
+        Spi_Configure(queue->bank, SPI_QUEUE_CONFIGURE_MASK, transaction->settings);
+        Spi_CounterMaximum(queue->bank, transaction->counterMax);
+
+        queue->configured = NiFpga_True;
+        queue->settings   = transaction->settings;
+        queue->counterMax = transaction->counterMax;
+        ++queue->reconfigurations;
+    }
+
+    Spi_ChipSelect(transaction, NiFpga_False);
+    transaction->status = Spi_TransferBuffer(queue->bank,
+                                             transaction->dataOut,
+                                             transaction->dataIn,
+                                             transaction->count,
+                                             &transaction->timing);
+    Spi_ChipSelect(transaction, NiFpga_True);
+
+    ++queue->transactions;
+
+    // The callback runs before the transaction is marked done, so a thread in
+    // Spi_WaitTransaction can free the transaction as soon as it returns.
+    if (transaction->callback != NULL)
+    {
+        transaction->callback(transaction, transaction->data);
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    transaction->done = NiFpga_True;
+    pthread_cond_broadcast(&queue->completed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * The worker thread of one bank.
+ *
+ * The worker takes every transaction queued so far at once. It runs first the
+ * ones with the configuration already written to the bank, then the others
+ * grouped by configuration, so the SPI Configuration Register is written once
+ * per group. Transactions with the same configuration keep their order.
+ *
+ * @param[in]  resource   The queue.
+ */
+static void* Spi_QueueThread(void* resource)
+{
+    Spi_Queue* queue = (Spi_Queue*)resource;
+    Spi_Transaction* list;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->head == NULL && queue->running)
+        {
+            pthread_cond_wait(&queue->pending, &queue->lock);
+        }
+        list = queue->head;
+        queue->head = NULL;
+        queue->tail = NULL;
+        pthread_mutex_unlock(&queue->lock);
+
+        // The queue is stopped and every transaction is complete.
+        if (list == NULL)
+        {
+            break;
+        }
+
+        while (list != NULL)
+        {
+            Spi_Transaction** link;
+            Spi_Transaction* transaction;
+            Spi_ConfigureSettings settings = list->settings;
+            uint16_t counterMax = list->counterMax;
+
+            // Keep the current configuration while a transaction still uses it.
+            if (queue->configured)
+            {
+                for (transaction = list; transaction != NULL; transaction = transaction->next)
+                {
+                    if (transaction->settings == queue->settings && transaction->counterMax == queue->counterMax)
+                    {
+                        settings   = queue->settings;
+                        counterMax = queue->counterMax;
+                        break;
+                    }
+                }
+            }
+
+            // Run every transaction with this configuration, in order.
+            link = &list;
+            while (*link != NULL)
+            {
+                transaction = *link;
+                if (transaction->settings == settings && transaction->counterMax == counterMax)
+                {
+                    *link = transaction->next;
+                    Spi_RunTransaction(queue, transaction);
+                }
+                else
+                {
+                    link = &transaction->next;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the worker of one SPI bank.
+ * Banks A and B are independent, so a worker can run on each at the same time.
+ *
+ * @param[in]  queue    The queue to start.
+ * @param[in]  bank     spi_bank_A or spi_bank_B.
+ * @param[in]  config   How the worker is scheduled, or NULL for SCHED_FIFO at THREAD_STREAM_PRIORITY.
+ *
+ * @return the configuration status.
+ */
+int32_t Spi_StartQueue(Spi_Queue* queue, ELVISIII_Spi* bank, const Thread_Config* config)
+{
+    Thread_Config threadConfig;
+    int32_t status;
+
+    memset(queue, 0, sizeof(Spi_Queue));
+    queue->bank = bank;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->pending, NULL);
+    pthread_cond_init(&queue->completed, NULL);
+
+    if (config != NULL)
+    {
+        threadConfig = *config;
+    }
+    else
+    {
+        Thread_InitConfig(&threadConfig, THREAD_STREAM_PRIORITY);
+    }
+
+    // Route the SPI pins of the bank before the first transaction.
+    status = Spi_Select(bank);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->pending);
+        pthread_cond_destroy(&queue->completed);
+        return status;
+    }
+
+    queue->running = NiFpga_True;
+    status = Thread_Create(&queue->thread, &threadConfig, Spi_QueueThread, queue);
+    if (status != 0)
+    {
+        printf("Failed to create the SPI worker thread!\n");
+        queue->running = NiFpga_False;
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->pending);
+        pthread_cond_destroy(&queue->completed);
+        return status;
+    }
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Complete the queued transactions and stop the worker.
+ * The IRQ context kept by the bank is returned to the pool.
+ *
+ * @param[in]  queue    The queue to stop.
+ *
+ * @return the configuration status.
+ */
+int32_t Spi_StopQueue(Spi_Queue* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->running = NiFpga_False;
+    pthread_cond_signal(&queue->pending);
+    pthread_mutex_unlock(&queue->lock);
+
+    pthread_join(queue->thread, NULL);
+
+    Spi_Close(queue->bank);
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->pending);
+    pthread_cond_destroy(&queue->completed);
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Queue a transaction on a bank.
+ * The transaction must stay valid until it is complete. Wait for it with
+ * Spi_WaitTransaction, or set its callback.
+ *
+ * @param[in]  queue         The queue of the bank.
+ * @param[in]  transaction   The transaction to queue.
+ *
+ * @return the configuration status.
+ */
+int32_t Spi_Submit(Spi_Queue* queue, Spi_Transaction* transaction)
+{
+    transaction->status = NiFpga_Status_Success;
+    transaction->done   = NiFpga_False;
+    transaction->queue  = queue;
+    transaction->next   = NULL;
+    memset(&transaction->timing, 0, sizeof(Spi_Timing));
+
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->running)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        printf("The SPI queue is not running.\n");
+        return NiFpga_Status_InvalidParameter;
+    }
+
+    if (queue->tail != NULL)
+    {
+        queue->tail->next = transaction;
+    }
+    else
+    {
+        queue->head = transaction;
+    }
+    queue->tail = transaction;
+
+    pthread_cond_signal(&queue->pending);
+    pthread_mutex_unlock(&queue->lock);
+
+    return NiFpga_Status_Success;
+}
+
+/**
+ * Wait until a transaction is complete and get its status.
+ *
+ * @param[in]  transaction   A transaction queued with Spi_Submit.
+ *
+ * @return the transfer status of the transaction.
+ */
+int32_t Spi_WaitTransaction(Spi_Transaction* transaction)
+{
+    Spi_Queue* queue = transaction->queue;
+
+    pthread_mutex_lock(&queue->lock);
+    while (!transaction->done)
+    {
+        pthread_cond_wait(&queue->completed, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return transaction->status;
+}
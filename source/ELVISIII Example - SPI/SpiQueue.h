@@ -0,0 +1,89 @@
+/**
+ * SpiQueue.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef SpiQueue_h_
+#define SpiQueue_h_
+
+#include <pthread.h>
+#include "SPI.h"
+#include "DIO.h"
+#include "ThreadConfig.h"
+
+#if NiFpga_Cpp
+extern "C" {
+#endif
+
+// Every option of the SPI Configuration Register set by a transaction.
+#define SPI_QUEUE_CONFIGURE_MASK (Spi_ClockPhase | Spi_ClockPolarity | Spi_DataOrder | Spi_FrameLength | Spi_ClockDivider)
+
+struct Spi_Transaction;
+
+// Function called by the worker of the bank when a transaction is complete.
+typedef void (*Spi_TransactionCallback)(struct Spi_Transaction* transaction, void* data);
+
+// One transfer queued on a bank, with its own configuration and chip select.
+typedef struct Spi_Transaction
+{
+    Spi_ConfigureSettings   settings;      // Settings of all the options in SPI_QUEUE_CONFIGURE_MASK
+    uint16_t                counterMax;    // Maximum value of the SPI counter
+
+    ELVISIII_Dio*           csBank;        // DIO bank of the chip select, or NULL if there is none
+    Dio_Channel             csChannel;     // DIO channel of the chip select, driven low during the transfer
+
+    const uint16_t*         dataOut;       // Words to output, or NULL to output zeros
+    uint16_t*               dataIn;        // Words received, or NULL to discard them
+    size_t                  count;         // Number of words
+
+    Spi_TransactionCallback callback;      // Function called when the transaction is complete, or NULL
+    void*                   data;          // Passed to callback
+
+    int32_t                 status;        // Transfer status, valid when done is set
+    Spi_Timing              timing;        // Timing of the transfer, valid when done is set
+    volatile NiFpga_Bool    done;          // Set when the transaction is complete
+
+    struct Spi_Queue*       queue;         // Queue the transaction was submitted to
+    struct Spi_Transaction* next;          // Next transaction in the queue
+} Spi_Transaction;
+
+// One worker thread that drives the transactions of one SPI bank.
+typedef struct Spi_Queue
+{
+    ELVISIII_Spi*        bank;             // Bank driven by the worker
+    pthread_t            thread;           // Worker thread
+    pthread_mutex_t      lock;             // Protects the list and the done flags
+    pthread_cond_t       pending;          // Signaled when a transaction is submitted or the queue stops
+    pthread_cond_t       completed;        // Signaled when a transaction is complete
+    Spi_Transaction*     head;             // Oldest transaction not taken by the worker yet
+    Spi_Transaction*     tail;             // Newest transaction
+    NiFpga_Bool          running;          // Cleared to stop the worker
+
+    NiFpga_Bool          configured;       // The registers hold settings and counterMax
+    Spi_ConfigureSettings settings;        // Settings written to the SPI Configuration Register
+    uint16_t             counterMax;       // Value written to the SPI Counter Register
+
+    uint32_t             transactions;     // Transactions completed
+    uint32_t             reconfigurations; // Times the configuration was written
+} Spi_Queue;
+
+// Start the worker of one SPI bank.
+int32_t Spi_StartQueue(Spi_Queue* queue, ELVISIII_Spi* bank, const Thread_Config* config);
+
+// Complete the queued transactions and stop the worker.
+int32_t Spi_StopQueue(Spi_Queue* queue);
+
+// Queue a transaction on a bank.
+int32_t Spi_Submit(Spi_Queue* queue, Spi_Transaction* transaction);
+
+// Wait until a transaction is complete and get its status.
+int32_t Spi_WaitTransaction(Spi_Transaction* transaction);
+
+#if NiFpga_Cpp
+}
+#endif
+
+#endif // SpiQueue_h_
@@ -7,6 +7,10 @@
  * Demonstrates using the SPI. Writes a message to the SPI bus, prints any
  * returned bytes to the console.
  *
+ * With -b words, the program also measures the throughput of the SPI: it
+ * transfers the words once with one Spi_Transmit call per word, and once with
+ * a single Spi_TransferBuffer call, and prints both.
+ *
  * Instructions:
  * 1. Connect SPI.CLK of the SPI slave to DIO5 on bank A.
  * 2. Connect SPI.MISO of the SPI slave to DIO6 on bank A.
@@ -20,12 +24,15 @@
  * SPI device. The bit 7 refers to the writing/reading bit. We want to read
  * from the address 0x00, which means we have to set the bit 7 of 0x00 to 1.
  * Then the program reads back a value from the 0x00 register of the SPI device.
+ * With -b, the words per second and the time per word of both transfer paths.
  *
  * Note:
  * The Eclipse project defines the preprocessor symbol for the NI ELVIS III.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include "SPI.h"
 #include "DIO.h"
 #include "NiELVISIIIv10.h"
@@ -37,6 +44,76 @@
 extern ELVISIII_Dio bank_A;
 extern ELVISIII_Spi spi_bank_A;
 
+/**
+ * Get the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t Benchmark_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Transfer the same words with one Spi_Transmit call per word and with one
+ * Spi_TransferBuffer call, and print the throughput of both.
+ *
+ * @param[in]  bank    A struct containing the registers on the SPI channel.
+ * @param[in]  words   The number of words to transfer.
+ *
+ * @return the transfer status.
+ */
+static int32_t Benchmark_Spi(ELVISIII_Spi* bank, size_t words)
+{
+    NiFpga_Status status;
+    Spi_Timing timing;
+    uint16_t* dataOut;
+    uint16_t* dataIn;
+    uint64_t start;
+    uint64_t perWord;
+    size_t i;
+
+    dataOut = malloc(words * sizeof(uint16_t));
+    dataIn  = malloc(words * sizeof(uint16_t));
+    if (dataOut == NULL || dataIn == NULL)
+    {
+        free(dataOut);
+        free(dataIn);
+        printf("Could not allocate the SPI buffers.\n");
+        return NiFpga_Status_MemoryFull;
+    }
+
+    for (i = 0; i < words; ++i)
+    {
+        dataOut[i] = (uint16_t)i;
+    }
+
+    // One call per word, each taking an IRQ context from the pool and returning it.
+    start = Benchmark_Now();
+    for (i = 0; i < words; ++i)
+    {
+        dataIn[i] = Spi_Transmit(bank, dataOut[i]);
+    }
+    perWord = Benchmark_Now() - start;
+
+    // One call for all the words, with the IRQ context kept in the bank.
+    status = Spi_TransferBuffer(bank, dataOut, dataIn, words, &timing);
+
+    printf("Spi_Transmit:       %10.0f words/s, %8.1f us/word\n",
+           words * 1e9 / perWord, perWord / 1e3 / words);
+    printf("Spi_TransferBuffer: %10.0f words/s, %8.1f us/word (min %.1f us, max %.1f us, %u timeouts)\n",
+           timing.words * 1e9 / timing.total, timing.meanWord / 1e3,
+           timing.minWord / 1e3, timing.maxWord / 1e3, timing.timeouts);
+    printf("Speedup: %.2fx\n", (double)perWord / timing.total);
+
+    free(dataOut);
+    free(dataIn);
+
+    return status;
+}
+
 int main(int argc, char **argv)
 {
     NiFpga_Status status;
@@ -45,6 +122,20 @@ int main(int argc, char **argv)
 
     uint16_t readChar;
 
+    size_t benchmarkWords = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "b:")) != -1)
+    {
+        switch (option)
+        {
+        case 'b': benchmarkWords = strtoul(optarg, NULL, 0); break;
+        default:
+            printf("Usage: %s [-b words]\n", argv[0]);
+            return NiFpga_Status_InvalidParameter;
+        }
+    }
+
     printf("SPI:\n");
 
     // Open the ELVIS III NiFpga Session.
@@ -67,7 +158,13 @@ int main(int argc, char **argv)
     Spi_CounterMaximum(&spi_bank_A, 127);
 
     // Write the value to the System Select Register.
-    Spi_Select(&spi_bank_A);
+    // Stop if the pins are owned by another function.
+    status = Spi_Select(&spi_bank_A);
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        NiELVISIIIv10_Close();
+        return status;
+    }
 
     // Write the initial value to channel DIO0 which set the SPI.CS to low.
     Dio_WriteBit(&bank_A, false, Dio_Channel0);
@@ -76,9 +173,18 @@ int main(int argc, char **argv)
     readChar = Spi_Transmit(&spi_bank_A, data[0]);
     printf("%i\n",  (int) readChar);
 
+    // Compare the throughput of the two transfer paths.
+    if (benchmarkWords > 0)
+    {
+        Benchmark_Spi(&spi_bank_A, benchmarkWords);
+    }
+
     // Write the initial value to channel DIO0 which set the SPI.CS to high.
     Dio_WriteBit(&bank_A, true, Dio_Channel0);
 
+    // Return the IRQ context kept by Spi_TransferBuffer to the pool.
+    Spi_Close(&spi_bank_A);
+
     // Close the ELVISIII NiFpga Session.
     // This function MUST be called after all other functions.
     status = NiELVISIIIv10_Close();
@@ -42,26 +42,31 @@ int32_t Irq_RegisterTimerIrq(ELVISIII_IrqTimer* irqChannel,
 {
     int32_t status;
 
-    // Reserve an IRQ context. IRQ contexts are single-threaded; only one thread
-    // can wait with a particular context at any given time. To minimize jitter
-    // when first waiting on IRQs, reserve as many contexts as the application requires.
-    // If a context is successfully reserved, you must unreserve it later.
-    // Otherwise a memory leak will occur.
-    status = NiFpga_ReserveIrqContext(NiELVISIIIv10_session, irqContext);
-
-    // Check if there was an error when you reserved the IRQ.
-    // If there was an error, print an error message to stdout and return the configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not reserved.");
-
-    // Check if the IRQ number or channel value already exists in the resource list,
-    // return the configuration status and print an error message.
-    status = Irq_CheckReserved(irqChannel->timerChannel, TIMERIRQNO);
+    // Reserve the IRQ number and channel value in the resource list. The reservation is
+    // atomic, so it fails if another thread already reserved either of them.
+    // If it fails, return the configuration status and print an error message.
+    status = Irq_AddReserved(irqChannel->timerChannel, TIMERIRQNO);
     if (status == NiELVISIIIv10_Status_IrqNumberNotUsable || status == NiELVISIIIv10_Status_IrqChannelNotUsable)
     {
         printf("You have already registered the only timer interrupt.\n");
         return status;
     }
 
+    // Take an IRQ context from the pool reserved by NiELVISIIIv10_Open() once the IRQ
+    // is reserved, so an IRQ that cannot be registered never holds a context. IRQ contexts
+    // are single-threaded; only one thread can wait with a particular context at
+    // any given time. The context must be returned to the pool later.
+    status = Irq_AcquireContext(irqContext);
+
+    // Check if there was an error when you took the IRQ context.
+    // If there was an error, release the IRQ, print an error message to stdout and return the configuration status.
+    if (NiELVISIIIv10_IsNotSuccess(status))
+    {
+        Irq_RemoveReserved(TIMERIRQNO);
+        printf("A required NiFpga_IrqContext was not acquired.\n");
+        return status;
+    }
+
     // Write the value to the TIMERWRITE register.
     // The returned NiFpga_Status value is stored for error checking.
     status = NiFpga_WriteU32(NiELVISIIIv10_session, irqChannel->timerWrite, timeout);
@@ -77,9 +82,6 @@ int32_t Irq_RegisterTimerIrq(ELVISIII_IrqTimer* irqChannel,
     // If there was an error, print an error message to stdout and return the configuration status.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not write to TIMERSETTIME Register!");
 
-    // Add the channel value and IRQ number to the list.
-    Irq_AddReserved(irqChannel->timerChannel, TIMERIRQNO);
-
     return NiELVISIIIv10_Status_Success;
 }
 
@@ -120,13 +122,13 @@ int32_t Irq_UnregisterTimerIrq(ELVISIII_IrqTimer* irqChannel,
     // If there was an error then print an error message to stdout.
     NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "Could not release the IRQ resource!");
 
-    // Unreserve an IRQ context obtained from Irq_ReserveIrqContext.
+    // Return the IRQ context obtained from Irq_AcquireContext() to the pool.
     // The returned NiFpga_Status value is stored for error checking.
-    status = NiFpga_UnreserveIrqContext(NiELVISIIIv10_session, irqContext);
+    status = Irq_ReleaseContext(irqContext);
 
     // Check if there was an error when unreserve an IRQ.
     // If there was an error then print an error message to stdout and return configuration status.
-    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not unreserved.");
+    NiELVISIIIv10_ReturnStatusIfNotSuccess(status, "A required NiFpga_IrqContext was not released.");
 
     return NiELVISIIIv10_Status_Success;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <pthread.h>
+#include "ThreadConfig.h"
 #include "TimerIRQ.h"
 
 #if !defined(LoopDuration)
@@ -48,6 +49,8 @@ int main(int argc, char **argv)
     ThreadResource irqThread0;
 
     pthread_t thread;
+    Thread_Config threadConfig;
+    Thread_Stats threadStats;
 
     time_t currentTime;
     time_t finalTime;
@@ -85,9 +88,15 @@ int main(int argc, char **argv)
     // Set the indicator to allow the new thread.
     irqThread0.irqThreadRdy = NiFpga_True;
 
+    // Lock the memory of the process so the IRQ thread never waits for a page fault.
+    Thread_LockMemory();
+
     // Create new threads to catch the specified IRQ numbers.
     // Different IRQs should have different corresponding threads.
-    status = pthread_create(&thread, NULL, Timer_Irq_Thread, &irqThread0);
+    // The IRQ thread runs with SCHED_FIFO at THREAD_IRQ_PRIORITY and a prefaulted stack.
+    Thread_InitConfig(&threadConfig, THREAD_IRQ_PRIORITY);
+    threadConfig.stats = &threadStats;
+    status = Thread_Create(&thread, &threadConfig, Timer_Irq_Thread, &irqThread0);
     if (status != NiELVISIIIv10_Status_Success)
     {
         printf("CONFIGURE ERROR: %d, Failed to create a new thread!", status);
@@ -117,9 +126,19 @@ int main(int argc, char **argv)
     // Set the indicator to end the new thread.
     irqThread0.irqThreadRdy = NiFpga_False;
 
+    // Wake the IRQ thread from its wait. The timer IRQ is used by this example,
+    // so the wait checks for cancellation every IRQ_WAIT_POLL milliseconds.
+    Irq_CancelWaits();
+
     // Wait for the end of the IRQ thread.
     pthread_join(thread, NULL);
 
+    // Report the page faults the IRQ thread took after it started.
+    Thread_PrintStats("IRQ thread", &threadStats);
+
+    // Allow waiting again and release the timer IRQ reserved for cancellation.
+    Irq_ReleaseCancelIrq();
+
     // Disable timer interrupt, so you can configure this I/O next time.
     // Every IrqConfigure() function should have its corresponding clear function,
     // and their parameters should also match.
@@ -0,0 +1,438 @@
+/**
+ * Asynchronous UART reader with a lock-free ring
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "UartReader.h"
+#include "visa.h"
+
+/**
+ * Read CLOCK_MONOTONIC in microseconds.
+ *
+ * @return the current time, in microseconds.
+ */
+static uint64_t Uart_Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Sleep for UART_READER_POLL microseconds.
+ */
+static void Uart_Sleep(void)
+{
+    struct timespec delay;
+
+    delay.tv_sec  = UART_READER_POLL / 1000000;
+    delay.tv_nsec = (UART_READER_POLL % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+}
+
+/**
+ * The reader thread.
+ * It asks the port how many bytes it holds and reads only those, so viRead
+ * never waits for bytes that have not arrived. When the port is empty the
+ * thread sleeps for UART_READER_POLL microseconds.
+ *
+ * @param[in]  resource   The reader.
+ */
+static void* Uart_ReaderThread(void* resource)
+{
+    Uart_Reader* reader = (Uart_Reader*)resource;
+    Uart_Chunk chunk;
+    ViUInt32 available;
+    ViUInt32 nRead;
+    int32_t status;
+
+    while (reader->running)
+    {
+        status = viGetAttribute(reader->port->session, VI_ATTR_ASRL_AVAIL_NUM, &available);
+        if (status < VI_SUCCESS)
+        {
+            ++reader->stats.errors;
+            reader->stats.lastError = status;
+            Uart_Sleep();
+            continue;
+        }
+
+        if (available == 0)
+        {
+            Uart_Sleep();
+            continue;
+        }
+
+        while (available > 0)
+        {
+            nRead = 0;
+            status = viRead(reader->port->session,
+                            (ViBuf)chunk.data,
+                            (available < UART_CHUNK_BYTES) ? available : UART_CHUNK_BYTES,
+                            &nRead);
+            if (status < VI_SUCCESS)
+            {
+                if (status == VI_ERROR_ASRL_OVERRUN)
+                {
+                    ++reader->stats.overruns;
+                }
+                else
+                {
+                    ++reader->stats.errors;
+                }
+                reader->stats.lastError = status;
+            }
+            if (nRead == 0)
+            {
+                break;
+            }
+
+            chunk.timestamp = Uart_Now();
+            chunk.length    = nRead;
+            reader->stats.bytes += nRead;
+
+            // Count the bytes before the consumer can see the chunk, so it
+            // never takes more bytes than were counted.
+            reader->pushed += nRead;
+            __sync_synchronize();
+            if (!SpscRing_Push(&reader->ring, &chunk))
+            {
+                reader->pushed -= nRead;
+                reader->stats.droppedBytes += nRead;
+            }
+
+            available = (nRead < available) ? available - nRead : 0;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Take the next byte received. Called by the consumer only.
+ *
+ * @param[in]  reader      The reader.
+ * @param[out] byte        The byte.
+ * @param[out] timestamp   The timestamp of the chunk of the byte.
+ *
+ * @return NiFpga_True if a byte was taken, NiFpga_False if none is available.
+ */
+static NiFpga_Bool Uart_NextByte(Uart_Reader* reader, uint8_t* byte, uint64_t* timestamp)
+{
+    if (reader->offset >= reader->current.length)
+    {
+        if (!SpscRing_Pop(&reader->ring, &reader->current))
+        {
+            return NiFpga_False;
+        }
+        reader->offset = 0;
+    }
+
+    *byte      = reader->current.data[reader->offset++];
+    *timestamp = reader->current.timestamp;
+    ++reader->popped;
+
+    return NiFpga_True;
+}
+
+/**
+ * Copy up to nData bytes from the ring, one chunk at a time. Called by the consumer only.
+ *
+ * @param[in]  reader      The reader.
+ * @param[out] data        Buffer for the bytes.
+ * @param[in]  nData       Size of the buffer.
+ * @param[out] timestamp   The timestamp of the chunk of the first byte, if a byte was copied.
+ *
+ * @return the number of bytes copied.
+ */
+static size_t Uart_Take(Uart_Reader* reader, uint8_t* data, size_t nData, uint64_t* timestamp)
+{
+    size_t copied = 0;
+
+    while (copied < nData)
+    {
+        size_t count;
+
+        if (reader->offset >= reader->current.length)
+        {
+            if (!SpscRing_Pop(&reader->ring, &reader->current))
+            {
+                break;
+            }
+            reader->offset = 0;
+        }
+
+        if (copied == 0)
+        {
+            *timestamp = reader->current.timestamp;
+        }
+
+        count = reader->current.length - reader->offset;
+        if (count > nData - copied)
+        {
+            count = nData - copied;
+        }
+        memcpy(data + copied, &reader->current.data[reader->offset], count);
+        reader->offset += count;
+        reader->popped += count;
+        copied += count;
+    }
+
+    return copied;
+}
+
+/**
+ * Start a reader thread on an open port.
+ * From then on, read the port with the functions of the reader only, from one thread.
+ *
+ * @param[in]  reader   The reader to start.
+ * @param[in]  port     A port opened with Uart_Open.
+ * @param[in]  config   How the thread is scheduled, or NULL for SCHED_FIFO at THREAD_STREAM_PRIORITY.
+ *
+ * @return     int32_t  Error/success status
+ */
+int32_t Uart_StartReader(Uart_Reader* reader, ELVISIII_Uart* port, const Thread_Config* config)
+{
+    Thread_Config threadConfig;
+    int32_t status;
+
+    memset(reader, 0, sizeof(Uart_Reader));
+    reader->port = port;
+
+    status = SpscRing_Init(&reader->ring, reader->chunks, sizeof(Uart_Chunk), UART_READER_CHUNKS);
+    if (status != NiFpga_Status_Success)
+    {
+        return VI_ERROR_INV_PARAMETER;
+    }
+
+    if (config != NULL)
+    {
+        threadConfig = *config;
+    }
+    else
+    {
+        Thread_InitConfig(&threadConfig, THREAD_STREAM_PRIORITY);
+    }
+
+    reader->running = NiFpga_True;
+    status = Thread_Create(&reader->thread, &threadConfig, Uart_ReaderThread, reader);
+    if (status != 0)
+    {
+        printf("Failed to create the UART reader thread!\n");
+        reader->running = NiFpga_False;
+        return VI_ERROR_SYSTEM_ERROR;
+    }
+
+    return VI_SUCCESS;
+}
+
+/**
+ * Stop the reader thread. The bytes already in the ring can still be read.
+ *
+ * @param[in]  reader   The reader to stop.
+ *
+ * @return     int32_t  Error/success status
+ */
+int32_t Uart_StopReader(Uart_Reader* reader)
+{
+    reader->running = NiFpga_False;
+    pthread_join(reader->thread, NULL);
+
+    return VI_SUCCESS;
+}
+
+/**
+ * Get the number of bytes received and not consumed yet.
+ *
+ * @param[in]  reader   The reader.
+ *
+ * @return the number of bytes.
+ */
+size_t Uart_Available(Uart_Reader* reader)
+{
+    return reader->pushed - reader->popped;
+}
+
+/**
+ * Copy the bytes received so far without waiting.
+ *
+ * @param[in]   reader      The reader.
+ * @param[out]  data        Buffer to receive the bytes.
+ * @param[in]   nData       Size of the buffer.
+ * @param[out]  timestamp   When the first byte was read from the port, on CLOCK_MONOTONIC in microseconds, or NULL.
+ *
+ * @return the number of bytes copied, 0 if none was available.
+ */
+size_t Uart_ReadAvailable(Uart_Reader* reader, uint8_t* data, size_t nData, uint64_t* timestamp)
+{
+    uint64_t first = 0;
+    size_t copied;
+
+    copied = Uart_Take(reader, data, nData, &first);
+    if (timestamp != NULL)
+    {
+        *timestamp = first;
+    }
+
+    return copied;
+}
+
+/**
+ * Wait until nData bytes are received and copy them. The bytes are copied as
+ * they arrive, so nData can be larger than the ring.
+ *
+ * @param[in]   reader      The reader.
+ * @param[out]  data        Buffer to receive the bytes.
+ * @param[in]   nData       Number of bytes to read.
+ * @param[out]  nRead       Number of bytes copied, nData unless the wait timed out, or NULL.
+ * @param[in]   timeout     How long to wait, in milliseconds.
+ * @param[out]  timestamp   When the first byte was read from the port, on CLOCK_MONOTONIC in microseconds, or NULL.
+ *
+ * @return      int32_t     VI_SUCCESS, or VI_ERROR_TMO if fewer than nData bytes were received in time
+ */
+int32_t Uart_WaitForBytes(Uart_Reader* reader,
+                          uint8_t* data,
+                          size_t nData,
+                          size_t* nRead,
+                          uint32_t timeout,
+                          uint64_t* timestamp)
+{
+    uint64_t deadline = Uart_Now() + (uint64_t)timeout * 1000;
+    uint64_t first = 0;
+    uint64_t chunkTime;
+    size_t copied = 0;
+    int32_t status = VI_SUCCESS;
+
+    for (;;)
+    {
+        size_t count = Uart_Take(reader, data + copied, nData - copied, &chunkTime);
+
+        if (count > 0 && copied == 0)
+        {
+            first = chunkTime;
+        }
+        copied += count;
+
+        if (copied >= nData)
+        {
+            break;
+        }
+        if (Uart_Now() >= deadline)
+        {
+            status = VI_ERROR_TMO;
+            break;
+        }
+        Uart_Sleep();
+    }
+
+    if (nRead != NULL)
+    {
+        *nRead = copied;
+    }
+    if (timestamp != NULL)
+    {
+        *timestamp = first;
+    }
+
+    return status;
+}
+
+/**
+ * Wait for a line ending with a line feed and copy it, followed by a null character.
+ * A line that is not complete when the wait times out is kept for the next call.
+ *
+ * @param[in]   reader      The reader.
+ * @param[out]  line        Buffer to receive the line, with its line feed.
+ * @param[in]   size        Size of the buffer, including the null character.
+ * @param[out]  length      Number of characters copied, or NULL.
+ * @param[in]   timeout     How long to wait, in milliseconds.
+ * @param[out]  timestamp   When the first byte of the line was read from the port, on CLOCK_MONOTONIC in microseconds, or NULL.
+ *
+ * @return      int32_t     VI_SUCCESS, VI_SUCCESS_MAX_CNT if the line was cut to UART_LINE_BYTES or to size,
+ *                          or VI_ERROR_TMO if no complete line was received in time
+ */
+int32_t Uart_ReadLine(Uart_Reader* reader,
+                      char* line,
+                      size_t size,
+                      size_t* length,
+                      uint32_t timeout,
+                      uint64_t* timestamp)
+{
+    uint64_t deadline = Uart_Now() + (uint64_t)timeout * 1000;
+    uint64_t byteTime;
+    uint8_t byte;
+    size_t count;
+    int32_t status;
+
+    if (size == 0)
+    {
+        return VI_ERROR_INV_PARAMETER;
+    }
+
+    for (;;)
+    {
+        while (Uart_NextByte(reader, &byte, &byteTime))
+        {
+            if (reader->lineLength == 0)
+            {
+                reader->lineTimestamp = byteTime;
+            }
+            reader->line[reader->lineLength++] = (char)byte;
+
+            if (byte == '\n' || reader->lineLength == UART_LINE_BYTES)
+            {
+                count = (reader->lineLength < size) ? reader->lineLength : size - 1;
+                memcpy(line, reader->line, count);
+                line[count] = '\0';
+
+                // The line is cut if it has no line feed or does not fit in the buffer.
+                status = (byte == '\n' && count == reader->lineLength) ? VI_SUCCESS : VI_SUCCESS_MAX_CNT;
+
+                if (length != NULL)
+                {
+                    *length = count;
+                }
+                if (timestamp != NULL)
+                {
+                    *timestamp = reader->lineTimestamp;
+                }
+
+                reader->lineLength = 0;
+
+                return status;
+            }
+        }
+
+        if (Uart_Now() >= deadline)
+        {
+            if (length != NULL)
+            {
+                *length = 0;
+            }
+            line[0] = '\0';
+            return VI_ERROR_TMO;
+        }
+        Uart_Sleep();
+    }
+}
+
+/**
+ * Copy the counters of a reader.
+ *
+ * @param[in]   reader   The reader.
+ * @param[out]  stats    The counters.
+ */
+void Uart_GetReaderStats(Uart_Reader* reader, Uart_ReaderStats* stats)
+{
+    __sync_synchronize();
+    *stats = reader->stats;
+    stats->droppedChunks = reader->ring.dropped;
+}
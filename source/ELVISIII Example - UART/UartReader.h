@@ -0,0 +1,108 @@
+/**
+ * UartReader.h
+ *
+ * Copyright (c) 2018,
+ * National Instruments Corporation.
+ * All rights reserved.
+ */
+
+#ifndef UartReader_h_
+#define UartReader_h_
+
+#include <pthread.h>
+
+#include "UART.h"
+#include "SpscRing.h"
+#include "ThreadConfig.h"
+
+// The largest number of bytes of one read of the reader thread.
+#if !defined(UART_CHUNK_BYTES)
+#define UART_CHUNK_BYTES 64
+#endif
+
+// The number of chunks of the ring. It must be a power of two.
+#if !defined(UART_READER_CHUNKS)
+#define UART_READER_CHUNKS 256
+#endif
+
+// The longest line returned by Uart_ReadLine, including the line feed.
+#if !defined(UART_LINE_BYTES)
+#define UART_LINE_BYTES 256
+#endif
+
+// How long the threads sleep when no byte is available, in microseconds.
+#if !defined(UART_READER_POLL)
+#define UART_READER_POLL 1000
+#endif
+
+// Bytes received by one read of the reader thread.
+typedef struct
+{
+    uint64_t timestamp;                 // End of the read on CLOCK_MONOTONIC, in microseconds
+    uint32_t length;                    // Number of bytes in data
+    uint8_t  data[UART_CHUNK_BYTES];    // The bytes received
+} Uart_Chunk;
+
+// Counters of a reader.
+typedef struct
+{
+    uint32_t bytes;                     // Bytes read from the port
+    uint32_t droppedBytes;              // Bytes lost because the ring was full
+    uint32_t droppedChunks;             // Reads lost because the ring was full
+    uint32_t overruns;                  // Reads that reported a receive buffer overrun
+    uint32_t errors;                    // Other failed reads
+    int32_t  lastError;                 // Status of the last failed read
+} Uart_ReaderStats;
+
+// A thread that moves the bytes received on one port into a ring, and the
+// state of the one thread that consumes them.
+typedef struct
+{
+    ELVISIII_Uart*       port;                            // Port read by the thread
+    SpscRing             ring;                            // Chunks from the reader thread to the consumer
+    Uart_Chunk           chunks[UART_READER_CHUNKS];      // Storage of the ring
+    pthread_t            thread;                          // Reader thread
+    volatile NiFpga_Bool running;                         // Cleared to stop the reader thread
+
+    volatile uint32_t    pushed;                          // Bytes pushed to the ring, written by the reader thread only
+    uint32_t             popped;                          // Bytes removed by the consumer
+    Uart_Chunk           current;                         // Chunk the consumer is reading
+    uint32_t             offset;                          // Next byte of current
+
+    char                 line[UART_LINE_BYTES];           // Line read so far by Uart_ReadLine
+    size_t               lineLength;                      // Bytes in line
+    uint64_t             lineTimestamp;                   // Timestamp of the first byte of line
+
+    Uart_ReaderStats     stats;                           // Written by the reader thread only
+} Uart_Reader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Start a reader thread on an open port.
+int32_t Uart_StartReader(Uart_Reader* reader, ELVISIII_Uart* port, const Thread_Config* config);
+
+// Stop the reader thread.
+int32_t Uart_StopReader(Uart_Reader* reader);
+
+// Get the number of bytes received and not consumed yet.
+size_t Uart_Available(Uart_Reader* reader);
+
+// Copy the bytes received so far without waiting.
+size_t Uart_ReadAvailable(Uart_Reader* reader, uint8_t* data, size_t nData, uint64_t* timestamp);
+
+// Wait until nData bytes are received and copy them.
+int32_t Uart_WaitForBytes(Uart_Reader* reader, uint8_t* data, size_t nData, size_t* nRead, uint32_t timeout, uint64_t* timestamp);
+
+// Wait for a line ending with a line feed and copy it.
+int32_t Uart_ReadLine(Uart_Reader* reader, char* line, size_t size, size_t* length, uint32_t timeout, uint64_t* timestamp);
+
+// Copy the counters of a reader.
+void Uart_GetReaderStats(Uart_Reader* reader, Uart_ReaderStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UartReader_h_